@@ -1,5 +1,6 @@
 ﻿#include "AppWindow.h"
 #include "Utility.h"
+#include "Database.h"
 
 #include "MainTab.h"
 #include "ExportTab.h"
@@ -84,6 +85,9 @@ LRESULT AppWindow::WindowProcedure(HWND hWnd, UINT uMsg, WPARAM wParam, LPARAM l
 
     case WM_GETMINMAXINFO:
         return OnGetMinMaxInfo(reinterpret_cast<LPMINMAXINFO>(lParam));
+
+    case WM_DATABASE_TASK_DONE:
+        return OnDatabaseTaskDone(reinterpret_cast<DatabaseExecutor::Task*>(lParam));
     }
 
     return DefWindowProc(hWnd, uMsg, wParam, lParam);
@@ -112,6 +116,18 @@ void AppWindow::Initialize(void)
 
     InitWindowClass(hInstance);
     InitWindow(hInstance);
+
+    // The completions of db::Async touch the tabs, so they're sent here to be run on this thread
+    const HWND hWnd = m_hWnd;
+
+    db::GetExecutor().SetCompletionDispatcher([hWnd](DatabaseExecutor::Task completion) {
+        DatabaseExecutor::Task* pCompletion = new DatabaseExecutor::Task(std::move(completion));
+
+        if (!PostMessage(hWnd, WM_DATABASE_TASK_DONE, 0, reinterpret_cast<LPARAM>(pCompletion)))
+        {
+            delete pCompletion;
+        }
+    });
     
     m_pTabManager = new TabManager(m_hWnd, Size(0, 0), Point(0, 0));
     THROW_IF_NULL(m_pTabManager, "Out of memory");
@@ -350,5 +366,15 @@ LRESULT AppWindow::OnGetMinMaxInfo(LPMINMAXINFO pMMI)
     pMMI->ptMinTrackSize.x = 1280;
     pMMI->ptMinTrackSize.y = 720;
 
+    return 0;
+}
+
+LRESULT AppWindow::OnDatabaseTaskDone(DatabaseExecutor::Task* pCompletion)
+{
+    // Allocated by the completion dispatcher set in Initialize
+    std::unique_ptr<DatabaseExecutor::Task> completion(pCompletion);
+
+    (*completion)();
+
     return 0;
 }
\ No newline at end of file
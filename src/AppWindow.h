@@ -8,6 +8,7 @@
 
 #include "ListView.h"
 #include "TabManager.h"
+#include "DatabaseExecutor.h"
 
 class AppWindow
 {
@@ -28,6 +29,7 @@ private:
 	LRESULT OnDPIChanged(HWND hWnd, LPARAM lParam);
 	LRESULT OnSize(WORD wNewWidth, WORD wNewHeight);
 	LRESULT OnGetMinMaxInfo(LPMINMAXINFO pMMI);
+	LRESULT OnDatabaseTaskDone(DatabaseExecutor::Task* pCompletion);
 
 private:
 	HWND m_hWnd = nullptr;
@@ -0,0 +1,170 @@
+#include "CellColors.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+CellColors::CellColors(void)
+	: m_Palette(1, RGB(0, 0, 0))
+{
+}
+
+void CellColors::SetRule(const std::wstring& value, COLORREF cr, int column)
+/*++
+*
+* Routine Description:
+*
+*	Compiles a color rule into the table of values. Colors are added to the palette
+*	the first time a rule uses them, and every cell is colored again once it's drawn.
+*
+* Arguments:
+*
+*	value  - The value of the cells that are colored.
+*	cr     - The color.
+*	column - The column whose cells are colored, or ALL_COLUMNS.
+*
+* Return Value:
+*
+*	None. Throws if the palette can't hold another color.
+*
+--*/
+{
+	auto it = std::find(m_Palette.begin(), m_Palette.end(), cr);
+
+	if (it == m_Palette.end())
+	{
+		if (m_Palette.size() >= UNKNOWN_CELL_COLOR)
+		{
+			throw std::runtime_error("Too many colors used in color rules");
+		}
+
+		it = m_Palette.insert(m_Palette.end(), cr);
+	}
+
+	Rule& rule = m_Rules[value];
+	rule.iColor = static_cast<uint8_t>(it - m_Palette.begin());
+	rule.column = column;
+
+	std::fill(m_Colors.begin(), m_Colors.end(), static_cast<uint8_t>(UNKNOWN_CELL_COLOR));
+}
+
+void CellColors::SetColumnCount(size_t cColumns)
+{
+	if (cColumns != m_cColumns)
+	{
+		m_cColumns = cColumns;
+		Clear();
+	}
+}
+
+void CellColors::Clear(void)
+{
+	m_Colors.clear();
+	m_pProvider = nullptr;
+	m_ProviderVersion = 0;
+}
+
+void CellColors::Reset(RowProvider& provider)
+{
+	m_Colors.assign(provider.GetRowCount() * m_cColumns, static_cast<uint8_t>(UNKNOWN_CELL_COLOR));
+	m_pProvider = &provider;
+	m_ProviderVersion = provider.GetVersion();
+}
+
+uint8_t CellColors::FindColor(const std::wstring& value, size_t column) const
+{
+	auto it = m_Rules.find(value);
+
+	if (it == m_Rules.end())
+	{
+		return 0;
+	}
+
+	if (it->second.column != ALL_COLUMNS && it->second.column != static_cast<int>(column))
+	{
+		return 0;
+	}
+
+	return it->second.iColor;
+}
+
+void CellColors::ColorRow(RowProvider& provider, size_t row)
+{
+	const size_t cCells = (std::min)(provider.GetCellCount(row), m_cColumns);
+	uint8_t* pColors = &m_Colors[row * m_cColumns];
+
+	for (size_t column = 0; column < cCells; ++column)
+	{
+		pColors[column] = FindColor(provider.GetCell(row, column), column);
+	}
+
+	// Cells the row doesn't have are never drawn
+	std::fill(pColors + cCells, pColors + m_cColumns, static_cast<uint8_t>(0));
+}
+
+void CellColors::OnRowAdded(RowProvider& provider, uint64_t version)
+{
+	// Colors that are out of date are all worked out again anyway
+	if (!IsUpToDate(provider, version) || m_cColumns == 0)
+	{
+		return;
+	}
+
+	const size_t row = provider.GetRowCount() - 1;
+
+	m_Colors.resize(provider.GetRowCount() * m_cColumns);
+	ColorRow(provider, row);
+
+	m_ProviderVersion = provider.GetVersion();
+}
+
+void CellColors::OnRowChanged(RowProvider& provider, uint64_t version, size_t row)
+{
+	if (!IsUpToDate(provider, version) || m_cColumns == 0)
+	{
+		return;
+	}
+
+	ColorRow(provider, row);
+
+	m_ProviderVersion = provider.GetVersion();
+}
+
+void CellColors::OnRowsRemoved(RowProvider& provider, uint64_t version, const std::vector<int>& newIndexes)
+/*++
+*
+* Routine Description:
+*
+*	Moves the colors of the rows that are left to where the rows themselves were moved,
+*	which keeps them in the same order, so the colors are moved in a single pass.
+*
+* Arguments:
+*
+*	provider   - The provider the rows were removed from.
+*	version    - The version of the provider before the rows were removed.
+*	newIndexes - The index each row was moved to, or a negative one if it was removed.
+*
+* Return Value:
+*
+*	None.
+*
+--*/
+{
+	if (!IsUpToDate(provider, version) || m_cColumns == 0)
+	{
+		return;
+	}
+
+	assert(newIndexes.size() * m_cColumns == m_Colors.size());
+
+	for (size_t row = 0; row < newIndexes.size(); ++row)
+	{
+		if (newIndexes[row] >= 0 && static_cast<size_t>(newIndexes[row]) != row)
+		{
+			std::copy_n(&m_Colors[row * m_cColumns], m_cColumns, &m_Colors[newIndexes[row] * m_cColumns]);
+		}
+	}
+
+	m_Colors.resize(provider.GetRowCount() * m_cColumns);
+
+	m_ProviderVersion = provider.GetVersion();
+}
@@ -0,0 +1,106 @@
+#pragma once
+
+#include "RowProvider.h"
+
+#include <vector>
+#include <string>
+#include <unordered_map>
+#include <cstdint>
+#include <cassert>
+
+#include <Windows.h>
+
+#define ALL_COLUMNS (-1)
+
+// The color of a cell that hasn't been worked out yet, which is why a palette has at
+// most this many colors
+#define UNKNOWN_CELL_COLOR 0xFF
+
+class CellColors
+/*++
+*
+* Class Description:
+*
+*	The colors the cells of a list are drawn in. Color rules are compiled into a table
+*	from the values they color to indexes in a palette, and each cell keeps the index of
+*	its color in a byte, which is only worked out again when the cell or the rules change.
+*	Drawing a cell then reads its byte and looks it up in the palette, without hashing
+*	its value.
+*
+*	The list tells the colors about the changes it makes to its rows, so that only the
+*	rows that changed are colored again, however many lists share them. If the rows change
+*	in any other way, such as when they come from a provider, every cell is colored again
+*	the next time it's drawn.
+*
+--*/
+{
+public:
+	CellColors(void);
+
+	// Cells of the column with the value are drawn in the color, or cells of every
+	// column if it is ALL_COLUMNS. Replaces any rule the value already had.
+	void SetRule(const std::wstring& value, COLORREF cr, int column = ALL_COLUMNS);
+
+	// Only cells of the first cColumns columns are colored
+	void SetColumnCount(size_t cColumns);
+
+	inline COLORREF GetColor(RowProvider& provider, size_t row, size_t column)
+	{
+		if (&provider != m_pProvider || provider.GetVersion() != m_ProviderVersion)
+		{
+			Reset(provider);
+		}
+
+		assert(column < m_cColumns);
+
+		uint8_t& iColor = m_Colors[row * m_cColumns + column];
+
+		if (iColor == UNKNOWN_CELL_COLOR)
+		{
+			iColor = FindColor(provider.GetCell(row, column), column);
+		}
+
+		return m_Palette[iColor];
+	}
+
+	// These are called once the rows of the provider have been changed, with the version
+	// the provider had before. The row indexes are those of the provider.
+	void OnRowAdded(RowProvider& provider, uint64_t version);
+	void OnRowChanged(RowProvider& provider, uint64_t version, size_t row);
+
+	// newIndexes[row] is the index the row was moved to, or negative if it was removed
+	void OnRowsRemoved(RowProvider& provider, uint64_t version, const std::vector<int>& newIndexes);
+
+	// Forgets the colors of the cells, but not the rules
+	void Clear(void);
+
+private:
+	struct Rule
+	{
+		uint8_t iColor = 0;
+		int column = ALL_COLUMNS;
+	};
+
+	void Reset(RowProvider& provider);
+	void ColorRow(RowProvider& provider, size_t row);
+	inline bool IsUpToDate(const RowProvider& provider, uint64_t version) const
+	{
+		return &provider == m_pProvider && version == m_ProviderVersion;
+	}
+
+	uint8_t FindColor(const std::wstring& value, size_t column) const;
+
+private:
+	// Index 0 is the color of the cells no rule applies to
+	std::vector<COLORREF> m_Palette;
+	std::unordered_map<std::wstring, Rule> m_Rules;
+
+	// m_Colors[row * m_cColumns + column] is the index in m_Palette of the color of the
+	// cell, or UNKNOWN_CELL_COLOR if it hasn't been worked out yet
+	std::vector<uint8_t> m_Colors;
+	size_t m_cColumns = 0;
+
+	// The provider whose cells are colored, and its version at the time
+	const RowProvider* m_pProvider = nullptr;
+	uint64_t m_ProviderVersion = 0;
+};
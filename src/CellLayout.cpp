@@ -0,0 +1,220 @@
+#include "CellLayout.h"
+#include "Renderer.h"
+
+#define ELLIPSIS L"..."
+#define ELLIPSIS_LENGTH 3
+
+// Once this many layouts are remembered, they're all forgotten. This is many times the number
+// of cells that fit on the screen, so it's only reached after a lot of scrolling or resizing.
+#define MAX_CACHED_LAYOUTS 8192
+
+SIZE GdiTextMeasurer::MeasureText(const wchar_t* lpszText, size_t cchText)
+{
+	SIZE extent = {};
+	GetTextExtentPoint32(m_hDC, lpszText, static_cast<int>(cchText), &extent);
+
+	return extent;
+}
+
+void CellLayoutCache::Clear(void)
+{
+	m_LayoutsByWidth.clear();
+	m_cLayouts = 0;
+}
+
+const CellLayout& CellLayoutCache::GetLayout(TextMeasurer& measurer, const std::wstring& cell, int cxColumn)
+/*++
+*
+* Routine Description:
+*
+*	Returns how the text of a cell fits in its column, working it out only if no cell
+*	with the same text has been laid out in a column of the same width before.
+*
+* Arguments:
+*
+*	measurer - Measures text in the font cells are drawn with.
+*	cell     - The text of the cell.
+*	cxColumn - The width of the column in pixels.
+*
+* Return Value:
+*
+*	The layout, which stays valid until the next call to GetLayout or Clear.
+*
+--*/
+{
+	std::unordered_map<std::wstring, CellLayout>& layouts = m_LayoutsByWidth[cxColumn];
+
+	auto it = layouts.find(cell);
+
+	if (it != layouts.end())
+	{
+		return it->second;
+	}
+
+	if (m_cLayouts >= MAX_CACHED_LAYOUTS)
+	{
+		// Layouts of other widths are dropped as well, but this one is still needed
+		for (auto& entry : m_LayoutsByWidth)
+		{
+			entry.second.clear();
+		}
+
+		m_cLayouts = 0;
+	}
+
+	CellLayout& layout = layouts[cell];
+	LayOutCell(measurer, cell, cxColumn, layout);
+	++m_cLayouts;
+
+	return layout;
+}
+
+void CellLayoutCache::LayOutCell(TextMeasurer& measurer, const std::wstring& cell, int cxColumn, CellLayout& out)
+/*++
+*
+* Routine Description:
+*
+*	Fits the text of a cell in its column the way DrawText does with DT_END_ELLIPSIS:
+*	text that is too wide is cut short, keeping as much of its start as possible, and
+*	"..." is put at the end of it.
+*
+* Arguments:
+*
+*	measurer - Measures text in the font cells are drawn with.
+*	cell     - The text of the cell.
+*	cxColumn - The width of the column in pixels.
+*	out      - Receives the layout.
+*
+* Return Value:
+*
+*	None.
+*
+--*/
+{
+	out.extent = measurer.MeasureText(cell.c_str(), cell.length());
+
+	if (out.extent.cx <= cxColumn)
+	{
+		out.text = cell;
+		return;
+	}
+
+	const LONG cxEllipsis = measurer.MeasureText(ELLIPSIS, ELLIPSIS_LENGTH).cx;
+
+	// The longest start of the text that still fits together with the ellipsis. The width
+	// of the start only grows as it gets longer, so it is found with a binary search.
+	size_t cchLow = 0;
+	size_t cchHigh = cell.length();
+
+	while (cchLow < cchHigh)
+	{
+		const size_t cchMiddle = (cchLow + cchHigh + 1) / 2;
+
+		if (measurer.MeasureText(cell.c_str(), cchMiddle).cx + cxEllipsis <= cxColumn)
+		{
+			cchLow = cchMiddle;
+		}
+
+		else
+		{
+			cchHigh = cchMiddle - 1;
+		}
+	}
+
+	// Don't leave half of a surrogate pair behind
+	if (cchLow > 0 && IS_HIGH_SURROGATE(cell[cchLow - 1]))
+	{
+		--cchLow;
+	}
+
+	out.text.assign(cell, 0, cchLow);
+	out.text += ELLIPSIS;
+	out.extent = measurer.MeasureText(out.text.c_str(), out.text.length());
+}
+
+TextLayoutCache::~TextLayoutCache(void)
+{
+	Clear();
+}
+
+void TextLayoutCache::Clear(void)
+{
+	for (auto& entry : m_LayoutsBySize)
+	{
+		for (auto& layout : entry.second)
+		{
+			SAFE_RELEASE_D2D(layout.second);
+		}
+	}
+
+	m_LayoutsBySize.clear();
+	m_cLayouts = 0;
+}
+
+IDWriteTextLayout* TextLayoutCache::GetLayout(IDWriteTextFormat* pTextFormat, const std::wstring& cell, int cxBox, int cyBox)
+/*++
+*
+* Routine Description:
+*
+*	Returns the layout of the text of a cell in a box, making it only if no cell with
+*	the same text has been laid out in a box of the same size before.
+*
+* Arguments:
+*
+*	pTextFormat - The format the text is laid out in. Must be the same for every call
+*	              until the next call to Clear.
+*	cell        - The text of the cell.
+*	cxBox       - The width of the box the text is drawn in, in pixels.
+*	cyBox       - The height of the box the text is drawn in, in pixels.
+*
+* Return Value:
+*
+*	The layout, which is owned by the cache and stays valid until the next call to
+*	GetLayout or Clear, or nullptr if DirectWrite was unable to make it.
+*
+--*/
+{
+	const uint64_t size = (static_cast<uint64_t>(static_cast<uint32_t>(cyBox)) << 32) | static_cast<uint32_t>(cxBox);
+
+	std::unordered_map<std::wstring, IDWriteTextLayout*>& layouts = m_LayoutsBySize[size];
+
+	auto it = layouts.find(cell);
+
+	if (it != layouts.end())
+	{
+		return it->second;
+	}
+
+	if (m_cLayouts >= MAX_CACHED_LAYOUTS)
+	{
+		for (auto& entry : m_LayoutsBySize)
+		{
+			for (auto& layout : entry.second)
+			{
+				SAFE_RELEASE_D2D(layout.second);
+			}
+
+			entry.second.clear();
+		}
+
+		m_cLayouts = 0;
+	}
+
+	IDWriteTextLayout* pLayout = render::CreateTextLayout(
+		cell.c_str(),
+		static_cast<UINT32>(cell.length()),
+		pTextFormat,
+		static_cast<float>(cxBox),
+		static_cast<float>(cyBox)
+	);
+
+	if (!pLayout)
+	{
+		return nullptr;
+	}
+
+	layouts.emplace(cell, pLayout);
+	++m_cLayouts;
+
+	return pLayout;
+}
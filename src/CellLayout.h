@@ -0,0 +1,107 @@
+#pragma once
+
+#include <string>
+#include <unordered_map>
+#include <cstdint>
+
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+
+#include <Windows.h>
+#include <dwrite.h>
+
+class TextMeasurer
+/*++
+*
+* Class Description:
+*
+*	Measures text in whatever font it is drawn with. Laying out cells only ever
+*	goes through this, so it can be done without a window or a device context.
+*
+--*/
+{
+public:
+	virtual ~TextMeasurer(void) = default;
+
+	virtual SIZE MeasureText(const wchar_t* lpszText, size_t cchText) = 0;
+};
+
+class GdiTextMeasurer : public TextMeasurer
+{
+public:
+	// The font that is selected into the device context is the one text is measured in
+	explicit GdiTextMeasurer(HDC hDC) : m_hDC(hDC) {}
+
+	SIZE MeasureText(const wchar_t* lpszText, size_t cchText) override;
+
+private:
+	HDC m_hDC;
+};
+
+struct CellLayout
+{
+	// The text of the cell, cut short and ending in "..." if it doesn't fit
+	std::wstring text;
+
+	// The size of the text above, in pixels
+	SIZE extent = {};
+};
+
+class CellLayoutCache
+/*++
+*
+* Class Description:
+*
+*	Remembers how the text of cells fits in their columns, so that it is only worked
+*	out again when the text of a cell or the width of its column changes, rather than
+*	every time the cell is drawn. Cells with the same text in columns of the same
+*	width share their layout.
+*
+--*/
+{
+public:
+	const CellLayout& GetLayout(TextMeasurer& measurer, const std::wstring& cell, int cxColumn);
+
+	// Must be called whenever the font changes, since every layout depends on it
+	void Clear(void);
+
+private:
+	static void LayOutCell(TextMeasurer& measurer, const std::wstring& cell, int cxColumn, CellLayout& out);
+
+private:
+	// The layouts of cells by their text, for each column width. Cells are looked up
+	// by their text as it is, so that drawing them doesn't have to copy it.
+	std::unordered_map<int, std::unordered_map<std::wstring, CellLayout>> m_LayoutsByWidth;
+	size_t m_cLayouts = 0;
+};
+
+class TextLayoutCache
+/*++
+*
+* Class Description:
+*
+*	Keeps the DirectWrite layouts of the text of cells, which are shaped, measured and
+*	ellipsized once when they are made, so that drawing a cell again only draws the
+*	glyphs. Like CellLayoutCache, cells with the same text in boxes of the same size
+*	share their layout.
+*
+--*/
+{
+public:
+	TextLayoutCache(void) = default;
+	TextLayoutCache(const TextLayoutCache&) = delete;
+	TextLayoutCache& operator=(const TextLayoutCache&) = delete;
+	~TextLayoutCache(void);
+
+	// Returns nullptr if the layout can't be made
+	IDWriteTextLayout* GetLayout(IDWriteTextFormat* pTextFormat, const std::wstring& cell, int cxBox, int cyBox);
+
+	// Must be called whenever the text format changes, since every layout depends on it
+	void Clear(void);
+
+private:
+	// The layouts of cells by their text, for each box size, see CellLayoutCache
+	std::unordered_map<uint64_t, std::unordered_map<std::wstring, IDWriteTextLayout*>> m_LayoutsBySize;
+	size_t m_cLayouts = 0;
+};
@@ -0,0 +1,392 @@
+#include "ColumnIndex.h"
+
+#include <cassert>
+#include <iterator>
+
+// Marks a value that has no bitmap, and a row that has no cell in the column
+#define NO_ID UINT32_MAX
+
+// A value gets a bitmap once it is in at least one of this many rows. Until then its rows
+// are found by going through the ids of the rows, which is quick for the few of them
+// there are, and a bitmap per value would take far more memory for columns such as names.
+#define ROWS_PER_BITMAP_ROW 32
+
+void ColumnIndex::Clear(void)
+{
+	m_Columns.clear();
+	m_pProvider = nullptr;
+	m_ProviderVersion = 0;
+}
+
+const ColumnIndex::Column& ColumnIndex::GetColumn(RowProvider& provider, size_t column)
+{
+	if (&provider != m_pProvider || provider.GetVersion() != m_ProviderVersion)
+	{
+		m_Columns.clear();
+		m_pProvider = &provider;
+		m_ProviderVersion = provider.GetVersion();
+	}
+
+	if (column >= m_Columns.size())
+	{
+		m_Columns.resize(column + 1);
+	}
+
+	if (!m_Columns[column].isBuilt)
+	{
+		BuildColumn(provider, column, m_Columns[column]);
+	}
+
+	return m_Columns[column];
+}
+
+uint32_t ColumnIndex::FindValueOfRow(RowProvider& provider, size_t column, size_t row, Column& indexed)
+/*++
+*
+* Routine Description:
+*
+*	Finds the id of the value of a row in a column, giving the value an id if it
+*	doesn't have one yet.
+*
+* Arguments:
+*
+*	provider - The rows.
+*	column   - The column.
+*	row      - The row.
+*	indexed  - The values of the column.
+*
+* Return Value:
+*
+*	The id, or NO_ID if the row has no cell in the column.
+*
+--*/
+{
+	// Rows that were added before the column have no value in it
+	if (column >= provider.GetCellCount(row))
+	{
+		return NO_ID;
+	}
+
+	auto inserted = indexed.idsOfValues.emplace(provider.GetCell(row, column), static_cast<uint32_t>(indexed.cRowsOfValues.size()));
+
+	if (inserted.second)
+	{
+		indexed.cRowsOfValues.push_back(0);
+		indexed.bitmapsOfValues.push_back(NO_ID);
+	}
+
+	return inserted.first->second;
+}
+
+void ColumnIndex::AddRowToValue(Column& indexed, size_t row, uint32_t id)
+{
+	indexed.idsOfRows[row] = id;
+
+	if (id == NO_ID)
+	{
+		return;
+	}
+
+	const uint32_t cRowsOfValue = ++indexed.cRowsOfValues[id];
+
+	if (indexed.bitmapsOfValues[id] != NO_ID)
+	{
+		indexed.bitmaps[indexed.bitmapsOfValues[id]].Set(row);
+	}
+
+	// The value has become common enough to be worth a bitmap
+	else if (static_cast<size_t>(cRowsOfValue) * ROWS_PER_BITMAP_ROW >= indexed.idsOfRows.size())
+	{
+		RowBitmap bitmap(indexed.idsOfRows.size());
+
+		for (size_t i = 0; i < indexed.idsOfRows.size(); ++i)
+		{
+			if (indexed.idsOfRows[i] == id)
+			{
+				bitmap.Set(i);
+			}
+		}
+
+		indexed.bitmapsOfValues[id] = static_cast<uint32_t>(indexed.bitmaps.size());
+		indexed.bitmaps.emplace_back(std::move(bitmap));
+	}
+}
+
+void ColumnIndex::RemoveRowFromValue(Column& indexed, size_t row, uint32_t id)
+{
+	indexed.idsOfRows[row] = NO_ID;
+
+	if (id == NO_ID)
+	{
+		return;
+	}
+
+	--indexed.cRowsOfValues[id];
+
+	// A value that has become rare keeps its bitmap, which is still right
+	if (indexed.bitmapsOfValues[id] != NO_ID)
+	{
+		indexed.bitmaps[indexed.bitmapsOfValues[id]].Reset(row);
+	}
+}
+
+void ColumnIndex::BuildBitmaps(Column& indexed)
+{
+	const size_t cRows = indexed.idsOfRows.size();
+
+	indexed.bitmaps.clear();
+	indexed.bitmapsOfValues.assign(indexed.cRowsOfValues.size(), NO_ID);
+
+	for (size_t id = 0; id < indexed.cRowsOfValues.size(); ++id)
+	{
+		if (static_cast<size_t>(indexed.cRowsOfValues[id]) * ROWS_PER_BITMAP_ROW >= cRows && indexed.cRowsOfValues[id] > 0)
+		{
+			indexed.bitmapsOfValues[id] = static_cast<uint32_t>(indexed.bitmaps.size());
+			indexed.bitmaps.emplace_back(cRows);
+		}
+	}
+
+	if (indexed.bitmaps.empty())
+	{
+		return;
+	}
+
+	for (size_t row = 0; row < cRows; ++row)
+	{
+		const uint32_t id = indexed.idsOfRows[row];
+
+		if (id != NO_ID && indexed.bitmapsOfValues[id] != NO_ID)
+		{
+			indexed.bitmaps[indexed.bitmapsOfValues[id]].Set(row);
+		}
+	}
+}
+
+void ColumnIndex::BuildColumn(RowProvider& provider, size_t column, Column& out)
+/*++
+*
+* Routine Description:
+*
+*	Gives each distinct value of a column an id, each row the id of its value, and
+*	the values that are in many rows a bitmap of them.
+*
+* Arguments:
+*
+*	provider - The rows.
+*	column   - The column.
+*	out      - Receives the values and their rows.
+*
+* Return Value:
+*
+*	None.
+*
+--*/
+{
+	const size_t cRows = provider.GetRowCount();
+
+	out.idsOfValues.clear();
+	out.cRowsOfValues.clear();
+	out.bitmapsOfValues.clear();
+	out.idsOfRows.assign(cRows, NO_ID);
+
+	for (size_t row = 0; row < cRows; ++row)
+	{
+		const uint32_t id = FindValueOfRow(provider, column, row, out);
+
+		out.idsOfRows[row] = id;
+
+		if (id != NO_ID)
+		{
+			++out.cRowsOfValues[id];
+		}
+	}
+
+	BuildBitmaps(out);
+
+	out.isBuilt = true;
+}
+
+void ColumnIndex::AddRowsWithValue(RowProvider& provider, size_t column, const std::wstring& value, RowBitmap& rows)
+{
+	const Column& indexed = GetColumn(provider, column);
+
+	auto it = indexed.idsOfValues.find(value);
+
+	if (it == indexed.idsOfValues.end())
+	{
+		return;
+	}
+
+	const uint32_t id = it->second;
+
+	if (indexed.bitmapsOfValues[id] != NO_ID)
+	{
+		rows.Or(indexed.bitmaps[indexed.bitmapsOfValues[id]]);
+		return;
+	}
+
+	for (size_t row = 0; row < indexed.idsOfRows.size(); ++row)
+	{
+		if (indexed.idsOfRows[row] == id)
+		{
+			rows.Set(row);
+		}
+	}
+}
+
+void ColumnIndex::RemoveRowsWithValue(RowProvider& provider, size_t column, const std::wstring& value, RowBitmap& rows)
+{
+	const Column& indexed = GetColumn(provider, column);
+
+	auto it = indexed.idsOfValues.find(value);
+
+	if (it == indexed.idsOfValues.end())
+	{
+		return;
+	}
+
+	const uint32_t id = it->second;
+
+	if (indexed.bitmapsOfValues[id] != NO_ID)
+	{
+		rows.AndNot(indexed.bitmaps[indexed.bitmapsOfValues[id]]);
+		return;
+	}
+
+	for (size_t row = 0; row < indexed.idsOfRows.size(); ++row)
+	{
+		if (indexed.idsOfRows[row] == id)
+		{
+			rows.Reset(row);
+		}
+	}
+}
+
+void ColumnIndex::OnRowAdded(RowProvider& provider, uint64_t version)
+{
+	// Columns that are out of date are all built again anyway
+	if (!IsUpToDate(provider, version))
+	{
+		return;
+	}
+
+	const size_t row = provider.GetRowCount() - 1;
+
+	for (size_t column = 0; column < m_Columns.size(); ++column)
+	{
+		Column& indexed = m_Columns[column];
+
+		if (!indexed.isBuilt)
+		{
+			continue;
+		}
+
+		assert(indexed.idsOfRows.size() == row);
+
+		indexed.idsOfRows.push_back(NO_ID);
+
+		for (RowBitmap& bitmap : indexed.bitmaps)
+		{
+			bitmap.Resize(row + 1);
+		}
+
+		AddRowToValue(indexed, row, FindValueOfRow(provider, column, row, indexed));
+	}
+
+	m_ProviderVersion = provider.GetVersion();
+}
+
+void ColumnIndex::OnRowChanged(RowProvider& provider, uint64_t version, size_t row)
+{
+	if (!IsUpToDate(provider, version))
+	{
+		return;
+	}
+
+	for (size_t column = 0; column < m_Columns.size(); ++column)
+	{
+		Column& indexed = m_Columns[column];
+
+		if (!indexed.isBuilt)
+		{
+			continue;
+		}
+
+		const uint32_t oldId = indexed.idsOfRows[row];
+		const uint32_t newId = FindValueOfRow(provider, column, row, indexed);
+
+		if (oldId != newId)
+		{
+			RemoveRowFromValue(indexed, row, oldId);
+			AddRowToValue(indexed, row, newId);
+		}
+	}
+
+	m_ProviderVersion = provider.GetVersion();
+}
+
+void ColumnIndex::OnRowsRemoved(RowProvider& provider, uint64_t version, const std::vector<int>& newIndexes)
+/*++
+*
+* Routine Description:
+*
+*	Moves the ids of the rows that are left to where the rows themselves were moved,
+*	which keeps them in the same order, so each column is gone through once. The values
+*	that are no longer in any row are forgotten, and the bitmaps are built again.
+*
+* Arguments:
+*
+*	provider   - The provider the rows were removed from.
+*	version    - The version of the provider before the rows were removed.
+*	newIndexes - The index each row was moved to, or a negative one if it was removed.
+*
+* Return Value:
+*
+*	None.
+*
+--*/
+{
+	if (!IsUpToDate(provider, version))
+	{
+		return;
+	}
+
+	for (Column& indexed : m_Columns)
+	{
+		if (!indexed.isBuilt)
+		{
+			continue;
+		}
+
+		assert(indexed.idsOfRows.size() == newIndexes.size());
+
+		for (size_t row = 0; row < newIndexes.size(); ++row)
+		{
+			const uint32_t id = indexed.idsOfRows[row];
+
+			if (newIndexes[row] < 0)
+			{
+				if (id != NO_ID)
+				{
+					--indexed.cRowsOfValues[id];
+				}
+			}
+
+			else
+			{
+				indexed.idsOfRows[newIndexes[row]] = id;
+			}
+		}
+
+		indexed.idsOfRows.resize(provider.GetRowCount());
+
+		for (auto it = indexed.idsOfValues.begin(); it != indexed.idsOfValues.end();)
+		{
+			it = (indexed.cRowsOfValues[it->second] == 0) ? indexed.idsOfValues.erase(it) : std::next(it);
+		}
+
+		BuildBitmaps(indexed);
+	}
+
+	m_ProviderVersion = provider.GetVersion();
+}
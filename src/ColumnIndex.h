@@ -0,0 +1,83 @@
+#pragma once
+
+#include "RowProvider.h"
+#include "RowBitmap.h"
+
+#include <vector>
+#include <string>
+#include <unordered_map>
+#include <cstdint>
+
+class ColumnIndex
+/*++
+*
+* Class Description:
+*
+*	Finds the rows whose cell in a column has a given value. The first time a column is
+*	looked at, each distinct value in it is given an id and each row is given the id of
+*	its value, so that from then on the rows of a value are found by comparing ids rather
+*	than strings.
+*
+*	Values that are in many rows, such as the states of tickets, also get a bitmap of
+*	their rows, which is combined with other sets of rows a word at a time.
+*
+*	The list tells the index about the changes it makes to its rows, the same way it
+*	tells CellColors, so the columns that have been looked at are kept up to date rather
+*	than built again. If the rows change in any other way, the columns are built again
+*	the next time they're looked at.
+*
+--*/
+{
+public:
+	// The bitmaps must have as many rows as the provider
+	void AddRowsWithValue(RowProvider& provider, size_t column, const std::wstring& value, RowBitmap& rows);
+	void RemoveRowsWithValue(RowProvider& provider, size_t column, const std::wstring& value, RowBitmap& rows);
+
+	// These are called once the rows of the provider have been changed, with the version
+	// the provider had before. The row indexes are those of the provider.
+	void OnRowAdded(RowProvider& provider, uint64_t version);
+	void OnRowChanged(RowProvider& provider, uint64_t version, size_t row);
+
+	// newIndexes[row] is the index the row was moved to, or negative if it was removed
+	void OnRowsRemoved(RowProvider& provider, uint64_t version, const std::vector<int>& newIndexes);
+
+	void Clear(void);
+
+private:
+	struct Column
+	{
+		bool isBuilt = false;
+
+		std::unordered_map<std::wstring, uint32_t> idsOfValues;
+
+		// idsOfRows[row] is the id of the value of the row, see NO_ID in ColumnIndex.cpp
+		std::vector<uint32_t> idsOfRows;
+
+		// cRowsOfValues[v] is how many rows have the value with id v
+		std::vector<uint32_t> cRowsOfValues;
+
+		// bitmaps[bitmapsOfValues[v]] are the rows of the value with id v, if it has a bitmap
+		std::vector<RowBitmap> bitmaps;
+		std::vector<uint32_t> bitmapsOfValues;
+	};
+
+	const Column& GetColumn(RowProvider& provider, size_t column);
+	static void BuildColumn(RowProvider& provider, size_t column, Column& out);
+
+	static uint32_t FindValueOfRow(RowProvider& provider, size_t column, size_t row, Column& indexed);
+	static void AddRowToValue(Column& indexed, size_t row, uint32_t id);
+	static void RemoveRowFromValue(Column& indexed, size_t row, uint32_t id);
+	static void BuildBitmaps(Column& indexed);
+
+	inline bool IsUpToDate(const RowProvider& provider, uint64_t version) const
+	{
+		return &provider == m_pProvider && version == m_ProviderVersion;
+	}
+
+private:
+	std::vector<Column> m_Columns;
+
+	// The provider whose rows are indexed, and its version at the time
+	const RowProvider* m_pProvider = nullptr;
+	uint64_t m_ProviderVersion = 0;
+};
@@ -4,14 +4,420 @@
 #include "sqlite/sqlite3.h"
 
 #include <stdexcept>
+#include <unordered_map>
 #include <cstdio>
+#include <cctype>
+#include <fstream>
+#include <algorithm>
+#include <mutex>
+#include <cassert>
 #include <Windows.h>
 
 sqlite3* g_database = nullptr;
 
-static void CreateDatabaseTables(void);
+// A second, read-only connection to the same file, for the reads the UI thread has to make
+// right away, such as the pages of a PersonTicketsProvider that is being drawn. It has a
+// lock of its own, so those reads never wait for the work of the executor to let go of
+// g_databaseMutex, and in WAL mode they don't wait for its transactions either.
+static sqlite3* g_readDatabase = nullptr;
 
-void db::Init(void)
+// How long a read waits for a write to the file to finish, which only happens when the
+// file isn't in WAL mode, before it fails
+#define READ_BUSY_TIMEOUT_MS 250
+
+enum StatementID
+{
+	STMT_INSERT_PERSON = 0,
+	STMT_SELECT_PERSON_INFO,
+	STMT_SELECT_ALL_PEOPLE,
+	STMT_SELECT_PERSON_ID,
+	STMT_SELECT_PERSON_BY_ID,
+	STMT_DELETE_PERSON,
+	STMT_INSERT_TICKET,
+	STMT_SELECT_ALL_TICKETS,
+	STMT_SELECT_TICKETS_OF_PERSON,
+	STMT_UPDATE_TICKET,
+	STMT_DELETE_TICKET,
+	STMT_DELETE_TICKETS_OF_PERSON,
+	STMT_DEACTIVATE_TICKET,
+	STMT_ACTIVATE_TICKET,
+	STMT_TICK_INFORMED,
+	STMT_COUNT_TICKETS_OF_PERSON,
+	STMT_SELECT_TICKET_PAGE_OF_PERSON,
+	STMT_BEGIN_TRANSACTION,
+	STMT_COMMIT_TRANSACTION,
+	STMT_ROLLBACK_TRANSACTION,
+
+	STMT_COUNT
+};
+
+// Every column of a ticket, followed by the information of the person it refers to.
+// The person's information is joined in here so that loading the tickets takes a single
+// pass over the table, instead of one extra query per ticket to look up its person.
+#define TICKET_ROW_SELECT                                                                   \
+	"SELECT Ticket.id, Ticket.person_id, Ticket.state, Ticket.informed, Ticket.dept_date, " \
+	"Ticket.dept_time, Ticket.arr_date, Ticket.arr_time, Ticket.aarr_time, Ticket.notes, "  \
+	"Person.role, Person.firstname, Person.lastname, Person.fathername "                    \
+	"FROM Ticket JOIN Person ON Person.id=Ticket.person_id"
+
+// Column positions in the result of TICKET_ROW_SELECT
+#define TICKET_COL_ID          0
+#define TICKET_COL_PERSON_ID   1
+#define TICKET_COL_STATE       2
+#define TICKET_COL_INFORMED    3
+#define TICKET_COL_DEPT_DATE   4
+#define TICKET_COL_DEPT_TIME   5
+#define TICKET_COL_ARR_DATE    6
+#define TICKET_COL_ARR_TIME    7
+#define TICKET_COL_AARR_TIME   8
+#define TICKET_COL_NOTES       9
+#define TICKET_COL_ROLE        10
+#define TICKET_COL_FIRSTNAME   11
+#define TICKET_COL_LASTNAME    12
+#define TICKET_COL_FATHERNAME  13
+
+// The SQL text of every statement the program uses, indexed by StatementID.
+// Each one is compiled exactly once in db::Init and then reused for the whole
+// lifetime of the program, so the order here MUST match the enum above.
+static const char* const g_lpszStatementSQL[STMT_COUNT] = {
+	"INSERT INTO Person (role, firstname, lastname, fathername) VALUES (?1, ?2, ?3, ?4)",
+	"SELECT * FROM Person WHERE id=?1",
+	"SELECT id, role, firstname, lastname, fathername FROM Person",
+	"SELECT id FROM Person WHERE firstname=?1 AND lastname=?2 AND fathername=?3 AND role=?4",
+	"SELECT role, firstname, lastname, fathername FROM Person WHERE Person.id=?1",
+	"DELETE FROM Person WHERE id=?1",
+	"INSERT INTO Ticket (state, informed, person_id, dept_date, dept_time, arr_date, arr_time, aarr_time, notes) "
+	"VALUES (?1, ?2, ?3, ?4, ?5, ?6, ?7, ?8, ?9)",
+	TICKET_ROW_SELECT,
+	TICKET_ROW_SELECT " WHERE Ticket.person_id=?1",
+	"UPDATE Ticket SET dept_date=?1, dept_time=?2, arr_date=?3, arr_time=?4, notes=?5 WHERE id=?6",
+	"DELETE FROM Ticket WHERE Ticket.id=?1",
+	"DELETE FROM Ticket WHERE Ticket.person_id=?1",
+	"UPDATE Ticket SET state=?1, aarr_time=?2 WHERE id=?3",
+	"UPDATE Ticket SET state=?1 WHERE id=?2",
+	"UPDATE Ticket SET informed=1 WHERE id=?1",
+	"SELECT COUNT(*) FROM Ticket WHERE person_id=?1",
+	TICKET_ROW_SELECT " WHERE Ticket.person_id=?1 ORDER BY Ticket.id LIMIT ?2 OFFSET ?3",
+	"BEGIN",
+	"COMMIT",
+	"ROLLBACK"
+};
+
+static sqlite3_stmt* g_statements[STMT_COUNT] = {};
+static sqlite3_stmt* g_readStatements[STMT_COUNT] = {};
+
+// Which connection a statement runs on
+enum class Connection
+{
+	WRITER, // g_database, used by the executor for everything it does
+	READER  // g_readDatabase, only for statements that don't change anything
+};
+
+// How many BeginBatch calls haven't been matched by a CommitBatch or RollbackBatch yet.
+// Only the outermost batch actually begins and ends a transaction.
+static int g_batchDepth = 0;
+
+// Set when a nested batch is rolled back, so that the outermost one rolls back as well
+static bool g_isBatchDoomed = false;
+
+// Held by whoever is using g_database. That is the executor's thread, apart from before it
+// starts and after it stops, but the lock keeps anything else from interleaving with it.
+// A batch holds it from BeginBatch until it ends, so no other thread can slip its own
+// statements into the middle of the transaction.
+static std::recursive_mutex g_databaseMutex;
+
+// Held by whoever is using g_readDatabase
+static std::mutex g_readDatabaseMutex;
+
+// Runs the work given to db::Async
+static DatabaseExecutor g_executor;
+
+static void ApplyOpenProfile(sqlite3* pDatabase, const db::OpenProfile& profile, bool isReadOnly);
+static void MigrateDatabaseSchema(void);
+static void PrepareStatements(sqlite3* pDatabase, sqlite3_stmt* (&statements)[STMT_COUNT]);
+static void FinalizeStatements(sqlite3_stmt* (&statements)[STMT_COUNT]);
+
+class ScopedStatement
+/*++
+*
+* Class Description:
+*
+*	Hands out one of the statements compiled in db::Init, and puts it back in its
+*	initial state once it goes out of scope, even if an exception was thrown.
+*
+*	Resetting is all that is needed to run the statement again, so nothing is ever
+*	recompiled after initialization.
+*
+*	Statements run on the connection of the executor unless Connection::READER is asked
+*	for, which only reads that don't have to see the executor's uncommitted changes should do.
+*
+--*/
+{
+public:
+	explicit ScopedStatement(StatementID id, Connection connection = Connection::WRITER)
+		: m_WriterLock(g_databaseMutex, std::defer_lock), m_ReaderLock(g_readDatabaseMutex, std::defer_lock)
+	{
+		if (connection == Connection::READER)
+		{
+			m_ReaderLock.lock();
+			m_pDatabase = g_readDatabase;
+			m_pStatement = g_readStatements[id];
+
+			assert(!m_pStatement || sqlite3_stmt_readonly(m_pStatement));
+		}
+
+		else
+		{
+			m_WriterLock.lock();
+			m_pDatabase = g_database;
+			m_pStatement = g_statements[id];
+		}
+
+		THROW_IF_NULL(m_pStatement, "Database statement used before db::Init()");
+	}
+
+	~ScopedStatement(void)
+	{
+		sqlite3_reset(m_pStatement);
+		sqlite3_clear_bindings(m_pStatement);
+	}
+
+	ScopedStatement(const ScopedStatement&) = delete;
+	ScopedStatement& operator=(const ScopedStatement&) = delete;
+
+	operator sqlite3_stmt* (void) const { return m_pStatement; }
+
+	void BindInt(int index, int value)
+	{
+		Check(sqlite3_bind_int(m_pStatement, index, value));
+	}
+
+	void BindText(int index, const wchar_t* lpszText)
+	{
+		// The text only needs to live until the statement is stepped, which always
+		// happens before the caller's strings go out of scope, so no copy is made.
+		Check(sqlite3_bind_text16(m_pStatement, index, lpszText, -1, SQLITE_STATIC));
+	}
+
+	void BindText(int index, const std::wstring& text)
+	{
+		Check(sqlite3_bind_text16(m_pStatement, index, text.c_str(), static_cast<int>(text.length() * sizeof(wchar_t)), SQLITE_STATIC));
+	}
+
+	// A temporary would be destroyed before the statement is stepped
+	void BindText(int index, std::wstring&& text) = delete;
+
+	void ExecuteToCompletion(void)
+	{
+		if (sqlite3_step(m_pStatement) != SQLITE_DONE)
+		{
+			throw std::runtime_error(sqlite3_errmsg(m_pDatabase));
+		}
+	}
+
+	// The message of the last error of the statement's connection
+	const char* GetErrorMessage(void) const
+	{
+		return sqlite3_errmsg(m_pDatabase);
+	}
+
+	// Makes the statement ready to be bound and executed again
+	void Reset(void)
+	{
+		sqlite3_reset(m_pStatement);
+		sqlite3_clear_bindings(m_pStatement);
+	}
+
+private:
+	void Check(int rc)
+	{
+		if (rc != SQLITE_OK)
+		{
+			throw std::runtime_error(sqlite3_errmsg(m_pDatabase));
+		}
+	}
+
+private:
+	// Declared first, so that the statement is reset before the lock is released.
+	// Only the one of the statement's connection is locked.
+	std::unique_lock<std::recursive_mutex> m_WriterLock;
+	std::unique_lock<std::mutex> m_ReaderLock;
+
+	sqlite3* m_pDatabase = nullptr;
+	sqlite3_stmt* m_pStatement = nullptr;
+};
+
+db::OpenProfile db::GetOpenProfile(const std::string& name)
+/*++
+*
+* Routine Description:
+*
+*	Returns one of the predefined ways of opening the database file.
+*
+*		- "fast" is the default one. The file is written through a write-ahead log, so
+*		  that reading never waits for a write, and it is only synced at checkpoints,
+*		  which may lose the latest changes on a power cut but never corrupts the file.
+*
+*		- "safe" is how SQLite opens files when it's left to its defaults, which is how
+*		  the program opened the file before profiles existed.
+*
+* Arguments:
+*
+*	name - Name of the profile.
+*
+* Return Value:
+*
+*	The profile. An unknown name results in an exception.
+*
+--*/
+{
+	if (name == "fast")
+	{
+		return OpenProfile();
+	}
+
+	if (name == "safe")
+	{
+		OpenProfile profile;
+		profile.journal_mode = "DELETE";
+		profile.synchronous  = "FULL";
+		profile.temp_store   = "DEFAULT";
+		profile.cache_size   = 2000;
+		profile.mmap_size    = 0;
+		return profile;
+	}
+
+	throw std::runtime_error("Unknown database profile \"" + name + "\"");
+}
+
+static std::wstring ReadTextColumn(sqlite3_stmt* statement, int column)
+{
+	// The notes may be NULL, in which case an empty string is returned
+	const char* text = reinterpret_cast<const char*>(sqlite3_column_text(statement, column));
+
+	if (!text)
+	{
+		return std::wstring();
+	}
+
+	// The length must be asked for after the text, which may have been converted to get it
+	return util::DecodeUtf8(text, static_cast<size_t>(sqlite3_column_bytes(statement, column)));
+}
+
+static void ReadTextColumn(sqlite3_stmt* statement, int column, wchar_t* out, size_t out_len)
+/*++
+*
+* Routine Description:
+*
+*	Reads a text column into a field of a fixed length, such as a name of a person.
+*	Text that doesn't fit is cut short after the last whole character that does.
+*
+* Arguments:
+*
+*	statement - The statement whose current row is read.
+*	column    - The column.
+*	out       - Receives the text, which is always null terminated.
+*	out_len   - The length of out, in characters.
+*
+* Return Value:
+*
+*	None.
+*
+--*/
+{
+	const char* text = reinterpret_cast<const char*>(sqlite3_column_text(statement, column));
+
+	if (!text)
+	{
+		util::DecodeUtf8("", 0, out, out_len);
+		return;
+	}
+
+	util::DecodeUtf8(text, static_cast<size_t>(sqlite3_column_bytes(statement, column)), out, out_len);
+}
+
+static std::string TrimSpaces(const std::string& text)
+{
+	const size_t first = text.find_first_not_of(" \t\r");
+
+	if (first == std::string::npos)
+	{
+		return std::string();
+	}
+
+	return text.substr(first, text.find_last_not_of(" \t\r") - first + 1);
+}
+
+db::OpenProfile db::LoadOpenProfile(const char* lpszConfigPath)
+/*++
+*
+* Routine Description:
+*
+*	Reads the profile that the database should be opened with from a configuration
+*	file. Each line of the file is either empty, a comment starting with '#' or ';',
+*	or a "key = value" pair. The "profile" key picks one of the profiles known to
+*	GetOpenProfile, and any of the fields of OpenProfile may be given after it to
+*	override the value the profile has for it, e.g.
+*
+*		profile = fast
+*		cache_size = 65536
+*
+* Arguments:
+*
+*	lpszConfigPath - Path to the configuration file.
+*
+* Return Value:
+*
+*	The profile. If the file doesn't exist, the default profile is returned.
+*
+--*/
+{
+	std::ifstream file(lpszConfigPath);
+	std::string line;
+
+	OpenProfile profile;
+
+	while (std::getline(file, line))
+	{
+		line = TrimSpaces(line);
+
+		if (line.empty() || line[0] == '#' || line[0] == ';')
+		{
+			continue;
+		}
+
+		const size_t separator = line.find('=');
+
+		if (separator == std::string::npos)
+		{
+			throw std::runtime_error("Invalid line in " + std::string(lpszConfigPath) + ": " + line);
+		}
+
+		const std::string key = TrimSpaces(line.substr(0, separator));
+		const std::string value = TrimSpaces(line.substr(separator + 1));
+
+		try
+		{
+			if (key == "profile")           profile = GetOpenProfile(value);
+			else if (key == "journal_mode") profile.journal_mode = value;
+			else if (key == "synchronous")  profile.synchronous = value;
+			else if (key == "temp_store")   profile.temp_store = value;
+			else if (key == "cache_size")   profile.cache_size = std::stoi(value);
+			else if (key == "mmap_size")    profile.mmap_size = std::stoll(value);
+			else throw std::runtime_error("Unknown key \"" + key + "\"");
+		}
+
+		catch (std::logic_error&)
+		{
+			// Thrown by std::stoi and std::stoll
+			throw std::runtime_error("Invalid value in " + std::string(lpszConfigPath) + ": " + line);
+		}
+	}
+
+	return profile;
+}
+
+void db::Init(const OpenProfile& profile)
 /*++
 * 
 * Routine Description:
@@ -20,7 +426,7 @@ void db::Init(void)
 * 
 * Arguments:
 * 
-*	None.
+*	profile - Determines how the file is opened. See OpenProfile.
 * 
 * Return Value:
 * 
@@ -38,17 +444,34 @@ void db::Init(void)
 		throw std::runtime_error("Out of memory: Cannot open database file.");
 	}
 
-	CreateDatabaseTables();
+	ApplyOpenProfile(g_database, profile, false);
+	MigrateDatabaseSchema();
+
+	// The tables must exist before this is called, otherwise the
+	// statements that refer to them will fail to compile.
+	PrepareStatements(g_database, g_statements);
+
+	// Opened once the schema is up to date, since it couldn't bring it up to date itself
+	if (sqlite3_open_v2("sva.db", &g_readDatabase, SQLITE_OPEN_READONLY, NULL) != SQLITE_OK)
+	{
+		throw std::runtime_error(sqlite3_errmsg(g_readDatabase));
+	}
+
+	sqlite3_busy_timeout(g_readDatabase, READ_BUSY_TIMEOUT_MS);
+
+	ApplyOpenProfile(g_readDatabase, profile, true);
+	PrepareStatements(g_readDatabase, g_readStatements);
+
+	g_executor.Start();
 }
 
 void db::Execute1K(const wchar_t* lpszCommand)
 {
 	char* lpszErrorMessage = nullptr;
-	char lpszSQLQuery[1024];
 
-	util::EncodeWideTextToMultibyte(lpszCommand, lpszSQLQuery, 1024);
+	const std::string query = util::EncodeUtf8(lpszCommand, wcslen(lpszCommand));
 
-	sqlite3_exec(g_database, lpszSQLQuery, NULL, NULL, &lpszErrorMessage);
+	sqlite3_exec(g_database, query.c_str(), NULL, NULL, &lpszErrorMessage);
 
 	if (lpszErrorMessage)
 	{
@@ -75,48 +498,440 @@ void db::Uninit(void)
 * 
 --*/
 {
+	// Waits for the work that is still queued, which may well be the last few changes
+	g_executor.Stop();
+
+	// Anything that was never committed is discarded
+	if (g_batchDepth > 0)
+	{
+		sqlite3_step(g_statements[STMT_ROLLBACK_TRANSACTION]);
+		g_batchDepth = 0;
+		g_isBatchDoomed = false;
+	}
+
+	// sqlite3_close refuses to close a connection that still has unfinalized statements
+	FinalizeStatements(g_readStatements);
+	FinalizeStatements(g_statements);
+
+	// The writer is closed last, so that it is the one that checkpoints the write-ahead log
+	sqlite3_close(g_readDatabase);
 	sqlite3_close(g_database);
 }
 
-static void CreateDatabaseTables(void)
+static void ExecuteScript(const char* lpszSQL, sqlite3* pDatabase = g_database)
+{
+	char* lpszErrorMessage = nullptr;
+
+	if (sqlite3_exec(pDatabase, lpszSQL, NULL, NULL, &lpszErrorMessage) != SQLITE_OK)
+	{
+		const std::string message = lpszErrorMessage ? lpszErrorMessage : sqlite3_errmsg(pDatabase);
+		sqlite3_free(lpszErrorMessage);
+
+		throw std::runtime_error(message);
+	}
+}
+
+static void ApplyOpenProfile(sqlite3* pDatabase, const db::OpenProfile& profile, bool isReadOnly)
+{
+	// The names are pasted in the SQL, so anything but a plain word is refused
+	for (const std::string* name : { &profile.journal_mode, &profile.synchronous, &profile.temp_store })
+	{
+		if (name->empty() || !std::all_of(name->begin(), name->end(), [](char c) { return std::isalpha(static_cast<unsigned char>(c)); }))
+		{
+			throw std::runtime_error("Invalid database profile setting \"" + *name + "\"");
+		}
+	}
+
+	// The journal mode is stored in the file and syncing only matters to writes, so a
+	// read-only connection is only given the settings that each connection has for itself
+	const std::string writerPragmas = isReadOnly ? "" :
+		"PRAGMA journal_mode=" + profile.journal_mode + ";"
+		"PRAGMA synchronous=" + profile.synchronous + ";";
+
+	const std::string pragmas = writerPragmas +
+		"PRAGMA temp_store=" + profile.temp_store + ";"
+		// A negative cache size is in KiB rather than pages
+		"PRAGMA cache_size=" + std::to_string(-static_cast<long long>(profile.cache_size)) + ";"
+		"PRAGMA mmap_size=" + std::to_string(profile.mmap_size) + ";";
+
+	ExecuteScript(pragmas.c_str(), pDatabase);
+}
+
+static int GetSchemaVersion(void)
+{
+	sqlite3_stmt* statement = nullptr;
+	int version = 0;
+
+	if (sqlite3_prepare_v2(g_database, "PRAGMA user_version", -1, &statement, NULL) != SQLITE_OK)
+	{
+		throw std::runtime_error(sqlite3_errmsg(g_database));
+	}
+
+	if (sqlite3_step(statement) == SQLITE_ROW)
+	{
+		version = sqlite3_column_int(statement, 0);
+	}
+
+	sqlite3_finalize(statement);
+
+	return version;
+}
+
+static bool ColumnExists(const char* lpszTable, const char* lpszColumn)
 {
-	db::Execute1K(
-		L"CREATE TABLE IF NOT EXISTS Person("
-		L"   id         INTEGER PRIMARY KEY,"
-		L"	role       INTEGER NOT NULL,"
-		L"	firstname  TEXT NOT NULL,"
-		L"	lastname   TEXT NOT NULL,"
-		L"	fathername TEXT NOT NULL"
-		L");"
+	sqlite3_stmt* statement = nullptr;
+	bool exists = false;
+
+	if (sqlite3_prepare_v2(g_database, "SELECT 1 FROM pragma_table_info(?1) WHERE name=?2", -1, &statement, NULL) != SQLITE_OK)
+	{
+		throw std::runtime_error(sqlite3_errmsg(g_database));
+	}
+
+	sqlite3_bind_text(statement, 1, lpszTable, -1, SQLITE_STATIC);
+	sqlite3_bind_text(statement, 2, lpszColumn, -1, SQLITE_STATIC);
+
+	exists = (sqlite3_step(statement) == SQLITE_ROW);
+
+	sqlite3_finalize(statement);
+
+	return exists;
+}
+
+static void CreateInitialTables(void)
+{
+	ExecuteScript(
+		"CREATE TABLE IF NOT EXISTS Person("
+		"   id         INTEGER PRIMARY KEY,"
+		"   role       INTEGER NOT NULL,"
+		"   firstname  TEXT NOT NULL,"
+		"   lastname   TEXT NOT NULL,"
+		"   fathername TEXT NOT NULL"
+		");"
+		"CREATE TABLE IF NOT EXISTS Ticket("
+		"   id        INTEGER PRIMARY KEY,"
+		"   state     TEXT    NOT NULL,"
+		"   person_id INTEGER NOT NULL,"
+		"   dept_date TEXT    NOT NULL,"
+		"   dept_time TEXT    NOT NULL,"
+		"   arr_date  TEXT    NOT NULL,"
+		"   arr_time  TEXT    NOT NULL,"
+		"   aarr_time TEXT    NOT NULL,"
+		"   notes     TEXT,"
+		"   FOREIGN KEY(person_id) REFERENCES Person(id)"
+		");"
 	);
+}
 
-	db::Execute1K(
-		L"CREATE TABLE IF NOT EXISTS Ticket("
-		L"	 id        INTEGER PRIMARY KEY,"
-		L"   state     TEXT    NOT NULL,"
-		L"   person_id INTEGER NOT NULL,"
-		L"   dept_date TEXT    NOT NULL,"
-		L"   dept_time TEXT    NOT NULL,"
-		L"	 arr_date  TEXT    NOT NULL,"
-		L"	 arr_time  TEXT    NOT NULL,"
-		L"   aarr_time TEXT    NOT NULL," 
-		L"   notes     TEXT,"
-		L"   FOREIGN KEY(person_id) REFERENCES Person(id)"
-		L");"
+static void AddInformedColumn(void)
+{
+	// Files created before versioning existed may already have the column,
+	// because it used to be added every time the program started
+	if (!ColumnExists("Ticket", "informed"))
+	{
+		ExecuteScript("ALTER TABLE Ticket ADD COLUMN informed INTEGER DEFAULT 0");
+	}
+}
+
+static void CreateLookupIndexes(void)
+{
+	ExecuteScript(
+		// Used when looking up the tickets of a person, and when deleting a person
+		"CREATE INDEX IF NOT EXISTS Ticket_person_id ON Ticket(person_id);"
+		"CREATE INDEX IF NOT EXISTS Ticket_state ON Ticket(state);"
+		// Used by db::GetPersonID, which looks a person up by every one of these columns
+		"CREATE INDEX IF NOT EXISTS Person_names ON Person(lastname, firstname, fathername, role);"
 	);
+}
+
+// Every change ever made to the schema, in order. A database file whose user_version
+// is N has had the first N of them applied, so only the rest have to be applied to it.
+// Existing entries must never be changed or reordered; new ones go at the end.
+static void (* const g_pfnMigrations[])(void) = {
+	CreateInitialTables,  // 1
+	AddInformedColumn,    // 2
+	CreateLookupIndexes   // 3
+};
+
+static void MigrateDatabaseSchema(void)
+/*++
+*
+* Routine Description:
+*
+*	Brings the schema of the opened database file up to date, by applying the migrations
+*	in g_pfnMigrations that haven't been applied to it yet. Each migration is applied in
+*	its own transaction, together with the update of the file's version, so the file is
+*	never left halfway through one.
+*
+* Arguments:
+*
+*	None.
+*
+* Return Value:
+*
+*	None.
+*
+--*/
+{
+	const int latestVersion = static_cast<int>(ARRAY_SIZE(g_pfnMigrations));
+	const int fileVersion = GetSchemaVersion();
 
-	try 
+	if (fileVersion > latestVersion)
 	{
-		db::Execute1K(L"ALTER TABLE Ticket ADD COLUMN informed INTEGER DEFAULT 0");
+		throw std::runtime_error("The database file was created by a newer version of the program");
 	}
 
-	catch (std::runtime_error& e)
+	for (int version = fileVersion; version < latestVersion; ++version)
 	{
-		// Already exists
+		const std::string setVersion = "PRAGMA user_version=" + std::to_string(version + 1);
+
+		ExecuteScript("BEGIN");
+
+		try
+		{
+			g_pfnMigrations[version]();
+			ExecuteScript(setVersion.c_str());
+			ExecuteScript("COMMIT");
+		}
+
+		catch (std::runtime_error&)
+		{
+			sqlite3_exec(g_database, "ROLLBACK", NULL, NULL, NULL);
+			throw;
+		}
 	}
 }
 
-void db::InsertPersonToDatabase(const Person& info)
+static void PrepareStatements(sqlite3* pDatabase, sqlite3_stmt* (&statements)[STMT_COUNT])
+/*++
+*
+* Routine Description:
+*
+*	Compiles every statement in g_lpszStatementSQL once, so that the rest of
+*	the functions in this file only have to bind their parameters and step.
+*
+*	Statements that change the file compile on a read-only connection as well,
+*	and only fail if they're run, which ScopedStatement never lets happen.
+*
+* Arguments:
+*
+*	pDatabase  - The connection the statements are compiled for.
+*	statements - Receives the statements, indexed by StatementID.
+*
+* Return Value:
+*
+*	None.
+*
+--*/
+{
+	for (int i = 0; i < STMT_COUNT; ++i)
+	{
+		// SQLITE_PREPARE_PERSISTENT tells SQLite that the statement will be kept
+		// around and reused many times, so it avoids using the lookaside allocator
+		const int rc = sqlite3_prepare_v3(
+			pDatabase,
+			g_lpszStatementSQL[i],
+			-1,
+			SQLITE_PREPARE_PERSISTENT,
+			&statements[i],
+			NULL
+		);
+
+		if (rc != SQLITE_OK)
+		{
+			throw std::runtime_error(sqlite3_errmsg(pDatabase));
+		}
+	}
+}
+
+static void FinalizeStatements(sqlite3_stmt* (&statements)[STMT_COUNT])
+{
+	for (sqlite3_stmt*& statement : statements)
+	{
+		// Finalizing a null pointer is a harmless no-op
+		sqlite3_finalize(statement);
+		statement = nullptr;
+	}
+}
+
+void db::BeginBatch(void)
+/*++
+*
+* Routine Description:
+*
+*	Starts grouping every statement that follows into a single transaction, so that
+*	they are all written to the disk at once when CommitBatch is called, instead of
+*	each one being synced separately.
+*
+*	Batches may be nested, in which case the inner ones become part of the outermost.
+*
+* Arguments:
+*
+*	None.
+*
+* Return Value:
+*
+*	None.
+*
+--*/
+{
+	std::unique_lock<std::recursive_mutex> lock(g_databaseMutex);
+
+	if (g_batchDepth == 0)
+	{
+		ScopedStatement statement(STMT_BEGIN_TRANSACTION);
+		statement.ExecuteToCompletion();
+
+		g_isBatchDoomed = false;
+	}
+
+	++g_batchDepth;
+
+	// Kept locked until the matching CommitBatch or RollbackBatch
+	lock.release();
+}
+
+void db::CommitBatch(void)
+/*++
+*
+* Routine Description:
+*
+*	Ends the batch started by the matching call to BeginBatch. If it is the outermost
+*	batch, all of the changes made since it began are committed.
+*
+*	If a batch nested in the outermost one has been rolled back, committing the outermost
+*	batch throws, because only part of its changes would remain.
+*
+*	Whenever this throws, the batch is left open, as the transaction still is in SQLite
+*	when COMMIT fails, and it has to be ended with RollbackBatch. db::Transaction does so.
+*
+* Arguments:
+*
+*	None.
+*
+* Return Value:
+*
+*	None.
+*
+--*/
+{
+	std::lock_guard<std::recursive_mutex> lock(g_databaseMutex);
+
+	if (g_batchDepth == 0)
+	{
+		throw std::runtime_error("db::CommitBatch() called without a matching db::BeginBatch()");
+	}
+
+	// Releases the lock taken by the matching BeginBatch when this returns, unless the batch is left open
+	std::unique_lock<std::recursive_mutex> batchLock(g_databaseMutex, std::adopt_lock);
+
+	if (g_batchDepth > 1)
+	{
+		--g_batchDepth;
+		return;
+	}
+
+	if (g_isBatchDoomed)
+	{
+		batchLock.release();
+		throw std::runtime_error("db::CommitBatch() Error: a nested batch has been rolled back");
+	}
+
+	try
+	{
+		ScopedStatement statement(STMT_COMMIT_TRANSACTION);
+		statement.ExecuteToCompletion();
+	}
+
+	catch (...)
+	{
+		batchLock.release();
+		throw;
+	}
+
+	g_batchDepth = 0;
+}
+
+void db::RollbackBatch(void)
+/*++
+*
+* Routine Description:
+*
+*	Ends the batch started by the matching call to BeginBatch, discarding its changes.
+*	The changes are discarded once the outermost batch ends, whichever way it ends.
+*
+* Arguments:
+*
+*	None.
+*
+* Return Value:
+*
+*	None.
+*
+--*/
+{
+	std::lock_guard<std::recursive_mutex> lock(g_databaseMutex);
+
+	if (g_batchDepth == 0)
+	{
+		throw std::runtime_error("db::RollbackBatch() called without a matching db::BeginBatch()");
+	}
+
+	// Releases the lock taken by the matching BeginBatch when this returns
+	std::lock_guard<std::recursive_mutex> batchLock(g_databaseMutex, std::adopt_lock);
+
+	if (--g_batchDepth > 0)
+	{
+		g_isBatchDoomed = true;
+		return;
+	}
+
+	g_isBatchDoomed = false;
+
+	ScopedStatement statement(STMT_ROLLBACK_TRANSACTION);
+	statement.ExecuteToCompletion();
+}
+
+db::Transaction::Transaction(void)
+{
+	db::BeginBatch();
+}
+
+db::Transaction::~Transaction(void)
+{
+	if (!m_isFinished)
+	{
+		// Destructors must not throw, and there's nothing left to do if the rollback fails
+		try
+		{
+			db::RollbackBatch();
+		}
+
+		catch (std::runtime_error&)
+		{
+		}
+	}
+}
+
+void db::Transaction::Commit(void)
+{
+	if (!m_isFinished)
+	{
+		// If committing fails the batch is still open, and the destructor rolls it back
+		db::CommitBatch();
+		m_isFinished = true;
+	}
+}
+
+static void ExecuteInsertPerson(ScopedStatement& statement, const db::Person& info)
+{
+	statement.BindInt(1, static_cast<int>(info.role));
+	statement.BindText(2, info.firstname);
+	statement.BindText(3, info.lastname);
+	statement.BindText(4, info.fathername);
+	statement.ExecuteToCompletion();
+}
+
+int db::InsertPersonToDatabase(const Person& info)
 /*++
 * 
 * Routine Description:
@@ -128,35 +943,89 @@ void db::InsertPersonToDatabase(const Person& info)
 * 
 *	info - Reference to a person struct containing the information.
 * 
+* Return Value:
+* 
+*	The id of the new person.
+* 
 --*/
 {
-	wchar_t lpszQuery[sizeof(Person) / sizeof(wchar_t) + 96] = {};
+	ScopedStatement statement(STMT_INSERT_PERSON);
+	ExecuteInsertPerson(statement, info);
 
-	swprintf_s(
-		lpszQuery,
-		sizeof(lpszQuery) / sizeof(lpszQuery[0]),
-		L"INSERT INTO Person (role, firstname, lastname, fathername) VALUES (%d, \'%s\', \'%s\', \'%s\')",
-		info.role, info.firstname, info.lastname, info.fathername
-	);
+	// Read while the statement still holds the lock, so no other insert can come in between
+	return GetLastInsertedRowId();
+}
 
-	db::Execute1K(lpszQuery);
+int db::InsertPersonIfNew(const Person& info)
+/*++
+* 
+* Routine Description:
+* 
+*	Inserts a person in the database, unless there already is one with the same names
+*	and role. The person is looked up and inserted in a single transaction, so nothing
+*	can insert the same person in between.
+* 
+* Arguments:
+* 
+*	info - Reference to a person struct containing the information.
+* 
+* Return Value:
+* 
+*	The id of the new person, or -1 if the person already existed.
+* 
+--*/
+{
+	db::Transaction transaction;
+
+	if (GetPersonID(info) != -1)
+	{
+		return -1;
+	}
+
+	const int id = InsertPersonToDatabase(info);
+
+	transaction.Commit();
+
+	return id;
 }
 
-std::vector<std::wstring> db::GetPersonInfo(int person_id)
+void db::InsertPeople(std::vector<Person>& people)
+/*++
+*
+* Routine Description:
+*
+*	Inserts every given person in a single transaction. Either all of them are
+*	inserted, or, if an error occurs, none of them are.
+*
+* Arguments:
+*
+*	people - The people to be inserted. The id of each one is set to the id
+*	         that the database gave them.
+*
+--*/
 {
-	std::vector<std::wstring> info;
+	db::Transaction transaction;
+	ScopedStatement statement(STMT_INSERT_PERSON);
 
-	char query[128];
-	ZeroMemory(query, sizeof(query));
-	sprintf_s(query, 128, "SELECT * FROM Person WHERE id=%d", person_id);
+	for (Person& person : people)
+	{
+		ExecuteInsertPerson(statement, person);
+		statement.Reset();
 
-	sqlite3_stmt* stmt;
-	int rc = sqlite3_prepare_v2(g_database, query, strlen(query), &stmt, NULL);
+		person.id = GetLastInsertedRowId();
+	}
 
-	wchar_t buf[64];
-	ZeroMemory(buf, sizeof(buf));
+	transaction.Commit();
+}
 
-	while (sqlite3_step(stmt) != SQLITE_DONE)
+std::vector<std::wstring> db::GetPersonInfo(int person_id)
+{
+	std::vector<std::wstring> info;
+
+	ScopedStatement stmt(STMT_SELECT_PERSON_INFO);
+	stmt.BindInt(1, person_id);
+
+	while (sqlite3_step(stmt) == SQLITE_ROW)
 	{
 		int num_cols = sqlite3_column_count(stmt);
 
@@ -164,11 +1033,8 @@ std::vector<std::wstring> db::GetPersonInfo(int person_id)
 		{
 			switch (sqlite3_column_type(stmt, i))
 			{
-			case (SQLITE3_TEXT): {
-			const char* str = reinterpret_cast<const char*>(sqlite3_column_text(stmt, i));
-				util::DecodeMultibyteToWideText(str, buf, 64);
-				info.emplace_back(std::wstring(buf));
-			}
+			case (SQLITE3_TEXT):
+				info.emplace_back(ReadTextColumn(stmt, i));
 				break;
 			case (SQLITE_INTEGER):
 				info.emplace_back(std::to_wstring(sqlite3_column_int(stmt, i)));
@@ -177,8 +1043,6 @@ std::vector<std::wstring> db::GetPersonInfo(int person_id)
 		}
 	}
 
-	sqlite3_finalize(stmt);
-
 	return info;
 }
 
@@ -186,29 +1050,19 @@ void db::LoadPeopleFromDatabase(std::vector<db::Person>& peopleList)
 {   
 	peopleList.clear();
 
-	constexpr char lpszQuery[] = "SELECT * FROM Person";
-
-	sqlite3_stmt* statement;
-	sqlite3_prepare_v2(g_database, lpszQuery, sizeof(lpszQuery), &statement, NULL);
+	ScopedStatement statement(STMT_SELECT_ALL_PEOPLE);
 
-	if (!statement)
-	{
-		throw std::runtime_error("Failed to load people from database");
-	}
-
-	while (sqlite3_step(statement) != SQLITE_DONE)
+	while (sqlite3_step(statement) == SQLITE_ROW)
 	{
 		peopleList.emplace_back(db::Person());
 
 		db::Person& info = peopleList.back();
 		info.id = sqlite3_column_int(statement, 0);
 		info.role = (util::PersonRole)sqlite3_column_int(statement, 1);
-		util::DecodeMultibyteToWideText((const char*)(sqlite3_column_text(statement, 2)), info.firstname,  sizeof(info.firstname)  / sizeof(wchar_t));
-		util::DecodeMultibyteToWideText((const char*)(sqlite3_column_text(statement, 3)), info.lastname,   sizeof(info.lastname)   / sizeof(wchar_t));
-		util::DecodeMultibyteToWideText((const char*)(sqlite3_column_text(statement, 4)), info.fathername, sizeof(info.fathername) / sizeof(wchar_t));
+		ReadTextColumn(statement, 2, info.firstname, ARRAY_SIZE(info.firstname));
+		ReadTextColumn(statement, 3, info.lastname, ARRAY_SIZE(info.lastname));
+		ReadTextColumn(statement, 4, info.fathername, ARRAY_SIZE(info.fathername));
 	}
-
-	sqlite3_finalize(statement);
 }
 
 int db::GetPersonID(const Person& info)
@@ -226,35 +1080,20 @@ int db::GetPersonID(const Person& info)
 * 
 --*/
 {
-	wchar_t lpszQuery[1024];
-	swprintf_s(lpszQuery, sizeof(lpszQuery) / sizeof(wchar_t), 
-		L"SELECT id FROM Person WHERE firstname='%s' AND lastname='%s' AND fathername='%s' AND role=%d",
-		info.firstname, info.lastname, info.fathername, info.role
-	);
+	ScopedStatement statement(STMT_SELECT_PERSON_ID);
+	statement.BindText(1, info.firstname);
+	statement.BindText(2, info.lastname);
+	statement.BindText(3, info.fathername);
+	statement.BindInt(4, static_cast<int>(info.role));
 	
-	char lpszEncodedQuery[2048];
-	util::EncodeWideTextToMultibyte(lpszQuery, lpszEncodedQuery, sizeof(lpszEncodedQuery));
-
-	sqlite3_stmt* statement;
-	sqlite3_prepare_v2(g_database, lpszEncodedQuery, sizeof(lpszEncodedQuery), &statement, NULL);
-
-	if (!statement)
-	{
-	throw std::runtime_error("Query Error: gb::GetPersonID()");
-	}
-
-	// If sqlite3_step() returns SQLITE_DONE the first time it is called,
+	// If sqlite3_step() doesn't return a row the first time it is called,
 	// then the query didn't return any results, meaning the person doesn't exist
-	if (sqlite3_step(statement) == SQLITE_DONE)
+	if (sqlite3_step(statement) != SQLITE_ROW)
 	{
 		return -1;
 	}
 
-	const int id = sqlite3_column_int(statement, 0);
-
-	sqlite3_finalize(statement);
-
-	return id;
+	return sqlite3_column_int(statement, 0);
 }
 
 int db::GetLastInsertedRowId(void)
@@ -262,208 +1101,415 @@ int db::GetLastInsertedRowId(void)
 	return static_cast<int>(sqlite3_last_insert_rowid(g_database));
 }
 
-void db::InsertTicketToDatabase(const Ticket& ticket)
+DatabaseExecutor& db::GetExecutor(void)
 {
-	wchar_t lpszQuery[1024] = {};
+	return g_executor;
+}
 
-	swprintf_s(
-		lpszQuery,
-		sizeof(lpszQuery) / sizeof(lpszQuery[0]),
-		L"INSERT INTO Ticket (state, informed, person_id, dept_date, dept_time, arr_date, arr_time, aarr_time, notes) \
-          VALUES (\'%s\', %s, %s, \'%s\', \'%s\', \'%s\', \'%s\', \'%s\', \'%s\')",
-		ticket[0].c_str(), ticket[1].c_str(), ticket[2].c_str(), ticket[3].c_str(),
-		ticket[4].c_str(), ticket[5].c_str(), ticket[6].c_str(), ticket[7].c_str(), ticket[8].c_str()
-	);
+static std::wstring GetTicketStateText(const db::TicketRecord& ticket)
+{
+	return ticket.state == util::TicketState::INVALID ? ticket.unknownState : util::EnumToString(ticket.state);
+}
+
+static void ExecuteInsertTicket(ScopedStatement& statement, const db::TicketRecord& ticket)
+{
+	// The bound strings must outlive the call to ExecuteToCompletion
+	const std::wstring strings[] = {
+		GetTicketStateText(ticket),
+		util::FormatPackedDate(ticket.departure_date),
+		util::FormatTime(ticket.departure_time),
+		util::FormatPackedDate(ticket.arrival_date),
+		util::FormatTime(ticket.arrival_time),
+		util::FormatTime(ticket.actual_arrival_time)
+	};
+
+	statement.BindText(1, strings[0]);
+	statement.BindInt(2, ticket.informed ? 1 : 0);
+	statement.BindInt(3, ticket.person_id);
+
+	// The dates and times are bound to the parameters after the person
+	for (int i = 1; i < ARRAY_SIZE(strings); ++i)
+	{
+		statement.BindText(i + 3, strings[i]);
+	}
 
-	db::Execute1K(lpszQuery);
+	statement.BindText(9, ticket.notes);
+	statement.ExecuteToCompletion();
 }
 
-void db::LoadTicketsFromDatabase(std::vector<db::Ticket>& tickets)
+int db::InsertTicketToDatabase(const TicketRecord& ticket)
+{
+	ScopedStatement statement(STMT_INSERT_TICKET);
+	ExecuteInsertTicket(statement, ticket);
+
+	return GetLastInsertedRowId();
+}
+
+void db::InsertTickets(std::vector<TicketRecord>& tickets)
+/*++
+*
+* Routine Description:
+*
+*	Inserts every given ticket in a single transaction. Either all of them are
+*	inserted, or, if an error occurs, none of them are.
+*
+* Arguments:
+*
+*	tickets - The tickets to be inserted. The id of each one is set to the id
+*	          that the database gave them.
+*
+--*/
 {
-	sqlite3_stmt* statement;
-	sqlite3_prepare_v2(g_database, "SELECT * FROM Ticket", -1, &statement, NULL);
+	db::Transaction transaction;
+	ScopedStatement statement(STMT_INSERT_TICKET);
 
-	if (statement == NULL)
+	for (TicketRecord& ticket : tickets)
 	{
-		throw std::runtime_error("Query error: LoadTicketsFromDatabase()");
+		ExecuteInsertTicket(statement, ticket);
+		statement.Reset();
+
+		ticket.id = GetLastInsertedRowId();
 	}
 
-	tickets.clear();
+	transaction.Commit();
+}
 
-	wchar_t buffer[512];
+static void ReadTicketRecord(
+	sqlite3_stmt* statement,
+	db::TicketRecord& ticket,
+	std::unordered_map<int, std::shared_ptr<const db::Person>>& people)
+/*++
+*
+* Routine Description:
+*
+*	Converts the current result row of a TICKET_ROW_SELECT statement into a ticket record.
+*
+* Arguments:
+*
+*	statement - Statement whose last call to sqlite3_step returned SQLITE_ROW.
+*	ticket - Receives the ticket's information.
+*	people - People that have been read so far, used so that tickets of the
+*	         same person share the same Person object.
+*
+--*/
+{
+	ticket.id        = sqlite3_column_int(statement, TICKET_COL_ID);
+	ticket.person_id = sqlite3_column_int(statement, TICKET_COL_PERSON_ID);
+	std::wstring state = ReadTextColumn(statement, TICKET_COL_STATE);
 
-	while (sqlite3_step(statement) != SQLITE_DONE)
-	{
-		db::Ticket ticket;
+	ticket.state     = util::StringToTicketState(state);
+	ticket.informed  = sqlite3_column_int(statement, TICKET_COL_INFORMED) != 0;
 
-		const int columnCount = sqlite3_column_count(statement);
+	ticket.departure_date      = util::PackDate(util::ConvertStringToDate(ReadTextColumn(statement, TICKET_COL_DEPT_DATE)));
+	ticket.departure_time      = static_cast<short>(util::ConvertStringToTime(ReadTextColumn(statement, TICKET_COL_DEPT_TIME)));
+	ticket.arrival_date        = util::PackDate(util::ConvertStringToDate(ReadTextColumn(statement, TICKET_COL_ARR_DATE)));
+	ticket.arrival_time        = static_cast<short>(util::ConvertStringToTime(ReadTextColumn(statement, TICKET_COL_ARR_TIME)));
+	ticket.actual_arrival_time = static_cast<short>(util::ConvertStringToTime(ReadTextColumn(statement, TICKET_COL_AARR_TIME)));
 
-		for (int i = 0; i < columnCount; ++i)
-		{
-			switch (sqlite3_column_type(statement, i))
-			{
-			case SQLITE_TEXT: {
-				const char* text = reinterpret_cast<const char*>(sqlite3_column_text(statement, i));
-				util::DecodeMultibyteToWideText(text, buffer, 511);
-				ticket.emplace_back(buffer);
-				break;
-			}
+	ticket.notes = ReadTextColumn(statement, TICKET_COL_NOTES);
 
-			case SQLITE_INTEGER: {
-				if (i == 2) { // role
-					db::Person person;
-					db::GetPersonFromID(sqlite3_column_int(statement, i), person);
-					ticket.emplace_back(util::EnumToString(person.role));
-					ticket.emplace_back(person.firstname);
-					ticket.emplace_back(person.lastname);
-					ticket.emplace_back(person.fathername);
-					break;
-				} else if (i == 0) { // id
-					ticket.emplace_back(std::to_wstring(sqlite3_column_int(statement, i)));
-				} else if (i == 1) {
-
-				} else {
-					ticket.insert(ticket.begin() + 1, sqlite3_column_int(statement, i) == 0 ? L"✕" : L"✓");
-				}
-			}
+	// Legacy or hand-edited states are kept so that they're shown as they were stored
+	if (ticket.state == util::TicketState::INVALID)
+	{
+		ticket.unknownState = std::move(state);
+	}
 
-			}
-		}
+	else
+	{
+		ticket.unknownState.clear();
+	}
+
+	std::shared_ptr<const db::Person>& person = people[ticket.person_id];
 
-		tickets.emplace_back(ticket);
+	if (!person)
+	{
+		std::shared_ptr<db::Person> info = std::make_shared<db::Person>();
+		info->id = ticket.person_id;
+		info->role = (util::PersonRole)sqlite3_column_int(statement, TICKET_COL_ROLE);
+		ReadTextColumn(statement, TICKET_COL_FIRSTNAME, info->firstname, ARRAY_SIZE(info->firstname));
+		ReadTextColumn(statement, TICKET_COL_LASTNAME, info->lastname, ARRAY_SIZE(info->lastname));
+		ReadTextColumn(statement, TICKET_COL_FATHERNAME, info->fathername, ARRAY_SIZE(info->fathername));
+		person = std::move(info);
 	}
 
-	sqlite3_finalize(statement);
+	ticket.person = person;
 }
 
-void db::GetPersonFromID(int id, db::Person& out)
+void db::LoadTicketsFromDatabase(std::vector<db::TicketRecord>& tickets)
 {
-	char query[128];
-	sprintf_s(query, 128, "SELECT role, firstname, lastname, fathername FROM Person WHERE Person.id=%d", id);
+	ScopedStatement statement(STMT_SELECT_ALL_TICKETS);
+
+	std::unordered_map<int, std::shared_ptr<const db::Person>> people;
+
+	tickets.clear();
+
+	while (sqlite3_step(statement) == SQLITE_ROW)
+	{
+		tickets.emplace_back();
+		ReadTicketRecord(statement, tickets.back(), people);
+	}
+}
 
-	sqlite3_stmt* statement;
-	sqlite3_prepare_v2(g_database, query, -1, &statement, NULL);
+void db::GetPersonFromID(int id, db::Person& out)
+{
+	ScopedStatement statement(STMT_SELECT_PERSON_BY_ID);
+	statement.BindInt(1, id);
 
-	if (sqlite3_step(statement) == SQLITE_DONE)
+	if (sqlite3_step(statement) != SQLITE_ROW)
 	{
 		out.id = -1;
 		return;
 	}
 	
-	wchar_t buffer[192];
+	out.id = id;
 	out.role = (util::PersonRole)sqlite3_column_int(statement, 0);
-	util::DecodeMultibyteToWideText((const char*)sqlite3_column_text(statement, 1), out.firstname,  sizeof(out.firstname)  / sizeof(out.firstname[0]));
-	util::DecodeMultibyteToWideText((const char*)sqlite3_column_text(statement, 2), out.lastname,   sizeof(out.lastname)   / sizeof(out.lastname[0]));
-	util::DecodeMultibyteToWideText((const char*)sqlite3_column_text(statement, 3), out.fathername, sizeof(out.fathername) / sizeof(out.fathername[0]));
-
-	sqlite3_finalize(statement);
+	ReadTextColumn(statement, 1, out.firstname, ARRAY_SIZE(out.firstname));
+	ReadTextColumn(statement, 2, out.lastname, ARRAY_SIZE(out.lastname));
+	ReadTextColumn(statement, 3, out.fathername, ARRAY_SIZE(out.fathername));
 }
 
 void db::DeleteTicket(int id)
 {
-	std::wstring query = L"DELETE FROM Ticket WHERE Ticket.id=" + std::to_wstring(id);
-
-	db::Execute1K(query.c_str());
+	ScopedStatement statement(STMT_DELETE_TICKET);
+	statement.BindInt(1, id);
+	statement.ExecuteToCompletion();
 }
 
 void db::DeactivateTicket(int id, const std::wstring& timeOfDeactivation)
 {
-	std::wstring query = L"UPDATE Ticket SET state='Ανενεργή', aarr_time='" + timeOfDeactivation + L"' WHERE id = " + std::to_wstring(id);
-
-	db::Execute1K(query.c_str());
+	ScopedStatement statement(STMT_DEACTIVATE_TICKET);
+	statement.BindText(1, L"Ανενεργή");
+	statement.BindText(2, timeOfDeactivation);
+	statement.BindInt(3, id);
+	statement.ExecuteToCompletion();
 }
 
-void db::UpdateTicket(db::Ticket& ticket)
+void db::UpdateTicket(const db::TicketRecord& ticket)
+/*++
+*
+* Routine Description:
+*
+*	Stores the dates, times and notes of the ticket. The state, the "informed" mark
+*	and the person the ticket refers to are left untouched.
+*
+* Arguments:
+*
+*	ticket - The ticket, identified by its id.
+*
+--*/
 {
-	// 4-9
-	//L"INSERT INTO Ticket (state, person_id, dept_date, dept_time, arr_date, arr_time, aarr_time, notes) 
-	std::wstring query =
-		L"UPDATE Ticket SET "
-		L"	dept_date='" + ticket[6] +
-		L"',dept_time='" + ticket[7] +
-		L"',arr_date='" + ticket[8] +
-		L"',arr_time='" + ticket[9] +
-		L"',notes='" + ticket[11] +
-		L"' WHERE id=" + ticket[0];
+	// The bound strings must outlive the call to ExecuteToCompletion
+	const std::wstring strings[] = {
+		util::FormatPackedDate(ticket.departure_date),
+		util::FormatTime(ticket.departure_time),
+		util::FormatPackedDate(ticket.arrival_date),
+		util::FormatTime(ticket.arrival_time)
+	};
+
+	ScopedStatement statement(STMT_UPDATE_TICKET);
+
+	for (int i = 0; i < ARRAY_SIZE(strings); ++i)
+	{
+		statement.BindText(i + 1, strings[i]);
+	}
 
-	db::Execute1K(query.c_str());
+	statement.BindText(5, ticket.notes);
+	statement.BindInt(6, ticket.id);
+	statement.ExecuteToCompletion();
 }
 
 void db::DeletePerson(int id)
 {
-	std::wstring query = L"DELETE FROM Person WHERE id=" + std::to_wstring(id);
+	ScopedStatement statement(STMT_DELETE_PERSON);
+	statement.BindInt(1, id);
+	statement.ExecuteToCompletion();
+}
+
+void db::DeletePersonCascade(int id)
+/*++
+*
+* Routine Description:
+*
+*	Deletes a person together with every ticket of theirs, in a single transaction, so
+*	that either all of them are deleted or none is. The tickets are deleted with one
+*	statement, which finds them through the index on Ticket.person_id.
+*
+* Arguments:
+*
+*	id - The id of the person.
+*
+* Return Value:
+*
+*	None.
+*
+--*/
+{
+	db::Transaction transaction;
+
+	{
+		ScopedStatement statement(STMT_DELETE_TICKETS_OF_PERSON);
+		statement.BindInt(1, id);
+		statement.ExecuteToCompletion();
+	}
 
-	db::Execute1K(query.c_str());
+	db::DeletePerson(id);
+
+	transaction.Commit();
 }
 
-void db::GetTicketsOfPerson(int person_id, std::vector<db::Ticket>& tickets)
+void db::GetTicketsOfPerson(int person_id, std::vector<db::TicketRecord>& tickets)
 {
-	const std::wstring str_person_id = std::to_wstring(person_id);
+	ScopedStatement statement(STMT_SELECT_TICKETS_OF_PERSON);
+	statement.BindInt(1, person_id);
 
-	std::wstring query = L"SELECT * FROM Ticket WHERE person_id=" + str_person_id;
+	std::unordered_map<int, std::shared_ptr<const db::Person>> people;
 
-	char encoded[128];
-	util::EncodeWideTextToMultibyte(query.c_str(), encoded, 127);
+	while (sqlite3_step(statement) == SQLITE_ROW)
+	{
+		tickets.emplace_back();
+		ReadTicketRecord(statement, tickets.back(), people);
+	}
+}
 
-	sqlite3_stmt* statement;
-	sqlite3_prepare_v2(g_database, encoded, -1, &statement, NULL);
+void db::TickInformed(int id)
+{
+	ScopedStatement statement(STMT_TICK_INFORMED);
+	statement.BindInt(1, id);
+	statement.ExecuteToCompletion();
+}
 
-	THROW_IF_NULL(statement, "Query Error: GetTicketsOfPerson()");
+void db::ActivateTicket(int id)
+{
+	ScopedStatement statement(STMT_ACTIVATE_TICKET);
+	statement.BindText(1, L"Ενεργή");
+	statement.BindInt(2, id);
+	statement.ExecuteToCompletion();
+}
 
-	wchar_t buffer[512];
+std::vector<std::wstring> db::TicketRecordToRow(const db::TicketRecord& ticket, bool withInformedMark)
+/*++
+*
+* Routine Description:
+*
+*	Creates the cells that a list view displays for a ticket.
+*
+* Arguments:
+*
+*	ticket - The ticket to be displayed.
+*	withInformedMark - Whether the "informed" mark is shown in a column after the id.
+*
+--*/
+{
+	const StringPool& pool = StringPool::GetGlobal();
+	PooledRow pooled = TicketRecordToPooledRow(ticket, withInformedMark);
+
+	std::vector<std::wstring> row;
+	row.reserve(pooled.size());
 
-	while (sqlite3_step(statement) != SQLITE_DONE)
+	for (PooledCell& cell : pooled)
 	{
-		db::Ticket ticket;
+		row.emplace_back(cell.handle != NOT_POOLED ? pool.Get(cell.handle) : std::move(cell.text));
+	}
 
-		const int columnCount = sqlite3_column_count(statement);
+	return row;
+}
 
-		for (int i = 0; i < columnCount; ++i)
-		{
-			switch (sqlite3_column_type(statement, i))
-			{
-			case SQLITE_TEXT: {
-				const char* text = reinterpret_cast<const char*>(sqlite3_column_text(statement, i));
-				util::DecodeMultibyteToWideText(text, buffer, 511);
-				ticket.emplace_back(buffer);
-				break;
-			}
+PooledRow db::TicketRecordToPooledRow(const db::TicketRecord& ticket, bool withInformedMark)
+/*++
+*
+* Routine Description:
+*
+*	Creates the cells that a list view displays for a ticket. The informed mark, the
+*	state, the role and the names are shared by many tickets, so they are interned and
+*	only stored once. The names are interned straight from the person, without making
+*	a copy of them first. The id, the dates, the times and the notes are given as text,
+*	since the pool never lets go of its strings.
+*
+* Arguments:
+*
+*	ticket - The ticket to be displayed.
+*	withInformedMark - Whether the "informed" mark is shown in a column after the id.
+*
+--*/
+{
+	StringPool& pool = StringPool::GetGlobal();
 
-			case SQLITE_INTEGER: {
-				if (i > 1) {
-					db::Person person;
-					db::GetPersonFromID(sqlite3_column_int(statement, i), person);
-					ticket.emplace_back(std::to_wstring((int)(person.role)));
-					ticket.emplace_back(person.firstname);
-					ticket.emplace_back(person.lastname);
-					ticket.emplace_back(person.fathername);
-					break;
-				}
-				else {
-					ticket.emplace_back(std::to_wstring(sqlite3_column_int(statement, i)));
-				}
-			}
+	PooledRow row;
+	row.reserve(13);
 
-			}
-		}
+	row.emplace_back(std::to_wstring(ticket.id));
 
-		ticket[2] = util::EnumToString((util::PersonRole)std::stoi(ticket[2]));
-		tickets.emplace_back(ticket);
+	if (withInformedMark)
+	{
+		row.emplace_back(pool.Intern(ticket.informed ? L"✓" : L"✕", 1));
 	}
 
-	sqlite3_finalize(statement);
+	row.emplace_back(pool.Intern(GetTicketStateText(ticket)));
+	row.emplace_back(pool.Intern(util::EnumToString(ticket.person->role)));
+	row.emplace_back(pool.Intern(ticket.person->firstname, wcslen(ticket.person->firstname)));
+	row.emplace_back(pool.Intern(ticket.person->lastname, wcslen(ticket.person->lastname)));
+	row.emplace_back(pool.Intern(ticket.person->fathername, wcslen(ticket.person->fathername)));
+	row.emplace_back(util::FormatPackedDate(ticket.departure_date));
+	row.emplace_back(util::FormatTime(ticket.departure_time));
+	row.emplace_back(util::FormatPackedDate(ticket.arrival_date));
+	row.emplace_back(util::FormatTime(ticket.arrival_time));
+	row.emplace_back(util::FormatTime(ticket.actual_arrival_time));
+	row.emplace_back(ticket.notes);
+
+	return row;
 }
 
-void db::TickInformed(int id)
+db::PersonTicketsProvider::PersonTicketsProvider(int person_id)
+	: m_PersonID(person_id)
+{
+}
+
+size_t db::PersonTicketsProvider::CountRows(void)
 {
-	std::wstring query = L"UPDATE Ticket SET informed=1 WHERE id=" + std::to_wstring(id);
+	ScopedStatement statement(STMT_COUNT_TICKETS_OF_PERSON, Connection::READER);
+	statement.BindInt(1, m_PersonID);
+
+	if (sqlite3_step(statement) != SQLITE_ROW)
+	{
+		throw std::runtime_error(statement.GetErrorMessage());
+	}
 
-	db::Execute1K(query.c_str());
+	return static_cast<size_t>(sqlite3_column_int64(statement, 0));
 }
 
-void db::ActivateTicket(int id)
+void db::PersonTicketsProvider::FetchRows(size_t first, size_t count, std::vector<Row>& out)
+/*++
+*
+* Routine Description:
+*
+*	Reads a page of the person's tickets, ordered by their id so that
+*	the same offset always refers to the same ticket.
+*
+*	This is called while the list is being drawn, so the page is read through the
+*	read-only connection, which doesn't wait for the work of the executor.
+*
+* Arguments:
+*
+*	first - Offset of the first ticket.
+*	count - Maximum number of tickets to be read.
+*	out - Receives the rows of the tickets.
+*
+--*/
 {
-	std::wstring query = L"UPDATE Ticket SET state='Ενεργή' WHERE id=" + std::to_wstring(id);
+	ScopedStatement statement(STMT_SELECT_TICKET_PAGE_OF_PERSON, Connection::READER);
+	statement.BindInt(1, m_PersonID);
+	statement.BindInt(2, static_cast<int>(count));
+	statement.BindInt(3, static_cast<int>(first));
+
+	std::unordered_map<int, std::shared_ptr<const db::Person>> people;
+	db::TicketRecord ticket;
+
+	out.clear();
+	out.reserve(count);
 
-	db::Execute1K(query.c_str());
-}
\ No newline at end of file
+	while (sqlite3_step(statement) == SQLITE_ROW)
+	{
+		ReadTicketRecord(statement, ticket, people);
+		out.emplace_back(TicketRecordToRow(ticket, false));
+	}
+}
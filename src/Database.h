@@ -2,9 +2,12 @@
 
 #include "sqlite/sqlite3.h"
 #include "Tab.h"
+#include "RowProvider.h"
+#include "DatabaseExecutor.h"
 
 #include <vector>
 #include <string>
+#include <memory>
 
 namespace db
 {
@@ -17,31 +20,150 @@ namespace db
 		wchar_t fathername[MAX_FIRSTNAME_LENGTH];
 	};
 
-	using Ticket = std::vector<std::wstring>;
+	struct TicketRecord
+	{
+		int id        = -1;
+		int person_id = -1;
+
+		// Packed with util::PackDate, NO_DATE if there is none
+		int departure_date = NO_DATE;
+		int arrival_date   = NO_DATE;
+
+		// Minutes since midnight, NO_TIME if there is none
+		short departure_time      = NO_TIME;
+		short arrival_time        = NO_TIME;
+		short actual_arrival_time = NO_TIME;
+
+		util::TicketState state = util::TicketState::PENDING;
+
+		// The state as it is stored, if it isn't one that util::TicketState has, in which
+		// case state is INVALID. It is displayed and written back as it is.
+		std::wstring unknownState;
+		bool informed = false;
+
+		// Every ticket of the same person points to the same Person object,
+		// so the names are stored once per person rather than once per ticket.
+		std::shared_ptr<const Person> person;
+
+		std::wstring notes;
+	};
 
-	void Init(void);
+	struct OpenProfile
+	{
+		// These are passed as they are to the PRAGMA of the same name
+		std::string journal_mode = "WAL";
+		std::string synchronous  = "NORMAL";
+		std::string temp_store   = "MEMORY";
+
+		// Size of the page cache in KiB
+		int cache_size = 16 * 1024;
+
+		// How many bytes of the file may be memory mapped, 0 to never map it
+		long long mmap_size = 256LL * 1024 * 1024;
+	};
+
+	OpenProfile GetOpenProfile(const std::string& name);
+	OpenProfile LoadOpenProfile(const char* lpszConfigPath);
+
+	void Init(const OpenProfile& profile = OpenProfile());
 	void Execute1K(const wchar_t* lpszCommand);
 	void Uninit(void);
 
-	void InsertPersonToDatabase(const Person& info);
-	void InsertTicketToDatabase(const Ticket& ticket);
+	void BeginBatch(void);
+	void CommitBatch(void);
+	void RollbackBatch(void);
+
+	class Transaction
+	/*++
+	*
+	* Class Description:
+	*
+	*	Begins a batch when it is created, and rolls it back when it goes out of scope,
+	*	unless Commit has been called. This way an exception thrown halfway through a
+	*	series of changes never leaves only some of them in the database.
+	*
+	--*/
+	{
+	public:
+		Transaction(void);
+		~Transaction(void);
+
+		Transaction(const Transaction&) = delete;
+		Transaction& operator=(const Transaction&) = delete;
+
+		void Commit(void);
+
+	private:
+		bool m_isFinished = false;
+	};
+
+	int InsertPersonToDatabase(const Person& info);
+	int InsertPersonIfNew(const Person& info);
+	int InsertTicketToDatabase(const TicketRecord& ticket);
+	void InsertPeople(std::vector<Person>& people);
+	void InsertTickets(std::vector<TicketRecord>& tickets);
 
 	int GetPersonID(const Person& info);
 
 	std::vector<std::wstring> GetPersonInfo(int person_id);
 
 	void LoadPeopleFromDatabase(std::vector<db::Person>&);
-	void LoadTicketsFromDatabase(std::vector<db::Ticket>&);
+	void LoadTicketsFromDatabase(std::vector<db::TicketRecord>&);
 
-	void GetTicketsOfPerson(int person_id, std::vector<db::Ticket>& tickets);
+	void GetTicketsOfPerson(int person_id, std::vector<db::TicketRecord>& tickets);
 	void DeletePerson(int id);
+	void DeletePersonCascade(int id);
 	void DeleteTicket(int id);
 	void DeactivateTicket(int id, const std::wstring& time);
 	void ActivateTicket(int id);
 	void TickInformed(int id);
-	void UpdateTicket(db::Ticket& ticket);
+	void UpdateTicket(const db::TicketRecord& ticket);
 	
 	void GetPersonFromID(int id, db::Person& out);
 
 	int GetLastInsertedRowId(void);
+
+	// The executor that runs the work given to Async. It is started by Init and
+	// stopped by Uninit, after everything that has been queued has run.
+	DatabaseExecutor& GetExecutor(void);
+
+	// Runs work on the database thread, e.g. db::Async([id] { db::DeleteTicket(id); })
+	template<typename F>
+	auto Async(F work) -> std::future<decltype(work())>
+	{
+		return GetExecutor().Submit(std::move(work));
+	}
+
+	// Runs work on the database thread, and then onDone on the UI thread with a future
+	// of its result. Calling get() on the future rethrows whatever work has thrown.
+	template<typename F, typename C>
+	void Async(F work, C onDone)
+	{
+		GetExecutor().Submit(std::move(work), std::move(onDone));
+	}
+
+	std::vector<std::wstring> TicketRecordToRow(const db::TicketRecord& ticket, bool withInformedMark);
+	PooledRow TicketRecordToPooledRow(const db::TicketRecord& ticket, bool withInformedMark);
+
+	class PersonTicketsProvider : public WindowedRowProvider
+	/*++
+	*
+	* Class Description:
+	*
+	*	Provides the rows of every ticket of a person, formatted like TicketRecordToRow does
+	*	without the "informed" mark. Only the pages that are being looked at are read from
+	*	the database, so a person with a long history doesn't have to be loaded all at once.
+	*
+	--*/
+	{
+	public:
+		explicit PersonTicketsProvider(int person_id);
+
+	protected:
+		size_t CountRows(void) override;
+		void FetchRows(size_t first, size_t count, std::vector<Row>& out) override;
+
+	private:
+		int m_PersonID;
+	};
 }
\ No newline at end of file
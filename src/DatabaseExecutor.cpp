@@ -0,0 +1,144 @@
+#include "DatabaseExecutor.h"
+
+DatabaseExecutor::~DatabaseExecutor(void)
+{
+	Stop();
+}
+
+void DatabaseExecutor::Start(void)
+{
+	if (!m_Worker.joinable())
+	{
+		m_isStopping = false;
+		m_Worker = std::thread(&DatabaseExecutor::WorkerMain, this);
+	}
+}
+
+void DatabaseExecutor::Stop(void)
+/*++
+*
+* Routine Description:
+*
+*	Waits for every task that has been submitted so far to finish, and then
+*	stops the worker thread. Tasks submitted after this run on the caller's thread.
+*
+* Arguments:
+*
+*	None.
+*
+* Return Value:
+*
+*	None.
+*
+--*/
+{
+	if (m_Worker.joinable())
+	{
+		{
+			std::lock_guard<std::mutex> lock(m_WakeMutex);
+			m_isStopping = true;
+		}
+
+		m_WakeCondition.notify_one();
+		m_Worker.join();
+	}
+}
+
+void DatabaseExecutor::SetCompletionDispatcher(CompletionDispatcher dispatcher)
+{
+	std::lock_guard<std::mutex> lock(m_DispatcherMutex);
+	m_Dispatcher = std::move(dispatcher);
+}
+
+void DatabaseExecutor::Post(Task task)
+/*++
+*
+* Routine Description:
+*
+*	Queues a task to be run on the worker thread. If the worker isn't running,
+*	the task is run right away on the caller's thread instead.
+*
+* Arguments:
+*
+*	task - The task. Anything it throws is ignored, so use Submit if that matters.
+*
+--*/
+{
+	if (!m_Worker.joinable())
+	{
+		task();
+		return;
+	}
+
+	m_Queue.Push(std::move(task));
+
+	// Only the first task after the queue ran dry has to wake the worker up; if there
+	// were more, the worker is busy and will get to this one without being told.
+	if (m_cPendingTasks.fetch_add(1, std::memory_order_acq_rel) == 0)
+	{
+		std::lock_guard<std::mutex> lock(m_WakeMutex);
+		m_WakeCondition.notify_one();
+	}
+}
+
+void DatabaseExecutor::WorkerMain(void)
+{
+	for (;;)
+	{
+		if (m_cPendingTasks.load(std::memory_order_acquire) == 0)
+		{
+			std::unique_lock<std::mutex> lock(m_WakeMutex);
+
+			m_WakeCondition.wait(lock, [this] {
+				return m_isStopping || m_cPendingTasks.load(std::memory_order_acquire) > 0;
+			});
+
+			// Everything that was submitted before stopping must still run
+			if (m_cPendingTasks.load(std::memory_order_acquire) == 0)
+			{
+				break;
+			}
+		}
+
+		Task task;
+
+		// The task has been counted, so it is in the queue, but its producer may not
+		// have finished linking it yet. That takes no more than a couple of instructions.
+		while (!m_Queue.Pop(task))
+		{
+			std::this_thread::yield();
+		}
+
+		m_cPendingTasks.fetch_sub(1, std::memory_order_acq_rel);
+
+		try
+		{
+			task();
+		}
+
+		catch (...)
+		{
+			// Nobody is waiting for this task, so there is no one to hand the error to
+		}
+	}
+}
+
+void DatabaseExecutor::DispatchCompletion(Task completion)
+{
+	CompletionDispatcher dispatcher;
+
+	{
+		std::lock_guard<std::mutex> lock(m_DispatcherMutex);
+		dispatcher = m_Dispatcher;
+	}
+
+	if (dispatcher)
+	{
+		dispatcher(std::move(completion));
+	}
+
+	else
+	{
+		completion();
+	}
+}
@@ -0,0 +1,242 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+template<typename T>
+class MpscQueue
+/*++
+*
+* Class Description:
+*
+*	A first-in first-out queue that any number of threads may push to at the same time
+*	without ever taking a lock, while a single thread pops from it.
+*
+*	Pushing is a single atomic exchange. Because of that, for a very short while after a
+*	push has started the item may not be visible to Pop yet, in which case Pop returns
+*	false even though the queue isn't empty; the consumer is expected to try again.
+*
+--*/
+{
+public:
+	MpscQueue(void)
+		: m_pHead(&m_Stub), m_pTail(&m_Stub)
+	{
+	}
+
+	~MpscQueue(void)
+	{
+		T item;
+
+		while (Pop(item))
+		{
+		}
+	}
+
+	MpscQueue(const MpscQueue&) = delete;
+	MpscQueue& operator=(const MpscQueue&) = delete;
+
+	void Push(T item)
+	{
+		Push(new Node(std::move(item)));
+	}
+
+	bool Pop(T& out)
+	{
+		Node* pTail = m_pTail;
+		Node* pNext = pTail->pNext.load(std::memory_order_acquire);
+
+		// The stub node never holds an item, so skip it
+		if (pTail == &m_Stub)
+		{
+			if (!pNext)
+			{
+				return false;
+			}
+
+			m_pTail = pNext;
+			pTail = pNext;
+			pNext = pNext->pNext.load(std::memory_order_acquire);
+		}
+
+		if (!pNext)
+		{
+			// The tail is the last node that has been linked. If it isn't the head as
+			// well, a producer is in the middle of a push and the item isn't visible yet.
+			if (pTail != m_pHead.load(std::memory_order_acquire))
+			{
+				return false;
+			}
+
+			// Put the stub back behind the last node, so it can be taken out of the queue
+			m_Stub.pNext.store(nullptr, std::memory_order_relaxed);
+			Push(&m_Stub);
+
+			pNext = pTail->pNext.load(std::memory_order_acquire);
+
+			if (!pNext)
+			{
+				return false;
+			}
+		}
+
+		out = std::move(pTail->item);
+		m_pTail = pNext;
+		delete pTail;
+
+		return true;
+	}
+
+private:
+	struct Node
+	{
+		Node(void) = default;
+		explicit Node(T&& item) : item(std::move(item)) {}
+
+		std::atomic<Node*> pNext{ nullptr };
+		T item;
+	};
+
+	void Push(Node* pNode)
+	{
+		Node* pPrevious = m_pHead.exchange(pNode, std::memory_order_acq_rel);
+		pPrevious->pNext.store(pNode, std::memory_order_release);
+	}
+
+private:
+	Node m_Stub;
+
+	// The most recently pushed node, shared by every producer
+	std::atomic<Node*> m_pHead;
+
+	// The next node to be popped, only ever touched by the consumer
+	Node* m_pTail;
+};
+
+class DatabaseExecutor
+/*++
+*
+* Class Description:
+*
+*	Runs work on a thread of its own, one piece at a time and in the order it was
+*	submitted, so that whoever submits it never has to wait for it.
+*
+*	Work can either be waited for through a future, or be given a callback that runs
+*	once it is done. The callbacks are handed to the completion dispatcher, which the
+*	UI sets so that they run on its thread; if there is none, they run on the worker.
+*
+*	Nothing here depends on a window, so the executor can be used without any UI.
+*
+--*/
+{
+public:
+	using Task = std::function<void(void)>;
+	using CompletionDispatcher = std::function<void(Task)>;
+
+	DatabaseExecutor(void) = default;
+	~DatabaseExecutor(void);
+
+	DatabaseExecutor(const DatabaseExecutor&) = delete;
+	DatabaseExecutor& operator=(const DatabaseExecutor&) = delete;
+
+	void Start(void);
+	void Stop(void);
+
+	bool IsRunning(void) const { return m_Worker.joinable(); }
+	bool IsWorkerThread(void) const { return std::this_thread::get_id() == m_Worker.get_id(); }
+
+	void SetCompletionDispatcher(CompletionDispatcher dispatcher);
+
+	void Post(Task task);
+
+	template<typename F>
+	auto Submit(F work) -> std::future<decltype(work())>;
+
+	template<typename F, typename C>
+	void Submit(F work, C onDone);
+
+private:
+	void WorkerMain(void);
+	void DispatchCompletion(Task completion);
+
+private:
+	MpscQueue<Task> m_Queue;
+
+	// Number of tasks that have been pushed but not popped yet. The worker only
+	// sleeps when this is zero, and is woken up when it stops being zero.
+	std::atomic<size_t> m_cPendingTasks{ 0 };
+
+	std::mutex m_WakeMutex;
+	std::condition_variable m_WakeCondition;
+	bool m_isStopping = false;
+
+	std::mutex m_DispatcherMutex;
+	CompletionDispatcher m_Dispatcher;
+
+	std::thread m_Worker;
+};
+
+template<typename F>
+auto DatabaseExecutor::Submit(F work) -> std::future<decltype(work())>
+/*++
+*
+* Routine Description:
+*
+*	Queues work to be run on the worker thread.
+*
+* Arguments:
+*
+*	work - Callable that takes no arguments.
+*
+* Return Value:
+*
+*	Future that receives what the work returns, or the exception it throws.
+*
+--*/
+{
+	using Result = decltype(work());
+
+	auto pTask = std::make_shared<std::packaged_task<Result(void)>>(std::move(work));
+	std::future<Result> result = pTask->get_future();
+
+	Post([pTask] { (*pTask)(); });
+
+	return result;
+}
+
+template<typename F, typename C>
+void DatabaseExecutor::Submit(F work, C onDone)
+/*++
+*
+* Routine Description:
+*
+*	Queues work to be run on the worker thread, and then onDone to be run through
+*	the completion dispatcher.
+*
+* Arguments:
+*
+*	work - Callable that takes no arguments.
+*	onDone - Callable that takes a std::future of what work returns. The future is
+*	         always ready by then, and calling get() on it rethrows anything that
+*	         work has thrown.
+*
+--*/
+{
+	using Result = decltype(work());
+
+	auto pTask = std::make_shared<std::packaged_task<Result(void)>>(std::move(work));
+	auto pResult = std::make_shared<std::future<Result>>(pTask->get_future());
+
+	Post([this, pTask, pResult, onDone]() mutable {
+		(*pTask)();
+
+		DispatchCompletion([pResult, onDone]() mutable {
+			onDone(std::move(*pResult));
+		});
+	});
+}
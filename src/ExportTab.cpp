@@ -57,7 +57,7 @@ ExportTab::ExportTab(TabManager* pTabManager, const std::wstring& name)
 	m_pPeopleList = new ListView(m_hWndSelf, Size(0, 0), Point(0, 0));
 	THROW_IF_NULL(m_pPeopleList, "Out of memory");
 
-	m_pPeopleList->AddColumn(L"#", 30);
+	m_pPeopleList->AddColumn(L"#", 30, SortKeyType::INTEGER);
 	m_pPeopleList->AddColumn(L"Ιδιότητα", 160);
 	m_pPeopleList->AddColumn(L"Όνομα", 160);
 	m_pPeopleList->AddColumn(L"Επώνυμο", 160);
@@ -800,12 +800,25 @@ void ExportTab::DeleteSelectedRow(void)
 			const int iSelectedRowIndex = m_pPeopleList->GetSelectedRowIndex();
 			const int iPersonID = std::stoi(m_pPeopleList->GetCellContent(iSelectedRowIndex, 0));
 
-			// Very important that this is sent before db::DeletePerson
-			SendMessage(m_pTabManagerParent->GetTab(0)->GetHandle(), WM_DELETE_PERSON_TICKET, iPersonID, 0);
-
-			db::DeletePerson(iPersonID);
-
-			m_pPeopleList->RemoveDisplayedRow(iSelectedRowIndex);
+			// The row is only removed once the person is gone from the database, by which
+			// time it may be displayed at a different index, if at all
+			const RowHandle hRow = m_pPeopleList->GetDisplayedRowHandle(iSelectedRowIndex);
+
+			// The database thread runs the work in order, so any ticket of the person that is
+			// still waiting to be inserted is inserted first, and then deleted with the rest
+			db::Async([iPersonID] { db::DeletePersonCascade(iPersonID); }, [this, iPersonID, hRow](std::future<void> result) {
+				try
+				{
+					result.get();
+					m_pPeopleList->RemoveRows({ hRow });
+					SendMessage(m_pTabManagerParent->GetTab(0)->GetHandle(), WM_DELETE_PERSON_TICKET, iPersonID, 0);
+				}
+
+				catch (std::exception& e)
+				{
+					ShowDatabaseError(e);
+				}
+			});
 		}
 	}
 }
@@ -834,9 +847,6 @@ LRESULT ExportTab::OnCustomMessage(UINT uMsg, WPARAM wParam, LPARAM lParam)
 	case WM_PREPARE_FOR_EXPORT:
 		SetFocusToAppropriateControl();
 		break;
-
-	case WM_GET_SEARCH_HANDLE:
-		return (LRESULT)m_hSearchEdit;
 	}
 
 	return 0;
@@ -872,7 +882,7 @@ void ExportTab::ExportTicketFromEnteredData(bool perma)
 
 	if (VerifyTimes() && VerifyDates(&departureDate, &arrivalDate))
 	{
-		db::Ticket ticket = std::move(CreateTicketFromEnteredData(departureDate, arrivalDate, perma));
+		db::TicketRecord ticket = CreateTicketFromEnteredData(departureDate, arrivalDate, perma);
 
 		if (TicketRefersToExistingPerson(ticket))
 		{
@@ -981,86 +991,50 @@ bool ExportTab::VerifyDates(util::Date* depart_out, util::Date* arrival_out)
 	return true;
 }
 
-bool ExportTab::TicketRefersToExistingPerson(const db::Ticket& ticket)
+bool ExportTab::TicketRefersToExistingPerson(const db::TicketRecord& ticket)
 {
 	return true;
 }
 
-std::vector<std::wstring> ExportTab::CreateTicketFromEnteredData(util::Date& departureDate, util::Date& arrivalDate, bool perma)
+db::TicketRecord ExportTab::CreateTicketFromEnteredData(util::Date& departureDate, util::Date& arrivalDate, bool perma)
 {
 	wchar_t buffer[MAX_NOTES_LENGTH];
 
-	std::vector<std::wstring> ticket;
-	ticket.emplace_back(L"Αναμονή");
-
-	ticket.emplace_back(L"0");
-
-	ticket.emplace_back(std::to_wstring(iSelectedPersonId));
+	std::shared_ptr<db::Person> person = std::make_shared<db::Person>();
+	person->id = iSelectedPersonId;
 
 	if (IsDlgButtonChecked(m_hWndSelf, IDC_EMPLOYEE_RB)) {
-		ticket.emplace_back(L"Στέλεχος");
+		person->role = util::PersonRole::EMPLOYEE;
 	} else {
-		ticket.emplace_back(L"Κατασκηνωτής/ρια");
+		person->role = util::PersonRole::CAMPER;
 	}
 
-	/// Append first name
-
-	CharUpperBuff(buffer, GetWindowText(m_hFirstnameEdit, buffer, MAX_NOTES_LENGTH - 1));
-	ticket.emplace_back(buffer);
-
-	/// Append last name
-
-	CharUpperBuff(buffer, GetWindowText(m_hLastnameEdit, buffer, MAX_NOTES_LENGTH - 1));
-	ticket.emplace_back(buffer);
+	CharUpperBuff(person->firstname,  GetWindowText(m_hFirstnameEdit,    person->firstname,  ARRAY_SIZE(person->firstname)));
+	CharUpperBuff(person->lastname,   GetWindowText(m_hLastnameEdit,     person->lastname,   ARRAY_SIZE(person->lastname)));
+	CharUpperBuff(person->fathername, GetWindowText(m_hPaternalnameEdit, person->fathername, ARRAY_SIZE(person->fathername)));
 
-	/// Append paternal name
+	db::TicketRecord ticket;
+	ticket.state = util::TicketState::PENDING;
+	ticket.informed = false;
+	ticket.person_id = iSelectedPersonId;
+	ticket.person = std::move(person);
 
-	CharUpperBuff(buffer, GetWindowText(m_hPaternalnameEdit, buffer, MAX_NOTES_LENGTH - 1));
-	ticket.emplace_back(buffer);
-
-	/// Append departure date
-
-	swprintf_s(buffer, 127, L"%02d/%02d/%04d", departureDate.day, departureDate.month, departureDate.year);
-	ticket.emplace_back(buffer);
-
-	/// Append Departure time
+	ticket.departure_date = util::PackDate(departureDate);
 
 	GetWindowText(m_hDepartureTimeEdit, buffer, MAX_NOTES_LENGTH - 1);
-	ticket.emplace_back(buffer);
-
-	if (ticket.back().length() == 4)
-		ticket.back().insert(ticket.back().begin(), L'0');
+	ticket.departure_time = static_cast<short>(util::ConvertStringToTime(buffer));
 
+	// Permanent leaves have no return, so their arrival date and time are left unset
 	if (!perma)
 	{
-		// Append arrival date
-
-		swprintf_s(buffer, 127, L"%02d/%02d/%04d", arrivalDate.day, arrivalDate.month, arrivalDate.year);
-		ticket.emplace_back(buffer);
-
-		// Append arrival time
+		ticket.arrival_date = util::PackDate(arrivalDate);
 
 		GetWindowText(m_hArrivalTimeEdit, buffer, MAX_NOTES_LENGTH - 1);
-		ticket.emplace_back(buffer);
-
-		if (ticket.back().length() == 4)
-			ticket.back().insert(ticket.back().begin(), L'0');
+		ticket.arrival_time = static_cast<short>(util::ConvertStringToTime(buffer));
 	}
 
-	else
-	{
-		ticket.emplace_back(L"-");
-		ticket.emplace_back(L"-");
-	}
-
-	// Append actual arrival time
-
-	ticket.emplace_back(L"-");
-
-	// Append notes
-
 	GetWindowText(m_hNoteEdit, buffer, MAX_NOTES_LENGTH - 1);
-	ticket.emplace_back(buffer);
+	ticket.notes = buffer;
 
 	return ticket;
 }
@@ -1126,50 +1100,27 @@ void ExportTab::AddPersonInformationUsingControlText(void)
 	// so we have to make this conversion ourselves.
 	ConvertSpecialSigmasToCapital(information);
 
+	// The person is added to the list once the database has given them an id
 	AddPersonToDatabase(information);
 
-	// At this point we do not know which ID was assigned to the person
-	// by the DBMS, so we have to use a query to find out
-	information.id = db::GetLastInsertedRowId();
-
-	// Now that we have all the information we can add it to the list.
-	AddPersonToListView(information);
-
 	for (HWND hWnd : hWndInfoControls)
 	{
 		SetWindowText(hWnd, L"");
 	}
 }
 
-bool ExportTab::PersonExistsInDatabase(const db::Person& info)
-/*++
-* 
-* Routine Description:
-* 
-*	Checks whether there exists an entry in the database that matches the given information.
-* 
-* Arguments:
-* 
-*	info - Reference to struct containing the person's information.
-* 
---*/
-{
-	return db::GetPersonID(info) != -1;
-}
-
 void ExportTab::AddPersonToDatabase(const db::Person& info)
 /*++
 * 
 * Routine Description:
 * 
-*	Adds an entry to the database with the specified information.
+*	Adds an entry to the database with the specified information, unless the person
+*	already exists, in which case the user is told so.
 * 
-*	This function doesn't handle the case where the person already exists.
-*	If that happens, the behavior of the program depends on the implementation
-*	of the database functions.
-* 
-*	Use the PersonExistsInDatabase function before calling this function to ensure
-*	that the program behaves predictably
+*	The check and the insertion both happen on the database thread, in the same
+*	transaction, so adding the same person twice in a row never inserts them twice.
+*	Once it is done, the person is added to the list view along with the ID that was
+*	assigned to them by the DBMS.
 * 
 * Arguments:
 * 
@@ -1177,7 +1128,27 @@ void ExportTab::AddPersonToDatabase(const db::Person& info)
 * 
 --*/
 {
-	db::InsertPersonToDatabase(info);
+	db::Async([info] {
+		return db::InsertPersonIfNew(info);
+	}, [this, person = info](std::future<int> id) mutable {
+		try
+		{
+			person.id = id.get();
+
+			if (person.id == -1)
+			{
+				MessageBox(m_hWndSelf, L"Το άτομο υπάρχει ήδη.", L"Σφάλμα", MB_OK | MB_ICONERROR);
+				return;
+			}
+
+			AddPersonToListView(person);
+		}
+
+		catch (std::exception& e)
+		{
+			ShowDatabaseError(e);
+		}
+	});
 }
 
 void ExportTab::AddPersonToListView(const db::Person& info)
@@ -1282,22 +1253,6 @@ HWND ExportTab::CreateExportEditControl(const wchar_t* lpszPlaceholder, DWORD dw
 	return hEditControl;
 }
 
-void ExportTab::OnSwitchedToSelf(void)
-{
-	HWND hSearchEdit = (HWND)SendMessage(m_pTabManagerParent->GetTab(2)->GetHandle(), WM_GET_SEARCH_HANDLE, NULL, NULL);
-
-	int length = GetWindowTextLength(hSearchEdit);
-
-	wchar_t* lpszBuffer = new wchar_t[length + 1];
-
-	THROW_IF_NULL(lpszBuffer, "Out of memory");
-
-	GetWindowText(hSearchEdit, lpszBuffer, length + 1);
-	SetWindowText(m_hSearchEdit, lpszBuffer);
-
-	delete[] lpszBuffer;
-}
-
 void ExportTab::LoadPeopleFromDatabaseIntoListView(void)
 /*++
 * 
@@ -1305,24 +1260,29 @@ void ExportTab::LoadPeopleFromDatabaseIntoListView(void)
 * 
 *	Loads all the stored people from the database file into the list view.
 * 
-*	This is called upon first initializing the program.
+*	This is called upon first initializing the program. The people are read on the
+*	database thread, and added to the list once they have all been read.
 * 
 --*/
 {
-	std::vector<db::Person> peopleList;
-	db::LoadPeopleFromDatabase(peopleList);
+	db::Async([] {
+		std::vector<db::Person> peopleList;
+		db::LoadPeopleFromDatabase(peopleList);
+		return peopleList;
+	}, [this](std::future<std::vector<db::Person>> result) {
+		try
+		{
+			for (const db::Person& person : result.get())
+			{
+				AddPersonToListView(person);
+			}
+		}
 
-	for (db::Person& person : peopleList)
-	{
-		std::vector<std::wstring> row;
-		row.emplace_back(std::to_wstring(person.id));
-		row.emplace_back(util::EnumToString(person.role));
-		row.emplace_back(person.firstname);
-		row.emplace_back(person.lastname);
-		row.emplace_back(person.fathername);
-
-		m_pPeopleList->AddRow(row);
-	}
+		catch (std::exception& e)
+		{
+			ShowDatabaseError(e);
+		}
+	});
 }
 
 void ExportTab::SetFocusToAppropriateControl(void)
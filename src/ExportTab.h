@@ -20,8 +20,6 @@ protected:
 	void OnCommand(HWND hWnd) override;
 	LRESULT OnCustomMessage(UINT uMsg, WPARAM wParam, LPARAM lParam);
 
-	void OnSwitchedToSelf(void) override;
-
 private:
 	inline void CreateExportControls(void);
 	inline void CreateExportRadioButtons(void);
@@ -44,8 +42,7 @@ private:
 	inline void DrawSearchIcon(HDC hDC);
 
 	void LoadPeopleFromDatabaseIntoListView(void);
-	bool PersonExistsInDatabase(const db::Person& info);
-	bool TicketRefersToExistingPerson(const db::Ticket& ticket);
+	bool TicketRefersToExistingPerson(const db::TicketRecord& ticket);
 	void AddPersonToDatabase(const db::Person& info);
 	void AddPersonToListView(const db::Person& info);
 	void ConvertSpecialSigmasToCapital(db::Person& info);
@@ -54,7 +51,7 @@ private:
 	void AddPersonInformationUsingControlText(void);
 	void DeleteSelectedRow(void);
 
-	std::vector<std::wstring> CreateTicketFromEnteredData(util::Date& departure, util::Date& arrival, bool perma);
+	db::TicketRecord CreateTicketFromEnteredData(util::Date& departure, util::Date& arrival, bool perma);
 	bool VerifyTimes(void);
 	bool VerifyDates(util::Date* depart_out, util::Date* arrival_out);
 	void ExportTicketFromEnteredData(bool perma);
@@ -72,17 +72,17 @@ void HistoryTab::InitPersonList(void)
 	m_pHistoryList->SetColorRule(L"Στέλεχος", RGB(73, 150, 183), 2);
 	m_pHistoryList->SetColorRule(L"Κατασκηνωτής/ρια", RGB(0, 0, 255), 2);
 
-	m_pHistoryList->AddColumn(L"#", 30);
+	m_pHistoryList->AddColumn(L"#", 30, SortKeyType::INTEGER);
 	m_pHistoryList->AddColumn(L"Κατάσταση", 100);
 	m_pHistoryList->AddColumn(L"Ιδιότητα", 140);
 	m_pHistoryList->AddColumn(L"Όνομα", 140);
 	m_pHistoryList->AddColumn(L"Επώνυμο", 140);
 	m_pHistoryList->AddColumn(L"Πατρώνυμο", 140);
-	m_pHistoryList->AddColumn(L"Ημ/νια Αποχώρησης", 140);
-	m_pHistoryList->AddColumn(L"Δηλ. Ώρα Αποχ.", 100);
-	m_pHistoryList->AddColumn(L"Ημ/νια Επιστροφής", 140);
-	m_pHistoryList->AddColumn(L"Δηλ. Ώρα Επ.", 100);
-	m_pHistoryList->AddColumn(L"Ώρα Επιστροφής", 100);
+	m_pHistoryList->AddColumn(L"Ημ/νια Αποχώρησης", 140, SortKeyType::DATE);
+	m_pHistoryList->AddColumn(L"Δηλ. Ώρα Αποχ.", 100, SortKeyType::TIME);
+	m_pHistoryList->AddColumn(L"Ημ/νια Επιστροφής", 140, SortKeyType::DATE);
+	m_pHistoryList->AddColumn(L"Δηλ. Ώρα Επ.", 100, SortKeyType::TIME);
+	m_pHistoryList->AddColumn(L"Ώρα Επιστροφής", 100, SortKeyType::TIME);
 	m_pHistoryList->AddColumn(L"Σημείωση", 200);
 }
 
@@ -90,7 +90,7 @@ void HistoryTab::GetAccessToLoadedUserData(ExportTab* pExportTab)
 {
 	assert(pExportTab);
 
-	m_pPersonList->Mirror(pExportTab->m_pPeopleList);
+	m_pPersonList->ShareRows(pExportTab->m_pPeopleList);
 }
 
 void HistoryTab::OnResize(int width, int height)
@@ -190,9 +190,6 @@ LRESULT HistoryTab::OnCustomMessage(UINT uMsg, WPARAM wParam, LPARAM lParam)
 	case WM_ROW_UNSELECTED:
 		EnableWindow(m_hGetHistoryButton, FALSE);
 		break;
-
-	case WM_GET_SEARCH_HANDLE:
-		return (LRESULT)m_hPersonSearchWnd;
 	}
 
 	return 0;
@@ -206,12 +203,8 @@ void HistoryTab::FillHistoryListWithUserHistory(void)
 
 		std::wstring person_id = m_pPersonList->GetCellContent(m_pPersonList->GetSelectedRowIndex(), 0);
 
-		std::vector<db::Ticket> tickets;
-		db::GetTicketsOfPerson(std::stoi(person_id), tickets);
-
-		for (db::Ticket& ticket : tickets) {
-			m_pHistoryList->AddRow(ticket);
-		}
+		// The tickets are read from the database page by page, as they're scrolled into view
+		m_pHistoryList->SetRowProvider(std::make_unique<db::PersonTicketsProvider>(std::stoi(person_id)));
 	}
 }
 
@@ -270,20 +263,4 @@ HWND HistoryTab::CreateSearchEdit(HINSTANCE hInstance)
 	SetPlaceholderText(hSearchEdit, L"Αναζήτηση");
 
 	return hSearchEdit;
-}
-
-void HistoryTab::OnSwitchedToSelf(void)
-{
-	HWND hSearchEdit = (HWND)SendMessage(m_pTabManager->GetTab(1)->GetHandle(), WM_GET_SEARCH_HANDLE, NULL, NULL);
-
-	int length = GetWindowTextLength(hSearchEdit);
-
-	wchar_t* lpszBuffer = new wchar_t[length + 1];
-
-	THROW_IF_NULL(lpszBuffer, "Out of memory");
-
-	GetWindowText(hSearchEdit, lpszBuffer, length + 1);
-	SetWindowText(m_hPersonSearchWnd, lpszBuffer);
-
-	delete[] lpszBuffer;
 }
\ No newline at end of file
@@ -16,7 +16,6 @@ protected:
 	void OnCommand(HWND hWnd) override;
 	LRESULT OnCustomMessage(UINT uMsg, WPARAM wParam, LPARAM lParam) override;
 	void Draw(HDC hDC) override;
-	void OnSwitchedToSelf(void) override;
 	void OnSwitchedToOther(void) override;
 
 	HWND CreateSearchEdit(HINSTANCE hInstance);
@@ -1,6 +1,7 @@
 ﻿#include "ListView.h"
 #include "Utility.h"
 #include "Renderer.h"
+#include "TextSearch.h"
 
 
 #include <CommCtrl.h>
@@ -10,6 +11,8 @@
 #include <cassert>
 #include <stdexcept>
 #include <algorithm>
+#include <chrono>
+#include <cwchar>
 
 #define MINIMUM_COLUMN_WIDTH 30
 
@@ -17,6 +20,9 @@
 #define COLOR_ROW_HOVERING   RGB(240, 240, 240)
 #define COLOR_ROW_SELECTED   RGB(230, 230, 230)
 
+// How many frames are painted between two reports of how long they took
+#define FRAME_TIME_REPORT_INTERVAL 120
+
 LRESULT CALLBACK ListViewProcedure(HWND hWnd, UINT uMsg, WPARAM wParam, LPARAM lParam)
 /*++
 *
@@ -131,8 +137,9 @@ ListView::ListView(HWND hParentWindow, Size size, Point ptPos)
 	cyRow            = cyLabelBar - static_cast<size_t>(6 * lfDpiScale);
 	cxScrollbarWidth = static_cast<size_t>(20.0 * lfDpiScale);
 
-	m_refIndexesOfShownRows = &m_IndexesOfShownRows;
-	m_refRows = &m_Rows;
+	m_pRows = std::make_shared<RowStore>();
+	m_pRows->AddListener(this);
+	m_pRowProvider = m_pRows.get();
 
 	RegisterViewListClass(hInstance);
 	InitializeViewListWindow(hInstance);
@@ -163,7 +170,37 @@ void ListView::InitializeGraphicsResources(void)
 		throw std::runtime_error("Unable to create GDI Font for ListView");
 	}
 
-	m_pRenderTarget = render::CreateWindowRenderTarget(m_hWndSelf);
+	// The GDI font's height includes its internal leading while a DirectWrite font's size
+	// doesn't, so the text format is made as large as the characters of the font actually are
+	TEXTMETRIC tm = {};
+	HDC hDC = GetDC(m_hWndSelf);
+	HGDIOBJ hOldFont = SelectObject(hDC, m_hFont);
+	GetTextMetrics(hDC, &tm);
+	SelectObject(hDC, hOldFont);
+	ReleaseDC(m_hWndSelf, hDC);
+
+	m_pTextFormat = render::CreateTextFormat(L"Segoe UI", static_cast<float>(tm.tmHeight - tm.tmInternalLeading), L"el-GR");
+
+	if (m_pTextFormat)
+	{
+		m_pTextFormat->SetTextAlignment(DWRITE_TEXT_ALIGNMENT_CENTER);
+		m_pTextFormat->SetParagraphAlignment(DWRITE_PARAGRAPH_ALIGNMENT_CENTER);
+		m_pTextFormat->SetWordWrapping(DWRITE_WORD_WRAPPING_NO_WRAP);
+
+		// Text that doesn't fit ends in "...", like it does with DT_END_ELLIPSIS
+		IDWriteInlineObject* pEllipsis = render::CreateEllipsisTrimmingSign(m_pTextFormat);
+		DWRITE_TRIMMING trimming = { DWRITE_TRIMMING_GRANULARITY_CHARACTER, 0, 0 };
+		m_pTextFormat->SetTrimming(&trimming, pEllipsis);
+		SAFE_RELEASE_D2D(pEllipsis);
+	}
+
+	else
+	{
+		m_TextRenderer = TextRenderer::GDI;
+	}
+
+	// What was drawn is kept, so that only the parts of the list that change have to be drawn again
+	m_pRenderTarget = render::CreateWindowRenderTarget(m_hWndSelf, D2D1_PRESENT_OPTIONS_RETAIN_CONTENTS);
 
 	if (!m_pRenderTarget)
 	{
@@ -352,6 +389,8 @@ void ListView::FitScrollbarsToClient(void)
 
 ListView::~ListView(void)
 {
+	m_pRows->RemoveListener(this);
+
 	ReleaseGraphicsResources();
 }
 
@@ -378,9 +417,17 @@ void ListView::ReleaseGraphicsResources(void)
 		m_hFont = nullptr;
 	}
 
+	m_CellLayouts.Clear();
+	m_TextLayouts.Clear();
+
+	SAFE_RELEASE_D2D(m_pTextFormat);
+	m_pTextFormat = nullptr;
+
 	SAFE_RELEASE_D2D(m_pRenderTarget);
 	SAFE_RELEASE_D2D(m_pGDIRT);
 	SAFE_RELEASE_D2D(m_pSolidColorBrush);
+	SAFE_RELEASE_D2D(m_pScrollBitmap);
+	m_pScrollBitmap = nullptr;
 }
 
 LRESULT ListView::OnPaint(void)
@@ -388,7 +435,12 @@ LRESULT ListView::OnPaint(void)
 * 
 * Routine Description:
 * 
-*	Draws the column labels.
+*	Draws the list, either with Direct2D only or partly with GDI, see TextRenderer.
+*	How long it takes is reported every so often for each of the two.
+* 
+*	Only the area that needs painting is drawn. The render target keeps what was drawn
+*	before, and after scrolling, the rows that are still on screen are moved in it
+*	first, so that only the rows that came into view are in that area.
 * 
 * Arguments:
 * 
@@ -406,50 +458,239 @@ LRESULT ListView::OnPaint(void)
 	
 	if (m_pGDIRT && m_pRenderTarget)
 	{
+		const auto frameStart = std::chrono::steady_clock::now();
+		const TextRenderer renderer = m_TextRenderer;
+
 		const size_t uSelfHeight = GetHeight();
 		const size_t uSelfWidth = GetWidth();
 
 		BeginPaint(m_hWndSelf, &ps);
 		m_pRenderTarget->BeginDraw();
+		m_pRenderTarget->SetTransform(D2D1::Matrix3x2F::Identity());
+
+		RECT rcPaint = ps.rcPaint;
+
+		if (!m_isLastFrameRetained || (m_cyPendingScroll != 0 && !BlitScrolledRows()))
+		{
+			GetClientRect(m_hWndSelf, &rcPaint);
+		}
+
+		m_cyPendingScroll = 0;
+
+		m_pRenderTarget->PushAxisAlignedClip(
+			D2D1::RectF(rcPaint.left, rcPaint.top, rcPaint.right, rcPaint.bottom),
+			D2D1_ANTIALIAS_MODE_ALIASED
+		);
 
 		// These functions must be called before m_pGDIRT->GetDC
 		// Otherwise the planet will literally explode.
 		DrawBackground(uSelfWidth, uSelfHeight);
 		DrawRowBackground(uSelfWidth, uSelfHeight);
 
-		hr = m_pGDIRT->GetDC(D2D1_DC_INITIALIZE_MODE_COPY, &hDC);
-
-		if (SUCCEEDED(hr))
+		if (renderer == TextRenderer::DIRECTWRITE)
 		{
-			SelectObject(hDC, m_hFont);
-
-			DrawRows(hDC, uSelfWidth, uSelfHeight);
-			DrawLabelBar(hDC, uSelfWidth, uSelfHeight);
-			DrawColumns(hDC, uSelfWidth, uSelfHeight);
+			// Never getting a DC lets Direct2D keep everything in one batch, rather than
+			// having to hand the surface over to GDI halfway through the frame
+			DrawRows(uSelfWidth, uSelfHeight, rcPaint);
+			DrawLabelBar(uSelfWidth, uSelfHeight);
+			DrawColumns(uSelfWidth, uSelfHeight);
 
 			// Square at the bottom right corner below the scrollbars.
-			SetDCBrushColor(hDC, RGB(230, 230, 230));
-			SetDCPenColor(hDC, RGB(230, 230, 230));
-
-			Rectangle(
-				hDC,
-				static_cast<int>(GetWidth() - cxScrollbarWidth),
-				static_cast<int>(GetHeight() - cxScrollbarWidth),
-				static_cast<int>(GetWidth() - 1),
-				static_cast<int>(GetHeight() - 1)
+			DrawBorderedRectangle(
+				static_cast<int>(uSelfWidth - cxScrollbarWidth),
+				static_cast<int>(uSelfHeight - cxScrollbarWidth),
+				static_cast<int>(uSelfWidth - 1),
+				static_cast<int>(uSelfHeight - 1),
+				RGB(230, 230, 230),
+				RGB(230, 230, 230)
 			);
 
-			m_pGDIRT->ReleaseDC(NULL);
+			m_pRenderTarget->PopAxisAlignedClip();
 		}
 
-		m_pRenderTarget->EndDraw();
+		else
+		{
+			// A DC can't be taken while a clip is pushed, so GDI is clipped on its own
+			m_pRenderTarget->PopAxisAlignedClip();
+
+			hr = m_pGDIRT->GetDC(D2D1_DC_INITIALIZE_MODE_COPY, &hDC);
+
+			if (SUCCEEDED(hr))
+			{
+				SelectObject(hDC, m_hFont);
+				IntersectClipRect(hDC, rcPaint.left, rcPaint.top, rcPaint.right, rcPaint.bottom);
+
+				DrawRows(hDC, uSelfWidth, uSelfHeight, rcPaint);
+				DrawLabelBar(hDC, uSelfWidth, uSelfHeight);
+				DrawColumns(hDC, uSelfWidth, uSelfHeight);
+
+				// Square at the bottom right corner below the scrollbars.
+				SetDCBrushColor(hDC, RGB(230, 230, 230));
+				SetDCPenColor(hDC, RGB(230, 230, 230));
+
+				Rectangle(
+					hDC,
+					static_cast<int>(GetWidth() - cxScrollbarWidth),
+					static_cast<int>(GetHeight() - cxScrollbarWidth),
+					static_cast<int>(GetWidth() - 1),
+					static_cast<int>(GetHeight() - 1)
+				);
+
+				m_pGDIRT->ReleaseDC(NULL);
+			}
+		}
+
+		hr = m_pRenderTarget->EndDraw();
+		m_isLastFrameRetained = SUCCEEDED(hr);
 
 		EndPaint(m_hWndSelf, &ps);
+
+		RecordFrameTime(renderer, std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - frameStart).count());
 	}
 
 	return 0;
 }
 
+bool ListView::BlitScrolledRows(void)
+/*++
+* 
+* Routine Description:
+* 
+*	Moves the rows that were drawn in the last frame by as much as the list has been
+*	scrolled since, like ScrollWindowEx does with the pixels of a window. Only the
+*	rows that came into view are left to be drawn, and ScrollRowsTo will have
+*	invalidated exactly those.
+* 
+* Arguments:
+* 
+*	None.
+* 
+* Return Value:
+* 
+*	Whether the rows were moved. If they weren't, they all have to be drawn again.
+* 
+--*/
+{
+	const RECT rcRows = GetRowsRect();
+	const int cxRows = rcRows.right - rcRows.left;
+	const int cyRows = rcRows.bottom - rcRows.top;
+	const int cyMoved = std::abs(m_cyPendingScroll);
+
+	if (!m_isLastFrameRetained || cxRows <= 0 || cyMoved >= cyRows)
+	{
+		return false;
+	}
+
+	// The bitmap is only made again when the size of the list changes
+	if (m_pScrollBitmap)
+	{
+		const D2D1_SIZE_U size = m_pScrollBitmap->GetPixelSize();
+
+		if (size.width != static_cast<UINT32>(cxRows) || size.height != static_cast<UINT32>(cyRows))
+		{
+			SAFE_RELEASE_D2D(m_pScrollBitmap);
+			m_pScrollBitmap = nullptr;
+		}
+	}
+
+	if (!m_pScrollBitmap)
+	{
+		m_pRenderTarget->CreateBitmap(
+			D2D1::SizeU(cxRows, cyRows),
+			D2D1::BitmapProperties(m_pRenderTarget->GetPixelFormat()),
+			&m_pScrollBitmap
+		);
+
+		if (!m_pScrollBitmap)
+		{
+			return false;
+		}
+	}
+
+	// The rows that stay on screen, before and after they're moved
+	const int ySourceTop = (m_cyPendingScroll > 0) ? rcRows.top + cyMoved : rcRows.top;
+	const int yDestinationTop = (m_cyPendingScroll > 0) ? rcRows.top : rcRows.top + cyMoved;
+	const int cyKept = cyRows - cyMoved;
+
+	const D2D1_POINT_2U ptOrigin = D2D1::Point2U(0, 0);
+	const D2D1_RECT_U rcSource = D2D1::RectU(rcRows.left, ySourceTop, rcRows.right, ySourceTop + cyKept);
+
+	if (FAILED(m_pScrollBitmap->CopyFromRenderTarget(&ptOrigin, m_pRenderTarget, &rcSource)))
+	{
+		return false;
+	}
+
+	m_pRenderTarget->DrawBitmap(
+		m_pScrollBitmap,
+		D2D1::RectF(rcRows.left, yDestinationTop, rcRows.right, yDestinationTop + cyKept),
+		1.0F,
+		D2D1_BITMAP_INTERPOLATION_MODE_NEAREST_NEIGHBOR,
+		D2D1::RectF(0, 0, cxRows, cyKept)
+	);
+
+	return true;
+}
+
+void ListView::RecordFrameTime(TextRenderer renderer, double msFrame)
+/*++
+* 
+* Routine Description:
+* 
+*	Adds the time a frame took to paint to the ones of the same renderer, and once
+*	enough frames have been painted, sends their average and slowest time to the
+*	debugger.
+* 
+* Arguments:
+* 
+*	renderer - The renderer the frame was painted with.
+*	msFrame - How long painting the frame took, in milliseconds.
+* 
+* Return Value:
+* 
+*	None.
+* 
+--*/
+{
+	FrameTimes& times = m_FrameTimes[static_cast<size_t>(renderer)];
+
+	++times.cFrames;
+	times.msTotal += msFrame;
+	times.msSlowest = (std::max)(times.msSlowest, msFrame);
+
+	if (times.cFrames == FRAME_TIME_REPORT_INTERVAL)
+	{
+		wchar_t szReport[128];
+
+		std::swprintf(
+			szReport,
+			sizeof(szReport) / sizeof(szReport[0]),
+			L"ListView (%ls): %zu frames, %.3f ms on average, %.3f ms at most\n",
+			renderer == TextRenderer::DIRECTWRITE ? L"DirectWrite" : L"GDI",
+			times.cFrames,
+			times.msTotal / times.cFrames,
+			times.msSlowest
+		);
+
+		OutputDebugString(szReport);
+
+		times = FrameTimes();
+	}
+}
+
+void ListView::SetTextRenderer(TextRenderer renderer)
+{
+	if (renderer == TextRenderer::DIRECTWRITE && !m_pTextFormat)
+	{
+		renderer = TextRenderer::GDI;
+	}
+
+	if (renderer != m_TextRenderer)
+	{
+		m_TextRenderer = renderer;
+		InvalidateRect(m_hWndSelf, NULL, FALSE);
+	}
+}
+
 void ListView::DrawBackground(size_t uWidth, size_t uHeight)
 {
 	m_pSolidColorBrush->SetColor(D2D1::ColorF(0xFF, 0xFF, 0xFF));
@@ -485,32 +726,35 @@ void ListView::DrawRowBackground(size_t uWidth, size_t uHeight)
 {
 	m_pSolidColorBrush->SetColor(D2D1::ColorF(COLOR_ROW_UNSELECTED));
 
-	// We'll use a transformation here because if the window has been
-	// scrolled, the rectangle must be drawn in a different position.
-	m_pRenderTarget->SetTransform(D2D1::Matrix3x2F::Translation(
-		D2D1::SizeF(0, m_cyOffset)
-	));
+	// Only the part of the rows that is on screen, since the rows of a long
+	// list may be far more pixels tall than a float can count exactly
+	const int64_t yRowsTop = static_cast<int64_t>(cyLabelBar) + m_VertScroll.GetRowTop(0);
+	const int64_t yRowsBottom = static_cast<int64_t>(cyLabelBar) + m_VertScroll.GetRowTop(m_IndexesOfShownRows.size());
 
-	m_pRenderTarget->FillRectangle(
-		D2D1::RectF(1, cyLabelBar, uWidth - cxScrollbarWidth, cyLabelBar + m_refIndexesOfShownRows->size() * cyRow),
-		m_pSolidColorBrush);
+	const float yTop = static_cast<float>((std::max)(yRowsTop, static_cast<int64_t>(cyLabelBar)));
+	const float yBottom = static_cast<float>((std::min)(yRowsBottom, static_cast<int64_t>(uHeight)));
 
-	// Reset the transformation
-	m_pRenderTarget->SetTransform(D2D1::Matrix3x2F::Translation(D2D1::SizeF(0, 0)));
+	if (yBottom > yTop)
+	{
+		m_pRenderTarget->FillRectangle(
+			D2D1::RectF(1, yTop, uWidth - cxScrollbarWidth, yBottom),
+			m_pSolidColorBrush);
+	}
 }
 
-void ListView::DrawRows(HDC hDC, size_t uWidth, size_t uHeight)
+void ListView::DrawRows(HDC hDC, size_t uWidth, size_t uHeight, const RECT& rcPaint)
 /*++
 *
 * Routine Description:
 *
-*	Draws every single visible row.
+*	Draws every visible row that is at least partly in the area being painted.
 *
 * Arguments:
 *
 *	hDC - Handle to the device context
 *	uWidth - ListView width.
 *	uHeight - ListView height.
+*	rcPaint - The area being painted.
 *
 * Return Value:
 *
@@ -528,20 +772,12 @@ void ListView::DrawRows(HDC hDC, size_t uWidth, size_t uHeight)
 	SetDCBrushColor(hDC, COLOR_ROW_UNSELECTED);
 	SetDCPenColor(hDC, COLOR_ROW_UNSELECTED);
 	
-	SetViewportOrgEx(hDC, m_cxOffset, m_cyOffset, &ptOldOrigin);
+	SetViewportOrgEx(hDC, m_cxOffset, 0, &ptOldOrigin);
 	
-	// The index of the first row that is visible on screen
-	// We're basically calculating how many rows have been scrolled off screen by
-	// dividing the vertical offset with the row height
-	const int indexFirstRowVisible = min(-(m_cyOffset / (int)cyRow), (int)m_refIndexesOfShownRows->size());
-
-	// The index of the last row that is visible on screen
-	const int indexLastRowVisible = min(
-		((int)m_refIndexesOfShownRows->size()) + indexFirstRowVisible - GetExtraRowsOffScreenCount() + 1,
-		(int)m_refIndexesOfShownRows->size()
-	);
+	size_t indexFirstRow, indexRowsEnd;
+	m_VertScroll.GetRowsBetween(rcPaint.top - (int)cyLabelBar, rcPaint.bottom - (int)cyLabelBar, indexFirstRow, indexRowsEnd);
 
-	for (int i = indexFirstRowVisible; i < indexLastRowVisible; ++i)
+	for (size_t i = indexFirstRow; i < indexRowsEnd; ++i)
 	{
 		DrawRow(hDC, uWidth, uHeight, i);
 	}
@@ -571,10 +807,10 @@ void ListView::DrawRow(HDC hDC, size_t uWidth, size_t uHeight, size_t index)
 {
 	COLORREF crSpecialRow;
 
-	assert(index < m_refIndexesOfShownRows->size());
+	assert(index < m_IndexesOfShownRows.size());
 
 	// Top point of the given row in client coordinates
-	const int iRowTop = static_cast<int>(cyRow * index + cyLabelBar);
+	const int iRowTop = GetRowTop(index);
 
 	// In the case that a row is selected or hovered by the cursor, we'll draw
 	// a different color below it to indicate such event to the user.
@@ -586,7 +822,7 @@ void ListView::DrawRow(HDC hDC, size_t uWidth, size_t uHeight, size_t index)
 		SetDCBrushColor(hDC, crSpecialRow);
 
 		// We don't want any horizontal offset in this case
-		SetViewportOrgEx(hDC, 0, m_cyOffset, NULL);
+		SetViewportOrgEx(hDC, 0, 0, NULL);
 
 		Rectangle(
 			hDC,
@@ -599,17 +835,21 @@ void ListView::DrawRow(HDC hDC, size_t uWidth, size_t uHeight, size_t index)
 		SetDCBrushColor(hDC, COLOR_ROW_UNSELECTED);
 
 		// Reset the viewport
-		SetViewportOrgEx(hDC, m_cxOffset, m_cyOffset, NULL);
+		SetViewportOrgEx(hDC, m_cxOffset, 0, NULL);
 	}
 
+	const size_t iRowIndex = static_cast<size_t>(m_IndexesOfShownRows[index]);
+
 	// It is possible that a column may not have been used by a row
 	// This could happen if for example a column was added after a row
 	// This is why we do the folllowing
-	size_t usedColumnCount = min(m_Columns.size(), (*m_refRows)[(*m_refIndexesOfShownRows)[index]].size());
+	size_t usedColumnCount = min(m_Columns.size(), m_pRowProvider->GetCellCount(iRowIndex));
 
 	// The x coordinate in client terms of the next line to be drawn vertically to seperate columns
 	int iNextLineX = 0;
 
+	GdiTextMeasurer measurer(hDC);
+
 	for (size_t i = 0; i < usedColumnCount; ++i)
 	{
 		iNextLineX += m_Columns[i].cxWidth;
@@ -620,14 +860,23 @@ void ListView::DrawRow(HDC hDC, size_t uWidth, size_t uHeight, size_t index)
 		rcText.top = iRowTop;
 		rcText.bottom = iRowTop + cyRow;
 
-		SetTextColor(hDC, GetWordColor((*m_refRows)[(*m_refIndexesOfShownRows)[index]][i], i));
+		const std::wstring& cell = m_pRowProvider->GetCell(iRowIndex, i);
 
-		DrawText(
+		SetTextColor(hDC, m_CellColors.GetColor(*m_pRowProvider, iRowIndex, i));
+
+		// Centered in the cell, like DrawText with DT_CENTER and DT_VCENTER would, but without
+		// measuring the text and working out where to cut it short every time it's drawn
+		const CellLayout& layout = m_CellLayouts.GetLayout(measurer, cell, m_Columns[i].cxWidth);
+
+		ExtTextOut(
 			hDC,
-			(*m_refRows)[(*m_refIndexesOfShownRows)[index]][i].c_str(),
-			(*m_refRows)[(*m_refIndexesOfShownRows)[index]][i].length(),
+			rcText.left + (m_Columns[i].cxWidth - layout.extent.cx) / 2,
+			rcText.top + (static_cast<int>(cyRow) - layout.extent.cy) / 2,
+			ETO_CLIPPED,
 			&rcText,
-			DT_CENTER | DT_END_ELLIPSIS | DT_VCENTER | DT_SINGLELINE
+			layout.text.c_str(),
+			static_cast<UINT>(layout.text.length()),
+			NULL
 		);
 	}
 }
@@ -752,6 +1001,206 @@ void ListView::DrawColumns(HDC hDC, size_t uWidth, size_t uHeight)
 	SetViewportOrgEx(hDC, 0, 0, NULL);
 }
 
+static D2D1_COLOR_F ColorFromCOLORREF(COLORREF cr)
+{
+	return D2D1::ColorF(GetRValue(cr) / 255.0F, GetGValue(cr) / 255.0F, GetBValue(cr) / 255.0F);
+}
+
+void ListView::FillArea(float left, float top, float right, float bottom, COLORREF cr)
+{
+	m_pSolidColorBrush->SetColor(ColorFromCOLORREF(cr));
+	m_pRenderTarget->FillRectangle(D2D1::RectF(left, top, right, bottom), m_pSolidColorBrush);
+}
+
+void ListView::DrawBorderedRectangle(int left, int top, int right, int bottom, COLORREF crFill, COLORREF crBorder)
+/*++
+* 
+* Routine Description:
+* 
+*	Draws the same pixels GDI's Rectangle does with a one pixel wide pen, so that
+*	both renderers draw the list the same way.
+* 
+* Arguments:
+* 
+*	left, top, right, bottom - The rectangle, which doesn't include its right and bottom edge.
+*	crFill - The color inside the border.
+*	crBorder - The color of the border.
+* 
+* Return Value:
+* 
+*	None.
+* 
+--*/
+{
+	if (right <= left || bottom <= top)
+	{
+		return;
+	}
+
+	FillArea(left, top, right, bottom, crBorder);
+
+	if (crFill != crBorder)
+	{
+		FillArea(left + 1, top + 1, right - 1, bottom - 1, crFill);
+	}
+}
+
+void ListView::DrawRows(size_t uWidth, size_t uHeight, const RECT& rcPaint)
+{
+	size_t indexFirstRow, indexRowsEnd;
+	m_VertScroll.GetRowsBetween(rcPaint.top - (int)cyLabelBar, rcPaint.bottom - (int)cyLabelBar, indexFirstRow, indexRowsEnd);
+
+	for (size_t i = indexFirstRow; i < indexRowsEnd; ++i)
+	{
+		DrawRow(uWidth, uHeight, i);
+	}
+
+	m_pRenderTarget->SetTransform(D2D1::Matrix3x2F::Identity());
+}
+
+void ListView::DrawRow(size_t uWidth, size_t uHeight, size_t index)
+/*++
+* 
+* Routine Description:
+* 
+*	Draws the row specified, like DrawRow(HDC, ...) does. Only the cells of the columns
+*	that are on screen are drawn, each with the layout that was made for its text the
+*	first time it was drawn in a column of the same width.
+* 
+* Arguments:
+* 
+*	uWidth - Width of the ListView
+*	uHeight - Height of the ListView
+*	index - Index of data in IndexesOfShownRows
+* 
+* Return Value:
+* 
+*	None.
+* 
+--*/
+{
+	assert(index < m_IndexesOfShownRows.size());
+
+	const int iRowTop = GetRowTop(index);
+
+	if (m_iHoveringRowIndex == static_cast<int>(index) || m_iSelectedIndex == static_cast<int>(index))
+	{
+		const COLORREF crSpecialRow = (m_iSelectedIndex == static_cast<int>(index) ? COLOR_ROW_SELECTED : COLOR_ROW_HOVERING);
+
+		// We don't want any horizontal offset in this case
+		m_pRenderTarget->SetTransform(D2D1::Matrix3x2F::Identity());
+
+		DrawBorderedRectangle(1, iRowTop, static_cast<int>(uWidth - 1), iRowTop + static_cast<int>(cyRow), crSpecialRow, COLOR_ROW_UNSELECTED);
+	}
+
+	m_pRenderTarget->SetTransform(D2D1::Matrix3x2F::Translation(static_cast<float>(m_cxOffset), 0));
+
+	const size_t iRowIndex = static_cast<size_t>(m_IndexesOfShownRows[index]);
+	const size_t usedColumnCount = (std::min)(m_Columns.size(), m_pRowProvider->GetCellCount(iRowIndex));
+
+	int iNextLineX = 0;
+
+	for (size_t i = 0; i < usedColumnCount; ++i)
+	{
+		iNextLineX += m_Columns[i].cxWidth;
+
+		const int iLeft = iNextLineX - m_Columns[i].cxWidth;
+
+		if (iNextLineX + m_cxOffset <= 0 || iLeft + m_cxOffset >= (int)uWidth)
+		{
+			continue;
+		}
+
+		const std::wstring& cell = m_pRowProvider->GetCell(iRowIndex, i);
+		IDWriteTextLayout* pLayout = m_TextLayouts.GetLayout(m_pTextFormat, cell, m_Columns[i].cxWidth, static_cast<int>(cyRow));
+
+		if (pLayout)
+		{
+			m_pSolidColorBrush->SetColor(ColorFromCOLORREF(m_CellColors.GetColor(*m_pRowProvider, iRowIndex, i)));
+			m_pRenderTarget->DrawTextLayout(
+				D2D1::Point2F(static_cast<float>(iLeft), static_cast<float>(iRowTop)),
+				pLayout,
+				m_pSolidColorBrush,
+				D2D1_DRAW_TEXT_OPTIONS_CLIP
+			);
+		}
+	}
+}
+
+void ListView::DrawLabelBar(size_t uWidth, size_t uHeight)
+{
+	const int cxSelf = static_cast<int>(uWidth);
+	const int cySelf = static_cast<int>(uHeight);
+	const int cyBar = static_cast<int>(cyLabelBar);
+
+	// Top and bottom half of the label bar rectangle
+	DrawBorderedRectangle(1, 1, cxSelf - 1, cyBar / 2 + 1, RGB(240, 240, 240), RGB(230, 230, 230));
+	DrawBorderedRectangle(1, cyBar / 2 + 1, cxSelf - 1, cyBar, RGB(230, 230, 230), RGB(230, 230, 230));
+
+	if (m_iHoveredColumnLabel != ROW_INDEX_NONE)
+	{
+		m_pRenderTarget->SetTransform(D2D1::Matrix3x2F::Translation(static_cast<float>(m_cxOffset), 0));
+
+		const int iHoveredColumnPos = GetRelativeColumnHorizontalPosition(m_iHoveredColumnLabel);
+		const int iLeft = (std::max)(iHoveredColumnPos + 1, 1 - m_cxOffset);
+		const int iRight = (std::min)(iHoveredColumnPos + m_Columns[m_iHoveredColumnLabel].cxWidth, cxSelf - m_cxOffset - 1);
+
+		const bool isClicked = (m_iClickedColumnLabel != ROW_INDEX_NONE);
+		const COLORREF crTop = isClicked ? RGB(230, 230, 230) : RGB(235, 235, 235);
+		const COLORREF crBottom = isClicked ? RGB(220, 220, 220) : RGB(225, 225, 225);
+
+		DrawBorderedRectangle(iLeft, 1, iRight, cyBar / 2 + 1, crTop, crBottom);
+		DrawBorderedRectangle(iLeft, cyBar / 2 + 1, iRight, cyBar, crBottom, crBottom);
+
+		m_pRenderTarget->SetTransform(D2D1::Matrix3x2F::Identity());
+	}
+
+	// Line below the label bar
+	FillArea(0, cyBar, cxSelf, cyBar + 1, RGB(109, 131, 147));
+
+	// Top, bottom and right edge
+	FillArea(0, 0, cxSelf, 1, RGB(128, 154, 173));
+	FillArea(0, cySelf - 1, cxSelf, cySelf, RGB(128, 154, 173));
+	FillArea(cxSelf - 1, cyBar, cxSelf, cySelf - 1, RGB(128, 154, 173));
+}
+
+void ListView::DrawColumns(size_t uWidth, size_t uHeight)
+{
+	m_pRenderTarget->SetTransform(D2D1::Matrix3x2F::Translation(static_cast<float>(m_cxOffset), 0));
+
+	int iNextLineX = 0;
+
+	for (size_t i = 0; i < m_Columns.size(); ++i)
+	{
+		const ColumnInfo& column = m_Columns[i];
+
+		iNextLineX += column.cxWidth;
+
+		if (iNextLineX + m_cxOffset <= 0 || iNextLineX + m_cxOffset - column.cxWidth >= (int)uWidth)
+		{
+			continue;
+		}
+
+		// The line to the right of the column
+		FillArea(iNextLineX, 0, iNextLineX + 1, uHeight - cxScrollbarWidth, RGB(128, 154, 173));
+
+		IDWriteTextLayout* pLayout = m_TextLayouts.GetLayout(m_pTextFormat, column.strName, column.cxWidth, static_cast<int>(cyLabelBar));
+
+		if (pLayout)
+		{
+			m_pSolidColorBrush->SetColor(D2D1::ColorF(0, 0, 0));
+			m_pRenderTarget->DrawTextLayout(
+				D2D1::Point2F(static_cast<float>(iNextLineX - column.cxWidth), 0),
+				pLayout,
+				m_pSolidColorBrush,
+				D2D1_DRAW_TEXT_OPTIONS_CLIP
+			);
+		}
+	}
+
+	m_pRenderTarget->SetTransform(D2D1::Matrix3x2F::Identity());
+}
+
 LRESULT ListView::OnEraseBackground(HDC hDC)
 {
 	return FALSE; // FALSE means we didn't erase the background.
@@ -855,7 +1304,12 @@ LRESULT ListView::OnSize(WORD newWidth, WORD newHeight)
 		render::FitRenderTargetToClient(m_pRenderTarget);
 	}
 
+	// Resizing the render target throws away what was drawn in it
+	m_isLastFrameRetained = false;
+	m_cyPendingScroll = 0;
+
 	FitScrollbarsToClient();
+	UpdateVerticalScrollbar();
 
 	return 0;
 }
@@ -1038,9 +1492,14 @@ void ListView::HandleRowHovering(int iCursorY)
 	m_canDrag = false;
 
 	// The index of the row the cursor is hovering over
-	m_iHoveringRowIndex = static_cast<int>((iCursorY - cyLabelBar - m_cyOffset) / cyRow);
+	size_t hoveredRow;
 
-	if (m_iHoveringRowIndex >= static_cast<int>(m_refIndexesOfShownRows->size())) 
+	if (m_VertScroll.GetRowAt(iCursorY - static_cast<int>(cyLabelBar), hoveredRow) && hoveredRow < m_IndexesOfShownRows.size())
+	{
+		m_iHoveringRowIndex = static_cast<int>(hoveredRow);
+	}
+
+	else
 	{
 		m_iHoveringRowIndex = ROW_INDEX_NONE;
 	}
@@ -1049,12 +1508,12 @@ void ListView::HandleRowHovering(int iCursorY)
 
 	if (iPrevHovering != m_iHoveringRowIndex)
 	{
-		if (iPrevHovering != ROW_INDEX_NONE && iPrevHovering < m_refRows->size())
+		if (iPrevHovering != ROW_INDEX_NONE && iPrevHovering < m_IndexesOfShownRows.size())
 		{
 			InvalidateRow(iPrevHovering);
 		}
 
-		if (m_iHoveringRowIndex != ROW_INDEX_NONE && m_iHoveringRowIndex < m_refRows->size())
+		if (m_iHoveringRowIndex != ROW_INDEX_NONE && m_iHoveringRowIndex < m_IndexesOfShownRows.size())
 		{
 			InvalidateRow(m_iHoveringRowIndex);
 		}
@@ -1089,11 +1548,13 @@ LRESULT ListView::OnLeftMouseUp(WPARAM wParam, LPARAM lParam)
 * 
 * Routine Description:
 * 
-*	Stops resizing the column that may have been being resized.
+*	Stops resizing the column that may have been being resized, or sorts the rows by the
+*	column whose label was clicked. Holding shift sorts them by that column as well as the
+*	ones they were already sorted by.
 * 
 * Arguments:
 * 
-*	wParam
+*	wParam - Which virtual keys are down.
 *	lParam
 * 
 * Return Code:
@@ -1109,7 +1570,7 @@ LRESULT ListView::OnLeftMouseUp(WPARAM wParam, LPARAM lParam)
 			PostMessage(m_hWndParent, WM_ROW_UNSELECTED, NULL, NULL);
 		}
 
-		SortColumnData(m_iClickedColumnLabel);
+		SortColumnData(m_iClickedColumnLabel, (wParam & MK_SHIFT) != 0);
 		m_iSelectedIndex = ROW_INDEX_NONE;
 		m_iClickedColumnLabel = COLUMN_INDEX_NONE;
 	}
@@ -1131,8 +1592,8 @@ LRESULT ListView::OnVScroll(WORD scrollType, WORD scrollPosition)
 *	scrollType - Code showing how the user scrolled, For example: SB_LINEDOWN means the user
 *                clicked the down arrow, SB_THUMBTRACK means the user is dragging the thumb, etc.
 *
-*	scrollPosition - If scrollType is SB_THUMBTRACK, then this is the position of the thumb in the range [0, nMax]
-*                    nMax can be retrieved using the GetScrollInfo function.
+*	scrollPosition - Unused. It only has 16 bits, so the position of the thumb is read from the
+*                    scrollbar instead, which lets lists taller than 65535 units be scrolled through.
 * 
 * Return Value:
 * 
@@ -1140,53 +1601,111 @@ LRESULT ListView::OnVScroll(WORD scrollType, WORD scrollPosition)
 * 
 --*/
 {
-	const int iExtraRowsOffscreen = GetExtraRowsOffScreenCount();
+	// A page is as many whole rows as fit on screen, but never less than one
+	const int64_t cyPage = (std::max)(m_VertScroll.GetViewportHeight() / (int)cyRow, 1) * static_cast<int64_t>(cyRow);
 
-	if (iExtraRowsOffscreen > 0)
+	int64_t position = m_VertScroll.GetPosition();
+
+	switch (scrollType)
 	{
-		int iOldCyOffset = m_cyOffset;
+	case SB_LINEDOWN:
+		position += cyRow;
+		break;
 
-		switch (scrollType)
-		{
-		case SB_LINEDOWN:
-			m_cyOffset = max(-iExtraRowsOffscreen * (int)(cyRow) - 100, m_cyOffset - 10);
-			break;
+	case SB_LINEUP:
+		position -= cyRow;
+		break;
 
-		case SB_LINEUP:
-			m_cyOffset = min(0, m_cyOffset + 10);
-			break;
+	case SB_PAGEDOWN:
+		position += cyPage;
+		break;
 
-		case SB_THUMBTRACK:
-			SCROLLINFO si = {};
-			si.cbSize = sizeof(SCROLLINFO);
-			si.fMask = SIF_RANGE;
-			GetScrollInfo(m_hVertSB, SB_CTL, &si);
-			m_cyOffset = -static_cast<int>(((double)scrollPosition / si.nMax) * (iExtraRowsOffscreen * cyRow + 100));
-			break;
-		}
+	case SB_PAGEUP:
+		position -= cyPage;
+		break;
 
-		// We'll redraw everything only if the window was scrolled, otherwise there is no point
-		if (iOldCyOffset != m_cyOffset)
-		{
-			InvalidateRect(m_hWndSelf, NULL, TRUE);
-			ValidateScrollbarArea();
+	case SB_TOP:
+		position = 0;
+		break;
 
-			// Since we're scrolling vertically, there is no reason to redraw
-			// the label bar because it won't change, so we validate it.
-			RECT rcLabelBar = {};
-			rcLabelBar.left = 0;
-			rcLabelBar.top = 0;
-			rcLabelBar.right = GetWidth();
-			rcLabelBar.bottom = cyLabelBar + 1;
-			ValidateRect(m_hWndSelf, &rcLabelBar);
+	case SB_BOTTOM:
+		position = m_VertScroll.GetMaxPosition();
+		break;
 
-			UpdateVerticalScrollbar();
-		}
+	case SB_THUMBTRACK:
+	case SB_THUMBPOSITION:
+		SCROLLINFO si = {};
+		si.cbSize = sizeof(SCROLLINFO);
+		si.fMask = SIF_TRACKPOS;
+		GetScrollInfo(m_hVertSB, SB_CTL, &si);
+		position = m_VertScroll.GetPositionOfScrollBar(si.nTrackPos);
+		break;
 	}
 
+	ScrollRowsTo(position);
+
 	return 0;
 }
 
+void ListView::ScrollRowsTo(int64_t position)
+/*++
+* 
+* Routine Description:
+* 
+*	Scrolls the rows to a position and paints them right away. Like ScrollWindowEx with
+*	SW_INVALIDATE, only the rows that come into view are invalidated, and OnPaint moves
+*	the rest of them, unless the rows move so far that none of them stay on screen.
+* 
+* Arguments:
+* 
+*	position - How far from the top of the first row the top of the rows area should be,
+*	           in pixels. It is kept in range.
+* 
+* Return Value:
+* 
+*	None.
+* 
+--*/
+{
+	// Anything that is waiting to be painted is painted where it is now, before the rows
+	// move, so that the invalidated area is only ever the part that came into view
+	UpdateWindow(m_hWndSelf);
+
+	const int64_t cyMoved = m_VertScroll.ScrollTo(position);
+
+	if (cyMoved == 0)
+	{
+		return;
+	}
+
+	RECT rcInvalid = GetRowsRect();
+	const int64_t cyRows = rcInvalid.bottom - rcInvalid.top;
+
+	if (m_isLastFrameRetained && m_cyPendingScroll == 0 && std::abs(cyMoved) < cyRows)
+	{
+		m_cyPendingScroll = static_cast<int>(cyMoved);
+
+		if (cyMoved > 0)
+		{
+			rcInvalid.top = static_cast<LONG>(rcInvalid.bottom - cyMoved);
+		}
+
+		else
+		{
+			rcInvalid.bottom = static_cast<LONG>(rcInvalid.top - cyMoved);
+		}
+	}
+
+	else
+	{
+		m_cyPendingScroll = 0;
+	}
+
+	InvalidateRect(m_hWndSelf, &rcInvalid, FALSE);
+	UpdateVerticalScrollbar();
+	UpdateWindow(m_hWndSelf);
+}
+
 LRESULT ListView::OnHScroll(WORD scrollType, WORD scrollPosition)
 /*++
 * 
@@ -1247,7 +1766,7 @@ LRESULT ListView::OnKeyDown(WPARAM wParam)
 	{
 	case VK_UP:
 		if (m_iSelectedIndex == ROW_INDEX_NONE) {
-			m_iSelectedIndex = (int)(m_refRows->size()) - 1;
+			m_iSelectedIndex = (int)(m_IndexesOfShownRows.size()) - 1;
 			InvalidateRow(m_iSelectedIndex);
 		} else if (m_iSelectedIndex > 0) {
 			InvalidateRow(m_iSelectedIndex);
@@ -1260,7 +1779,7 @@ LRESULT ListView::OnKeyDown(WPARAM wParam)
 		if (m_iSelectedIndex == ROW_INDEX_NONE) {
 			m_iSelectedIndex = 0;
 			InvalidateRow(m_iSelectedIndex);
-		} else if (m_iSelectedIndex < m_refRows->size() - 1) {
+		} else if (m_iSelectedIndex + 1 < (int)(m_IndexesOfShownRows.size())) {
 			InvalidateRow(m_iSelectedIndex);
 			++m_iSelectedIndex;
 			InvalidateRow(m_iSelectedIndex);
@@ -1271,7 +1790,7 @@ LRESULT ListView::OnKeyDown(WPARAM wParam)
 	return 0;
 }
 
-void ListView::AddColumn(const wchar_t* lpszColumnName, int cxWidth)
+void ListView::AddColumn(const wchar_t* lpszColumnName, int cxWidth, SortKeyType sortKeyType)
 /*++
 * 
 * Routine Description:
@@ -1283,6 +1802,7 @@ void ListView::AddColumn(const wchar_t* lpszColumnName, int cxWidth)
 * 
 *	lpszColumnName - The name of the label that is displayed above the column.
 *	cxWidth - The width of the column in pixelss
+*	sortKeyType - What the cells of the column are compared as when it is sorted.
 * 
 * Return Value:
 * 
@@ -1298,19 +1818,49 @@ void ListView::AddColumn(const wchar_t* lpszColumnName, int cxWidth)
 
 	sumOfColumnWidths += cxWidth;
 
-	m_Columns.emplace_back(ColumnInfo(std::wstring(lpszColumnName), cxWidth));
+	m_Columns.emplace_back(ColumnInfo(std::wstring(lpszColumnName), cxWidth, sortKeyType));
 	m_NextColumnSortOrder.emplace_back(ListViewNextSort::ASCENDING);
+	m_CellColors.SetColumnCount(m_Columns.size());
 
 	UpdateHorizontalScrollbar();
 }
 
-void ListView::AddRow(std::vector<std::wstring>& info)
+template<typename Cells>
+RowHandle ListView::AddRowOf(Cells& info)
+/*++
+* 
+* Routine Description:
+* 
+*	Adds a row to the end of the list. It is only displayed if it passes the filters.
+* 
+* Arguments:
+* 
+*	info - The cells of the row, which are moved into the list.
+* 
+* Return Value:
+* 
+*	A handle that can be used to remove the row later on, or an invalid one if rows
+*	can't be added to the list.
+* 
+--*/
+{
+	if (!AreRowsModifiable())
+	{
+		return RowHandle();
+	}
+
+	// Every list that shares the rows is told about it, this one included, see OnRowAdded
+	return m_pRows->AddRow(std::move(info));
+}
+
+RowHandle ListView::AddRow(std::vector<std::wstring>& info)
 {
-	m_refIndexesOfShownRows->emplace_back(m_refRows->size());
-	m_refRows->emplace_back(std::move(info));
+	return AddRowOf(info);
+}
 
-	InvalidateRow(m_refRows->size() - 1);
-	UpdateVerticalScrollbar();
+RowHandle ListView::AddRow(PooledRow& info)
+{
+	return AddRowOf(info);
 }
 
 void ListView::OnDPIChanged(void)
@@ -1350,7 +1900,10 @@ void ListView::UpdateVerticalScrollbar(void)
 *
 * Routine Description:
 *
-*	Updates the vertical scrollbar's position, maximum distance, width, etc.
+*	Brings the scroll model up to date with the rows that are displayed and the size of
+*	the window, and the vertical scrollbar up to date with the scroll model. If there are
+*	fewer rows than before, the rows may have to be scrolled up, in which case all of them
+*	are drawn again.
 *
 * Arguments:
 *
@@ -1364,28 +1917,56 @@ void ListView::UpdateVerticalScrollbar(void)
 {
 	assert(cyRow != 0);
 
-	const int iExtraRowsOffScreen = GetExtraRowsOffScreenCount();
+	const int64_t oldPosition = m_VertScroll.GetPosition();
+
+	m_VertScroll.SetRowHeight(static_cast<int>(cyRow));
+	m_VertScroll.SetViewportHeight(GetRowsRect().bottom - static_cast<int>(cyLabelBar));
+	m_VertScroll.SetRowCount(m_IndexesOfShownRows.size());
+
+	if (m_VertScroll.GetPosition() != oldPosition)
+	{
+		m_cyPendingScroll = 0;
+		InvalidateRect(m_hWndSelf, NULL, FALSE);
+		ValidateScrollbarArea();
+	}
 
 	SCROLLINFO si = {};
 	si.cbSize = sizeof(SCROLLINFO);
 	si.fMask = SIF_RANGE | SIF_PAGE | SIF_POS;
 	si.nMin = 0;
-	// The 100 factor is pretty arbtitrary, it just works, can be changedd though
-	si.nMax = iExtraRowsOffScreen * 100;
-	si.nPage = iExtraRowsOffScreen * 10 + 1;
-	// The + 100 is there to give a little extra space after scrolling all the way down
-	si.nPos = (iExtraRowsOffScreen != 0) ? -(int)((m_cyOffset / (double)(iExtraRowsOffScreen * cyRow + 100)) * si.nMax) : 0;
+	si.nMax = m_VertScroll.GetScrollBarMax();
+	si.nPage = static_cast<UINT>(m_VertScroll.GetScrollBarPage());
+	si.nPos = m_VertScroll.GetScrollBarPosition();
 	SetScrollInfo(m_hVertSB, SB_CTL, &si, TRUE);
 }
 
-int ListView::GetExtraRowsOffScreenCount(void)
+int ListView::GetRowTop(size_t index)
+/*++
+* 
+* Routine Description:
+* 
+*	Finds where the top of a row is on screen.
+* 
+* Arguments:
+* 
+*	index - Index of the row in IndexesOfShownRows. Must be on screen, or close to it.
+* 
+* Return Value:
+* 
+*	The y coordinate of the top of the row, in client coordinates.
+* 
+--*/
+{
+	return static_cast<int>(static_cast<int64_t>(cyLabelBar) + m_VertScroll.GetRowTop(index));
+}
+
+RECT ListView::GetRowsRect(void)
 /*++
 * 
 * Routine Description:
 * 
-*	Calculates how many rows of data aren't displayed on screen.
-*	This is used in order to determine how much the window can
-*	be scrolled vertically by the scrollbar.
+*	Finds the area the rows are displayed in, which is between the label bar
+*	and the scrollbars.
 * 
 * Arguments:
 * 
@@ -1393,17 +1974,17 @@ int ListView::GetExtraRowsOffScreenCount(void)
 * 
 * Return Value:
 * 
-*	See Routine Description.
+*	The area, in client coordinates.
 * 
 --*/
 {
-	// Height - labelBarHeight = Height of area that the rows are displayed
-	// Divide by the height of the rows and we have an answer of how many rows fit on the screen
-	const int iRowCountFitOnScreen = static_cast<int>(((int)(GetHeight()) - (int)(cyLabelBar)) / (int)cyRow);
+	RECT rcRows = {};
+	rcRows.left = 1;
+	rcRows.top = static_cast<LONG>(cyLabelBar) + 1;
+	rcRows.right = (std::max)(static_cast<LONG>(GetWidth() - cxScrollbarWidth) - 1, rcRows.left);
+	rcRows.bottom = (std::max)(static_cast<LONG>(GetHeight() - cxScrollbarWidth) - 1, rcRows.top);
 
-	// Now we simply remove the number of rows that can be displayed from the total number of rows
-	// If the answer is negative we return zero, since there are no rows offscreen in this case.
-	return max(0, static_cast<int>(m_refIndexesOfShownRows->size()) - iRowCountFitOnScreen);
+	return rcRows;
 }
 
 void ListView::ValidateScrollbarArea(void)
@@ -1459,12 +2040,20 @@ void ListView::InvalidateRow(int index)
 * 
 --*/
 {
-	if (index >= 0 && index <= m_refIndexesOfShownRows->size())
+	if (index >= 0 && index <= m_IndexesOfShownRows.size())
 	{
+		const int64_t yTop = static_cast<int64_t>(cyLabelBar) + m_VertScroll.GetRowTop(index);
+
+		// Rows far away from the screen don't fit in a RECT, and don't need painting anyway
+		if (yTop + static_cast<int64_t>(cyRow) <= 0 || yTop >= static_cast<int64_t>(GetHeight()))
+		{
+			return;
+		}
+
 		RECT rcCurrentHover = {};
 		rcCurrentHover.left = 1;
 		rcCurrentHover.right = GetWidth() - cxScrollbarWidth - 1;
-		rcCurrentHover.top = cyLabelBar + index * cyRow + m_cyOffset;
+		rcCurrentHover.top = static_cast<LONG>(yTop);
 		rcCurrentHover.bottom = rcCurrentHover.top + cyRow;
 		InvalidateRect(m_hWndSelf, &rcCurrentHover, TRUE);
 	}
@@ -1481,6 +2070,7 @@ void ListView::SetColorRule(const std::wstring& word, COLORREF cr, int column)
 * 
 *	word - The word (or string) that will be colored.
 *	cr - The color that will be used
+*	column - The column whose cells are colored, or ALL_COLUMNS.
 * 
 * Return Value:
 * 
@@ -1488,65 +2078,146 @@ void ListView::SetColorRule(const std::wstring& word, COLORREF cr, int column)
 * 
 --*/
 {
-	ColorRule rule;
-	rule.columnAffected = column;
-	rule.cr = cr;
+	m_CellColors.SetRule(word, cr, column);
+	InvalidateRect(m_hWndSelf, NULL, FALSE);
+}
 
-	if (m_WordColoring.find(word) == m_WordColoring.end())
+void ListView::ApplyRowFilter(const std::wstring& filter_word)
+/*++
+* 
+* Routine Description:
+* 
+*	Displays the rows which have at least one cell that contains the filter_word,
+*	comparing their search keys so that case, accents and final sigma don't matter.
+*	Rows must also pass the column filters, if there are any.
+* 
+* Arguments:
+* 
+*	filter_word - Word used to filter out rows.
+* 
+* Return Value:
+* 
+*	None.
+* 
+--*/
+{
+	rowFilter = filter_word;
+	m_RowFilterSearchText = search::MakeSearchText(filter_word);
+
+	ApplyFilters();
+}
+
+void ListView::ApplyFilters(void)
+/*++
+* 
+* Routine Description:
+* 
+*	Displays the rows that contain the text of the row filter and pass every column filter.
+* 
+*	Without column filters, the rows found by the row filter are displayed as they are.
+*	Otherwise, the rows are combined as bitmaps: the ones the row filter found, minus the
+*	ones with a value that was filtered out, and, for each column with values that are
+*	kept, only the ones with one of those values. The rows left are displayed in the
+*	order they are stored in.
+* 
+* Arguments:
+* 
+*	None.
+* 
+* Return Value:
+* 
+*	None.
+* 
+--*/
+{
+	std::vector<int>& shownRows = m_IndexesOfShownRows;
+
+	if (columnFilters.empty())
 	{
-		
-		m_WordColoring.insert(std::make_pair(word, rule));
+		FindRowsContainingFilterText(shownRows);
 	}
 
 	else
 	{
-		m_WordColoring[word] = rule;
+		// With no text to look for, every row is found, so there's no need to look
+		RowBitmap rows(m_pRowProvider->GetRowCount(), rowFilter.empty());
+
+		if (!rowFilter.empty())
+		{
+			FindRowsContainingFilterText(shownRows);
+
+			for (int row : shownRows)
+			{
+				rows.Set(row);
+			}
+		}
+
+		ApplyColumnFilters(rows);
+
+		shownRows.clear();
+		rows.AppendRows(shownRows);
 	}
+
+	UpdateVerticalScrollbar();
+	
+	InvalidateRect(m_hWndSelf, NULL, TRUE);
+	m_iHoveredColumnLabel = COLUMN_INDEX_NONE;
+	m_iClickedColumnLabel = COLUMN_INDEX_NONE;
+
+	UnselectSelectedRow();
 }
 
-COLORREF ListView::GetWordColor(const std::wstring& word, int column)
+void ListView::FindRowsContainingFilterText(std::vector<int>& out)
 /*++
 * 
 * Routine Description:
 * 
-*	Finds the color of a word based on a set rule.
+*	Finds the rows that contain the text of the row filter.
+* 
+*	The rows stored in the list are looked up in their search index, so this doesn't
+*	get much slower as rows are added. The rows of any other provider are all checked.
 * 
 * Arguments:
 * 
-*	word - The word whose color will be returned.
+*	out - Receives the indexes of the rows, in increasing order.
 * 
 * Return Value:
 * 
-*	The color of the word.
+*	None.
 * 
 --*/
 {
-	if (m_WordColoring.find(word) == m_WordColoring.end())
+	if (AreRowsModifiable())
 	{
-		return RGB(0, 0, 0);
+		m_pRows->FindRowsContaining(rowFilter, out);
 	}
 
-	if (m_WordColoring[word].columnAffected == ALL_COLUMNS || m_WordColoring[word].columnAffected == column)
+	else
 	{
-		return m_WordColoring[word].cr;
-	}
+		out.clear();
 
-	return RGB(0, 0, 0);
+		const size_t cRows = m_pRowProvider->GetRowCount();
+
+		for (size_t i = 0; i < cRows; ++i)
+		{
+			if (search::Contains(m_pRowProvider->GetSearchKey(i), m_RowFilterSearchText))
+			{
+				out.emplace_back(i);
+			}
+		}
+	}
 }
 
-void ListView::ApplyRowFilter(const std::wstring& filter_word)
+void ListView::ApplyColumnFilters(RowBitmap& rows)
 /*++
 * 
 * Routine Description:
 * 
-*	Displays the rows which match at least one of the following criteria:
-* 
-*		- At least one of the row's cell's content is contained in the filter_word
-*	 or - Vice versa
+*	Removes the rows that don't pass the column filters from a set of rows.
 * 
 * Arguments:
 * 
-*	filter_word - Word used to filter out rows.
+*	rows - The rows. Must have a bit for every row of the provider.
 * 
 * Return Value:
 * 
@@ -1554,40 +2225,110 @@ void ListView::ApplyRowFilter(const std::wstring& filter_word)
 * 
 --*/
 {
-	m_refIndexesOfShownRows->clear();
+	// The words kept in the same column are alternatives, so their rows are gathered first
+	std::unordered_map<int, RowBitmap> keptRowsOfColumns;
 
-	for (size_t i = 0; i < m_refRows->size(); ++i)
+	for (const ColumnFilter& filter : columnFilters)
 	{
-		for (std::wstring& entry : (*m_refRows)[i])
+		if (filter.isExcluded)
 		{
-			if (filter_word.empty() 
-				|| StrStrNIW(entry.c_str(), filter_word.c_str(), entry.length()))
+			m_ColumnIndex.RemoveRowsWithValue(*m_pRowProvider, filter.iColumnIndex, filter.filter_word, rows);
+			continue;
+		}
+
+		auto kept = keptRowsOfColumns.find(filter.iColumnIndex);
+
+		if (kept == keptRowsOfColumns.end())
+		{
+			kept = keptRowsOfColumns.emplace(filter.iColumnIndex, RowBitmap(rows.GetRowCount())).first;
+		}
+
+		m_ColumnIndex.AddRowsWithValue(*m_pRowProvider, filter.iColumnIndex, filter.filter_word, kept->second);
+	}
+
+	for (const auto& kept : keptRowsOfColumns)
+	{
+		rows.And(kept.second);
+	}
+}
+
+bool ListView::IsRowShownByFilters(size_t row)
+/*++
+* 
+* Routine Description:
+* 
+*	Checks whether a single row contains the text of the row filter and passes every
+*	column filter, the same way ApplyFilters does for all of them, without the indexes
+*	it uses.
+* 
+* Arguments:
+* 
+*	row - Index of the row in the provider.
+* 
+* Return Value:
+* 
+*	true if the row would be displayed by ApplyFilters, false otherwise.
+* 
+--*/
+{
+	if (!rowFilter.empty() && !search::Contains(m_pRowProvider->GetSearchKey(row), m_RowFilterSearchText))
+	{
+		return false;
+	}
+
+	const size_t cCells = m_pRowProvider->GetCellCount(row);
+
+	// Whether each column with values that are kept has one of them
+	std::unordered_map<int, bool> isKeptInColumns;
+
+	for (const ColumnFilter& filter : columnFilters)
+	{
+		const bool hasValue = filter.iColumnIndex >= 0 && static_cast<size_t>(filter.iColumnIndex) < cCells &&
+			m_pRowProvider->GetCell(row, filter.iColumnIndex) == filter.filter_word;
+
+		if (filter.isExcluded)
+		{
+			if (hasValue)
 			{
-				m_refIndexesOfShownRows->emplace_back(i);
-				break;
+				return false;
 			}
 		}
+
+		else
+		{
+			isKeptInColumns[filter.iColumnIndex] |= hasValue;
+		}
 	}
 
-	UpdateVerticalScrollbar();
-	
-	InvalidateRect(m_hWndSelf, NULL, TRUE);
-	m_iHoveredColumnLabel = COLUMN_INDEX_NONE;
-	m_iClickedColumnLabel = COLUMN_INDEX_NONE;
+	for (const auto& kept : isKeptInColumns)
+	{
+		if (!kept.second)
+		{
+			return false;
+		}
+	}
 
-	UnselectSelectedRow();
+	return true;
 }
 
-void ListView::SortColumnData(int index)
+void ListView::SortColumnData(int index, bool isAddedToOrder)
 /*++
 * 
 * Routine Description:
 * 
-*	Sorts the rows of the list alphabetically, using the values of the specified row.
+*	Sorts the rows of the list by the values of the specified column, which are compared
+*	as the type of value the column was added with. Each time a column is sorted by, it
+*	is sorted in the opposite direction from the last time.
+* 
+*	Rows that were sorted recently are remembered by m_Sorter, so clicking the label of
+*	a column again, or of one that was clicked shortly before, takes next to no time.
 * 
 * Arguments:
 * 
-*	index - Index of column in m_Columns.
+*	index          - Index of column in m_Columns.
+*	isAddedToOrder - If true, the rows stay sorted by the columns they were sorted by, and only
+*	                 rows that are equal in all of them are sorted by this one. If the rows were
+*	                 already sorted by this column, only its direction changes.
 * 
 --*/
 {
@@ -1596,22 +2337,32 @@ void ListView::SortColumnData(int index)
 		return;
 	}
 
-	if (m_NextColumnSortOrder[index] == ListViewNextSort::ASCENDING) 
+	const bool isDescending = (m_NextColumnSortOrder[index] == ListViewNextSort::DESCENDING);
+	const SortColumn column(index, m_Columns[index].sortKeyType, isDescending);
+
+	if (!isAddedToOrder)
 	{
-		std::sort(m_refIndexesOfShownRows->begin(), m_refIndexesOfShownRows->end(), [&](int first, int second) {
-			return (*m_refRows)[first][index] < (*m_refRows)[second][index];
-		});
-		m_NextColumnSortOrder[index] = ListViewNextSort::DESCENDING;
+		m_SortOrder.clear();
 	}
 
-	else 
+	auto it = std::find_if(m_SortOrder.begin(), m_SortOrder.end(), [&](const SortColumn& sortColumn) {
+		return sortColumn.column == column.column;
+	});
+
+	if (it != m_SortOrder.end())
+	{
+		*it = column;
+	}
+
+	else
 	{
-		std::sort(m_refIndexesOfShownRows->begin(), m_refIndexesOfShownRows->end(), [&](int first, int second) {
-			return (*m_refRows)[first][index] > (*m_refRows)[second][index];
-		});
-		m_NextColumnSortOrder[index] = ListViewNextSort::ASCENDING;
+		m_SortOrder.push_back(column);
 	}
 
+	m_Sorter.Sort(*m_pRowProvider, m_SortOrder, m_IndexesOfShownRows);
+
+	m_NextColumnSortOrder[index] = isDescending ? ListViewNextSort::ASCENDING : ListViewNextSort::DESCENDING;
+
 	RECT rcRows = {};
 	rcRows.top = cyLabelBar;
 	rcRows.bottom = (int)(GetHeight() - cxScrollbarWidth);
@@ -1677,12 +2428,12 @@ std::vector<std::wstring> ListView::GetSelectedRow(void)
 		throw std::runtime_error("No row is selected");
 	}
 
-	return (*m_refRows)[(*m_refIndexesOfShownRows)[m_iSelectedIndex]];
+	return m_pRowProvider->CopyRow(m_IndexesOfShownRows[m_iSelectedIndex]);
 }
 
 bool ListView::IsSomeRowSelected(void)
 {
-	return m_iSelectedIndex >= 0 && m_iSelectedIndex < m_refIndexesOfShownRows->size();
+	return m_iSelectedIndex >= 0 && m_iSelectedIndex < m_IndexesOfShownRows.size();
 }
 
 void ListView::SetDisplayedRowContent(int row, const std::vector<std::wstring>& newData)
@@ -1702,17 +2453,15 @@ void ListView::SetDisplayedRowContent(int row, const std::vector<std::wstring>&
 	size_t uInsertedDataSize;
 	size_t uOldDataSize;
 
-	if (row >= 0 && row < static_cast<int>(m_refIndexesOfShownRows->size()))
+	if (AreRowsModifiable() && row >= 0 && row < static_cast<int>(m_IndexesOfShownRows.size()))
 	{
 		uInsertedDataSize = newData.size();
-		uOldDataSize = (*m_refRows)[(*m_refIndexesOfShownRows)[row]].size();
+		uOldDataSize = m_pRows->GetCellCount(m_IndexesOfShownRows[row]);
 
 		for (size_t i = 0; i < min(uInsertedDataSize, uOldDataSize); ++i)
 		{
-			(*m_refRows)[(*m_refIndexesOfShownRows)[row]][i] = newData[i];
+			m_pRows->SetCell(m_IndexesOfShownRows[row], i, newData[i]);
 		}
-
-		InvalidateRow(row);
 	}
 }
 
@@ -1730,10 +2479,9 @@ void ListView::SetCellContent(int row, int column, const std::wstring& content)
 * 
 --*/
 {
-	if (IsValidCellPosition(row, column))
+	if (AreRowsModifiable() && IsValidCellPosition(row, column))
 	{
-		(*m_refRows)[(*m_refIndexesOfShownRows)[row]][column] = content;
-		InvalidateRow(row);
+		m_pRows->SetCell(m_IndexesOfShownRows[row], column, content);
 	}
 }
 
@@ -1755,7 +2503,7 @@ std::wstring ListView::GetCellContent(int row, int column)
 {
 	if (IsValidCellPosition(row, column))
 	{
-		return (*m_refRows)[(*m_refIndexesOfShownRows)[row]][column];
+		return m_pRowProvider->GetCell(m_IndexesOfShownRows[row], column);
 	}
 
 	return L"";
@@ -1772,12 +2520,11 @@ bool ListView::IsValidCellPosition(int row, int column)
 * 
 --*/
 {
-	assert(m_refIndexesOfShownRows);
-	assert(m_refRows);
+	assert(m_pRowProvider);
 
-	if (row >= 0 && row < static_cast<int>(m_refIndexesOfShownRows->size()))
+	if (row >= 0 && row < static_cast<int>(m_IndexesOfShownRows.size()))
 	{
-		if (column >= 0 && column < static_cast<int>((*m_refRows)[(*m_refIndexesOfShownRows)[row]].size()))
+		if (column >= 0 && column < static_cast<int>(m_pRowProvider->GetCellCount(m_IndexesOfShownRows[row])))
 		{
 			return true;
 		}
@@ -1803,116 +2550,248 @@ void ListView::RemoveDisplayedRow(int index)
 * 
 --*/
 {
-	const int iIndexesVectorSize = static_cast<int>(m_refIndexesOfShownRows->size());
-
-	if (index >= 0 && index < iIndexesVectorSize)
-	{
-		const int iIndexOfRemovedRow = (*m_refIndexesOfShownRows)[index];
-
-		// Let's suppose for example's sake that we're going to remove the row at index = 1.
-		// Let's also suppose that there are 4 rows in total in the vector.
-		// Once we remove the row at index 1 in the m_Rows array, all the entries in
-		// the m_IndexesOfShownRows vector after index = 1, are incorrect, because they're
-		// pointing to the row AFTER the one they're supposed to be pointing at
-		//
-		//                                Before:
-		// 
-		//     m_IndexesOfShownRows                            m_Rows
-		//              1 --------------------|      |----------> x
-		//              2 -----------------|  |------|----------> y
-		//              0 -----------------|---------|   |------> z
-		//              3 -------|         |-------------|   |--> w
-		//                       |---------------------------|
-		//
-		//
-		//                                 After:
-		//     m_IndexesOfShownRows                            m_Rows
-		//              1 --------------------|      |----------> x
-		//                                    |------|----------> y
-		//              0 ---------------------------|            w
-		//              3 --------------------------------------> -
-		//
-		// As we can see, the last element is now pointing one position after the one it's
-		// supposed, to be, therefore we must decrement it by one, and all the ones that
-		// could potentially come after it
-		for (int i = 0; i < iIndexesVectorSize; ++i)
-		{
-			// Also make sure that if it's the last element in the array, we don't go off bounds
-			if ((*m_refIndexesOfShownRows)[i] > (*m_refIndexesOfShownRows)[index])
-			{
-				--((*m_refIndexesOfShownRows)[i]);
-			}
+	if (AreRowsModifiable() && index >= 0 && index < static_cast<int>(m_IndexesOfShownRows.size()))
+	{
+		m_pRows->RemoveRows(std::vector<size_t>{ static_cast<size_t>(m_IndexesOfShownRows[index]) });
+	}
+}
 
-			// In addition to decrementing, we also need to redraw every row from and after the row we're deleting.
-			if (i >= index)
-			{
-				InvalidateRow(i);
-			}
-		}
+RowHandle ListView::GetDisplayedRowHandle(int index)
+/*++
+* 
+* Routine Description:
+* 
+*	Gets a handle of a displayed row, which keeps referring to the row however the
+*	rows displayed change, so that it can be removed later on with RemoveRows.
+* 
+* Arguments:
+* 
+*	index - Index of the displayed row, starting from 0.
+* 
+* Return Value:
+* 
+*	The handle, or an invalid one if there is no such row or rows can't be removed
+*	from the list.
+* 
+--*/
+{
+	if (!AreRowsModifiable() || index < 0 || index >= static_cast<int>(m_IndexesOfShownRows.size()))
+	{
+		return RowHandle();
+	}
+
+	return m_pRows->GetRowHandle(static_cast<size_t>(m_IndexesOfShownRows[index]));
+}
+
+void ListView::RemoveRow(int index)
+/*++
+* 
+* Routine Description:
+* 
+*	Removes a row stored internally, meaning it might not be necessarily displayed.
+* 
+* Arguments:
+* 
+*	index - Index of row in the internal structure of the list
+* 
+--*/
+{
+	if (AreRowsModifiable() && index >= 0 && index < static_cast<int>(m_pRows->GetRowCount()))
+	{
+		m_pRows->RemoveRows(std::vector<size_t>{ static_cast<size_t>(index) });
+	}
+}
+
+void ListView::RemoveRows(const std::vector<RowHandle>& handles)
+/*++
+* 
+* Routine Description:
+* 
+*	Removes the rows that the handles returned by AddRow refer to, whether they're displayed
+*	or not. Removing many rows at once takes about as long as removing just one of them.
+* 
+* Arguments:
+* 
+*	handles - The handles. Handles of rows that have already been removed are ignored.
+* 
+* Return Value:
+* 
+*	None.
+* 
+--*/
+{
+	if (!AreRowsModifiable())
+	{
+		return;
+	}
 
-		// Now we delete the row at the index we saved at the beginning, because
-		// the data may have been altered in the previous loop.
-		m_refRows->erase(m_refRows->begin() + iIndexOfRemovedRow);
+	std::vector<size_t> rows;
+	rows.reserve(handles.size());
 
-		// And finally we remove the row from display.
-		m_refIndexesOfShownRows->erase(m_refIndexesOfShownRows->begin() + index);
+	for (const RowHandle& handle : handles)
+	{
+		size_t row;
 
-		// If the row we just deleted was the final one, we must unselect the row
-		if (m_refIndexesOfShownRows->empty())
+		if (m_pRows->FindRow(handle, row))
 		{
-			UnselectSelectedRow();
+			rows.push_back(row);
 		}
+	}
 
-		// If it wasn't the final one in the list, but it was the bottom one, we select the previous one
-		else if (m_iSelectedIndex == iIndexesVectorSize - 1) 
-		{
-			PostMessage(m_hWndParent, WM_ROW_SELECTED, NULL, NULL);
+	m_pRows->RemoveRows(std::move(rows));
+}
 
-			--m_iSelectedIndex;
-		}
+void ListView::OnRowAdded(size_t row, uint64_t version)
+/*++
+* 
+* Routine Description:
+* 
+*	Displays a row that was added to the rows of the list, through this list or any
+*	other that shares them, at the bottom, if it passes the filters of this list.
+* 
+* Arguments:
+* 
+*	row     - Index of the row in m_pRows.
+*	version - The version m_pRows had before the row was added.
+* 
+* Return Value:
+* 
+*	None.
+* 
+--*/
+{
+	if (!AreRowsModifiable())
+	{
+		return;
+	}
+
+	m_CellColors.OnRowAdded(*m_pRows, version);
+	m_ColumnIndex.OnRowAdded(*m_pRows, version);
+
+	if (IsRowShownByFilters(row))
+	{
+		m_IndexesOfShownRows.emplace_back(static_cast<int>(row));
+
+		InvalidateRow(m_IndexesOfShownRows.size() - 1);
+		UpdateVerticalScrollbar();
 	}
 }
 
-void ListView::RemoveRow(int index)
+void ListView::OnRowChanged(size_t row, uint64_t version)
+{
+	if (!AreRowsModifiable())
+	{
+		return;
+	}
+
+	m_CellColors.OnRowChanged(*m_pRows, version, row);
+	m_ColumnIndex.OnRowChanged(*m_pRows, version, row);
+
+	// The row isn't looked for among the displayed ones, since the few that fit on screen are drawn quickly
+	RECT rcRows = GetRowsRect();
+	InvalidateRect(m_hWndSelf, &rcRows, FALSE);
+}
+
+void ListView::OnRowsRemoved(const std::vector<int>& newIndexes, uint64_t version)
 /*++
 * 
 * Routine Description:
 * 
-*	Removes a row stored internally, meaning it might not be necessarily displayed.
+*	Stops displaying the rows that were removed from the rows of the list, through this
+*	list or any other that shares them.
 * 
-*	The way we're going to handle this is, we'll check if the index vector contains an
-*	entry that points to the row that we want to remove; if it does, great! We can call
-*	the RemoveDisplayedRow function to do the work for us. If it doesn't exist... well,
-*	then we'll add it to the index vector and call the same function.
+*	Removing a row moves every row after it back by one, so the indexes in
+*	m_IndexesOfShownRows of every row after it have to be changed. Each of them is
+*	replaced by the new index of its row, going through m_IndexesOfShownRows only once
+*	however many rows were removed.
 * 
 * Arguments:
 * 
-*	index - Index of row in the internal structure of the list
+*	newIndexes - newIndexes[row] is the index the row was moved to, or ROW_INDEX_NONE
+*	             if it was removed.
+*	version    - The version m_pRows had before the rows were removed.
+* 
+* Return Value:
+* 
+*	None.
 * 
 --*/
 {
-	// One might ask, why wouldn't RemoveDisplayedRow call RemoveRow instead of vice versa?
-	// Simple answer: I wrote RemoveDisplayedRow before RemoveRow, and since the other algorithm
-	// works I don't feel like doing it all over again
+	if (!AreRowsModifiable())
+	{
+		return;
+	}
 
-	assert(m_refIndexesOfShownRows);
+	std::vector<int>& shownRows = m_IndexesOfShownRows;
 
-	const size_t indexSize = m_refIndexesOfShownRows->size();
+	const int iOldSelectedIndex = m_iSelectedIndex;
+	int iNewSelectedIndex = ROW_INDEX_NONE;
 
-	for (size_t i = 0; i < indexSize; ++i)
+	const bool isSelectedRowRemoved = (iOldSelectedIndex >= 0 && iOldSelectedIndex < static_cast<int>(shownRows.size()) &&
+		newIndexes[shownRows[iOldSelectedIndex]] == ROW_INDEX_NONE);
+
+	size_t cShownRowsLeft = 0;
+
+	for (size_t i = 0; i < shownRows.size(); ++i)
 	{
-		if ((*m_refIndexesOfShownRows)[i] == index)
+		// Where the selected row was, or the row that comes after it if it's being removed
+		if (static_cast<int>(i) == iOldSelectedIndex)
 		{
-			RemoveDisplayedRow(i);
-			return;
+			iNewSelectedIndex = static_cast<int>(cShownRowsLeft);
+		}
+
+		const int iNewIndex = newIndexes[shownRows[i]];
+
+		if (iNewIndex != ROW_INDEX_NONE)
+		{
+			shownRows[cShownRowsLeft++] = iNewIndex;
+		}
+	}
+
+	shownRows.resize(cShownRowsLeft);
+
+	m_CellColors.OnRowsRemoved(*m_pRows, version, newIndexes);
+	m_ColumnIndex.OnRowsRemoved(*m_pRows, version, newIndexes);
+
+	if (shownRows.empty())
+	{
+		UnselectSelectedRow();
+	}
+
+	else if (iOldSelectedIndex != ROW_INDEX_NONE)
+	{
+		// If the selected row was removed, the one after it is selected instead, or the
+		// one before it if it was the bottom one
+		m_iSelectedIndex = min(iNewSelectedIndex, static_cast<int>(shownRows.size()) - 1);
+
+		if (isSelectedRowRemoved)
+		{
+			PostMessage(m_hWndParent, WM_ROW_SELECTED, NULL, NULL);
 		}
 	}
 
-	m_refIndexesOfShownRows->emplace_back(index);
+	RECT rcRows = {};
+	rcRows.top = cyLabelBar;
+	rcRows.bottom = (int)(GetHeight() - cxScrollbarWidth);
+	rcRows.left = 0;
+	rcRows.right = (int)(GetWidth() - cxScrollbarWidth);
+	InvalidateRect(m_hWndSelf, &rcRows, TRUE);
+
+	UpdateVerticalScrollbar();
+}
+
+void ListView::OnRowsCleared(void)
+{
+	if (!AreRowsModifiable())
+	{
+		return;
+	}
+
+	m_IndexesOfShownRows.clear();
 
-	// Remember that index size was initialized before adding the last element
-	// so it shoud be the index of the last element after calling emplace_back.
-	RemoveDisplayedRow(static_cast<int>(indexSize));
+	InvalidateRect(m_hWndSelf, NULL, FALSE);
+	ValidateScrollbarArea();
+	UpdateVerticalScrollbar();
 }
 
 void ListView::UnselectSelectedRow(void)
@@ -1925,63 +2804,164 @@ void ListView::UnselectSelectedRow(void)
 	}
 }
 
-// As of right now if a column is added after calling this function,
-// The column vectors will be out of sync between the two objects,
-// however since I doubt it will ever happen, I won't bother making
-// the column vector a pointer as well
-void ListView::Mirror(ListView* pList)
+void ListView::ShareRows(ListView* pList)
 /*++
 * 
 * Routine Description:
 * 
-*	Makes the ListView display the content of an already existing list view.
+*	Makes the ListView display the rows of an already existing list view, which both of
+*	them can then add, remove and edit. The ListView keeps its own filters and sorting,
+*	and works out which rows it displays from them only now and as the rows change,
+*	rather than every time it is shown.
+* 
+*	The columns are copied, so columns added to either list afterwards aren't added to the other.
 *	
 * Arguments:
 * 
-*	pList - Pointer to the list that will be mirrored.
+*	pList - Pointer to the list whose rows will be shared.
 * 
 --*/
 {
 	assert(pList);
 
-	// Clear any rows that are stored internally because they won't be displayed after mirroring
-	// Note that we shouldn't call the Clear() function because that clears the mirrored content,
-	// And if the list view is already mirroring another listview we don't want to clear it
-	m_IndexesOfShownRows.clear();
-	m_Rows.clear();
+	// The rows stored in the list until now are let go of, since they won't be displayed any more.
+	// Only the rows stored in the other list are shared, not any provider it may have been
+	// given, because it is free to replace or destroy that provider whenever it wants.
+	if (m_pRows != pList->m_pRows)
+	{
+		m_pRows->RemoveListener(this);
+		m_pRows = pList->m_pRows;
+		m_pRows->AddListener(this);
 
-	m_refIndexesOfShownRows = &pList->m_IndexesOfShownRows;
-	m_refRows               = &pList->m_Rows;
+		m_isSharingRows = true;
+	}
+
+	m_pProvider.reset();
+	m_pRowProvider = m_pRows.get();
 
-	// The right thing would be to use pointers for all these as well but I can't be bothered right now. TODO?
 	m_Columns             = pList->m_Columns;
 	m_NextColumnSortOrder = pList->m_NextColumnSortOrder;
 	sumOfColumnWidths     = pList->sumOfColumnWidths;
 
+	m_CellColors.SetColumnCount(m_Columns.size());
+
+	// The store that was let go of could be replaced by one at the same address
+	m_Sorter.Clear();
+	m_ColumnIndex.Clear();
+	m_CellColors.Clear();
+	m_SortOrder.clear();
+
+	m_VertScroll.ScrollTo(0);
+	m_cyPendingScroll = 0;
+
 	UpdateHorizontalScrollbar();
+	ApplyFilters();
+}
+
+void ListView::SetRowProvider(std::unique_ptr<RowProvider> pProvider)
+/*++
+* 
+* Routine Description:
+* 
+*	Makes the ListView display the rows of the given provider instead of the rows stored in it.
+*	While a provider is in use rows cannot be added, removed or edited through the ListView.
+* 
+*	If the ListView was sharing the rows of another one, it stops doing so, and the rows
+*	stored in it are then empty.
+* 
+* Arguments:
+* 
+*	pProvider - The provider, which the ListView takes ownership of. If it is nullptr,
+*	            the ListView goes back to displaying the rows stored in it.
+* 
+--*/
+{
+	UnselectSelectedRow();
+
+	if (m_isSharingRows)
+	{
+		m_pRows->RemoveListener(this);
+		m_pRows = std::make_shared<RowStore>();
+		m_pRows->AddListener(this);
+
+		m_isSharingRows = false;
+	}
+
+	m_pProvider = std::move(pProvider);
+	m_pRowProvider = m_pProvider ? m_pProvider.get() : m_pRows.get();
+
+	// A new provider could be given the address of the one it replaces
+	m_Sorter.Clear();
+	m_ColumnIndex.Clear();
+	m_CellColors.Clear();
+	m_SortOrder.clear();
+
+	// Every row of the new provider is displayed, in the order the provider has them
+	m_IndexesOfShownRows.resize(m_pRowProvider->GetRowCount());
+
+	for (size_t i = 0; i < m_IndexesOfShownRows.size(); ++i)
+	{
+		m_IndexesOfShownRows[i] = static_cast<int>(i);
+	}
+
+	m_VertScroll.ScrollTo(0);
+	m_cyPendingScroll = 0;
+
+	InvalidateRect(m_hWndSelf, NULL, FALSE);
+	ValidateScrollbarArea();
 	UpdateVerticalScrollbar();
 }
 
 void ListView::Clear(void)
 {
-	if (!m_refRows->empty())
+	if (m_pProvider)
 	{
-		m_refIndexesOfShownRows->clear();
-		m_refRows->clear();
+		// Clearing a list that displays a provider's rows means letting go of the provider
+		m_pProvider.reset();
+		m_pRowProvider = m_pRows.get();
+		m_IndexesOfShownRows.clear();
+
+		m_Sorter.Clear();
+		m_ColumnIndex.Clear();
+		m_CellColors.Clear();
+		m_SortOrder.clear();
 
 		InvalidateRect(m_hWndSelf, NULL, FALSE);
 		ValidateScrollbarArea();
 		UpdateVerticalScrollbar();
 	}
+
+	// Every list that shares the rows stops displaying them, see OnRowsCleared
+	if (!m_pRows->IsEmpty())
+	{
+		m_pRows->Clear();
+	}
 }
 
 void ListView::FilterOutColumnContent(int iColIndex, const std::wstring& filter_word)
+/*++
+* 
+* Routine Description:
+* 
+*	Hides the rows whose cell in a column is exactly filter_word, until the
+*	column filters are cleared.
+* 
+* Arguments:
+* 
+*	iColIndex - Index of the column in m_Columns.
+*	filter_word - The word.
+* 
+* Return Value:
+* 
+*	None.
+* 
+--*/
 {
 	assert(iColIndex >= 0 && iColIndex < m_Columns.size());
 
 	for (size_t i = 0; i < columnFilters.size(); ++i)
 	{
-		if (columnFilters[i].filter_word == filter_word)
+		if (columnFilters[i].isExcluded && columnFilters[i].iColumnIndex == iColIndex && columnFilters[i].filter_word == filter_word)
 		{
 			return;
 		}
@@ -1991,22 +2971,45 @@ void ListView::FilterOutColumnContent(int iColIndex, const std::wstring& filter_
 	cFilter.filter_word = filter_word;
 	cFilter.iColumnIndex = iColIndex;
 	columnFilters.emplace_back(cFilter);
+
+	ApplyFilters();
 }
 
-bool ListView::RowObeysToColumnFilters(int iRowIndex)
+void ListView::KeepOnlyColumnContent(int iColIndex, const std::vector<std::wstring>& filter_words)
+/*++
+* 
+* Routine Description:
+* 
+*	Displays only the rows whose cell in a column is exactly one of some words, such
+*	as the tickets that are in some states. The words replace any that were kept in
+*	the column before.
+* 
+* Arguments:
+* 
+*	iColIndex - Index of the column in m_Columns.
+*	filter_words - The words. If there are none, rows are no longer filtered by the
+*	               words in the column, though the ones filtered out stay hidden.
+* 
+* Return Value:
+* 
+*	None.
+* 
+--*/
 {
-	if (iRowIndex >= 0 && iRowIndex < m_refIndexesOfShownRows->size())
-	{
-		const std::vector<std::wstring> row = (*m_refRows)[(*m_refIndexesOfShownRows)[iRowIndex]];
+	assert(iColIndex >= 0 && iColIndex < m_Columns.size());
 
-		for (ColumnFilter& filter : columnFilters)
-		{
-			if (row[filter.iColumnIndex] == filter.filter_word)
-			{
-				return false;
-			}
-		}
+	columnFilters.erase(std::remove_if(columnFilters.begin(), columnFilters.end(), [iColIndex](const ColumnFilter& filter) {
+		return !filter.isExcluded && filter.iColumnIndex == iColIndex;
+	}), columnFilters.end());
+
+	for (const std::wstring& word : filter_words)
+	{
+		ColumnFilter cFilter;
+		cFilter.filter_word = word;
+		cFilter.iColumnIndex = iColIndex;
+		cFilter.isExcluded = false;
+		columnFilters.emplace_back(cFilter);
 	}
 
-	return true;
+	ApplyFilters();
 }
\ No newline at end of file
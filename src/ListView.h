@@ -1,10 +1,18 @@
 #pragma once
 
 #include "Window.h"
+#include "RowProvider.h"
+#include "RowStore.h"
+#include "SortKeys.h"
+#include "CellLayout.h"
+#include "ScrollModel.h"
+#include "ColumnIndex.h"
+#include "CellColors.h"
 
 #include <vector>
 #include <string>
 #include <unordered_map>
+#include <memory>
 
 #include <CommCtrl.h>
 #include <d2d1.h>
@@ -21,10 +29,12 @@ struct ColumnInfo
 {
 	std::wstring strName = L"";
 	int cxWidth = 0;
+	SortKeyType sortKeyType = SortKeyType::TEXT;
 
-	ColumnInfo(std::wstring name, int width) {
+	ColumnInfo(std::wstring name, int width, SortKeyType type) {
 		this->strName = std::move(name);
 		this->cxWidth = width;
+		this->sortKeyType = type;
 	}
 };
 
@@ -32,6 +42,9 @@ struct ColumnFilter
 {
 	std::wstring filter_word = L"";
 	int iColumnIndex = COLUMN_INDEX_NONE;
+
+	// If false, only rows that have one of the words kept in the column are displayed
+	bool isExcluded = true;
 };
 
 enum class ListViewNextSort
@@ -40,19 +53,21 @@ enum class ListViewNextSort
 	DESCENDING
 };
 
-#define ALL_COLUMNS (-1)
-
-struct ColorRule
+// How the list is drawn
+enum class TextRenderer
 {
-	COLORREF cr = 0;
-	int columnAffected = ALL_COLUMNS;
+	DIRECTWRITE, // Everything with Direct2D, and text with cached DirectWrite layouts
+	GDI          // Text and lines with GDI, on the device context of the Direct2D render target
+};
 
-	ColorRule(void) = default;
-	ColorRule(COLORREF cr, int columnAffected = ALL_COLUMNS)
-		: cr(cr), columnAffected(columnAffected) {}
+struct FrameTimes
+{
+	size_t cFrames = 0;
+	double msTotal = 0.0;
+	double msSlowest = 0.0;
 };
 
-class ListView : public Window
+class ListView : public Window, private RowStoreListener
 {
 public:
 	ListView(HWND hParentWindow, Size size, Point ptPos);
@@ -61,31 +76,40 @@ public:
 	LRESULT WindowProcedure(HWND hWnd, UINT uMsg, WPARAM wParam, LPARAM lParam);
 
 	/////////////////// Content manipulation ///////////////////////////
-	void AddColumn(const wchar_t* lpszColumnName, int cxWidth);
-	void AddRow(std::vector<std::wstring>& info);
+	void AddColumn(const wchar_t* lpszColumnName, int cxWidth, SortKeyType sortKeyType = SortKeyType::TEXT);
+	RowHandle AddRow(std::vector<std::wstring>& info);
+	RowHandle AddRow(PooledRow& info);
 	void RemoveDisplayedRow(int index);
 	void RemoveRow(int index);
+	void RemoveRows(const std::vector<RowHandle>& handles);
+	RowHandle GetDisplayedRowHandle(int index);
 	void ApplyRowFilter(const std::wstring& filter_word);
 	void FilterOutColumnContent(int iColIndex, const std::wstring& filter_word);
+	void KeepOnlyColumnContent(int iColIndex, const std::vector<std::wstring>& filter_words);
 	void SetDisplayedRowContent(int row, const std::vector<std::wstring>& newData);
 	void SetCellContent(int row, int column, const std::wstring& content);
 	void SetColorRule(const std::wstring& word, COLORREF cr, int column = ALL_COLUMNS);
 	void Clear(void);
 
-	void Mirror(ListView* pList);
+	void ShareRows(ListView* pList);
+	void SetRowProvider(std::unique_ptr<RowProvider> pProvider);
 
 	////////////// Getters /////////////////////
 	std::wstring GetCellContent(int row, int column);
 	std::vector<std::wstring> GetSelectedRow(void);
 	inline int GetSelectedRowIndex(void) { return m_iSelectedIndex; };
-	inline size_t GetDisplayedRowCount(void) const { return m_refIndexesOfShownRows->size(); }
-	inline size_t GetRowCount(void) const { return m_refRows->size(); }
+	inline size_t GetDisplayedRowCount(void) const { return m_IndexesOfShownRows.size(); }
+	inline size_t GetRowCount(void) const { return m_pRowProvider->GetRowCount(); }
 
 	bool IsSomeRowSelected(void);
 	void UnselectSelectedRow(void);
 	
 	void OnDPIChanged(void);
 
+	// Falls back to GDI if DirectWrite is asked for but couldn't be set up
+	void SetTextRenderer(TextRenderer renderer);
+	inline TextRenderer GetTextRenderer(void) const { return m_TextRenderer; }
+
 private:
 	/////////// (Un)initialization ////////////
 	void RegisterViewListClass(HINSTANCE hInstance);
@@ -115,19 +139,47 @@ private:
 	void DrawBackground(size_t uWidth, size_t uHeight);
 	void DrawRowBackground(size_t uWidth, size_t uHeight);
 	void DrawRow(HDC hDC, size_t uWidth, size_t uHeight, size_t index);
-	void DrawRows(HDC hDC, size_t uWidth, size_t uHeight);
+	void DrawRows(HDC hDC, size_t uWidth, size_t uHeight, const RECT& rcPaint);
 	void DrawLabelBar(HDC hDC, size_t uWidth, size_t uHeight);
 	void DrawColumns(HDC hDC, size_t uWidth, size_t uHeight);
 
+	// The same as the ones above, but drawn with Direct2D and DirectWrite only
+	void DrawRow(size_t uWidth, size_t uHeight, size_t index);
+	void DrawRows(size_t uWidth, size_t uHeight, const RECT& rcPaint);
+	void DrawLabelBar(size_t uWidth, size_t uHeight);
+	void DrawColumns(size_t uWidth, size_t uHeight);
+	void FillArea(float left, float top, float right, float bottom, COLORREF cr);
+	void DrawBorderedRectangle(int left, int top, int right, int bottom, COLORREF crFill, COLORREF crBorder);
+
+	bool BlitScrolledRows(void);
+
+	void RecordFrameTime(TextRenderer renderer, double msFrame);
+
 	////////////// Related to list content ////////////////
 	bool IsValidCellPosition(int row, int col);
-	int GetExtraRowsOffScreenCount(void);
+	int GetRowTop(size_t index);
+	RECT GetRowsRect(void);
+	void ScrollRowsTo(int64_t position);
 	int GetRelativeColumnHorizontalPosition(int index);
-	void SortColumnData(int index);
+	void SortColumnData(int index, bool isAddedToOrder);
+
+	// Cells is either a Row or a PooledRow
+	template<typename Cells>
+	RowHandle AddRowOf(Cells& info);
 
-	COLORREF GetWordColor(const std::wstring& word, int column);
+	void ApplyFilters(void);
+	void FindRowsContainingFilterText(std::vector<int>& out);
+	void ApplyColumnFilters(RowBitmap& rows);
+	bool IsRowShownByFilters(size_t row);
 
-	bool RowObeysToColumnFilters(int iRowIndex);
+	// Rows can only be added, removed or edited when they are stored in the list itself
+	inline bool AreRowsModifiable(void) const { return m_pRowProvider == m_pRows.get(); }
+
+	// RowStoreListener
+	void OnRowAdded(size_t row, uint64_t version) override;
+	void OnRowChanged(size_t row, uint64_t version) override;
+	void OnRowsRemoved(const std::vector<int>& newIndexes, uint64_t version) override;
+	void OnRowsCleared(void) override;
 
 private:
 	LRESULT OnPaint(void);
@@ -146,18 +198,28 @@ private:
 	std::vector<ColumnInfo> m_Columns;
 	std::vector<ListViewNextSort> m_NextColumnSortOrder;
 
-	// Contains all the data for the rows in the ListView
-	std::vector<std::vector<std::wstring>> m_Rows;
-	std::vector<std::vector<std::wstring>>* m_refRows;
+	// The columns the rows were last sorted by, the most important one first
+	std::vector<SortColumn> m_SortOrder;
+	RowSorter m_Sorter;
+
+	// Contains all the data for the rows in the ListView. Other lists may share it, see ShareRows.
+	std::shared_ptr<RowStore> m_pRows;
+
+	// Whether m_pRows was given by another list rather than created by this one
+	bool m_isSharingRows = false;
 
-	// This vector contains the indexes in m_Rows of the rows that are currently being drawn on screen.
+	// The rows that are actually displayed. Points to *m_pRows, unless a different
+	// provider has been given with SetRowProvider, in which case it is owned by m_pProvider.
+	RowProvider* m_pRowProvider;
+	std::unique_ptr<RowProvider> m_pProvider;
+
+	// This vector contains the indexes in m_pRows of the rows that are currently being drawn on screen.
 	// Whenever a filter is applied or the data is sorted, this is the only vector that is affected,
-	// not the m_Rows vector.
-	std::vector<int>* m_refIndexesOfShownRows;
+	// not the rows themselves. Each list has its own, even when the rows are shared.
 	std::vector<int> m_IndexesOfShownRows;
 
-	// Hashmap that matches string -> Color used when drawing it
-	std::unordered_map<std::wstring, ColorRule> m_WordColoring;
+	// The colors the cells are drawn in, see SetColorRule
+	CellColors m_CellColors;
 
 	// The width of the column that is being resized before the resizing started.
 	int m_widthBeforeDragging = 0;
@@ -177,8 +239,16 @@ private:
 	// Horizontal scroll offset in pixels
 	int m_cxOffset = 0; 
 
-	// Vertical scroll offset in pixels
-	int m_cyOffset = 0; 
+	// How far the rows have been scrolled vertically
+	ScrollModel m_VertScroll;
+
+	// How many pixels the rows have moved up by since they were last drawn, which is negative
+	// if they moved down. The rows that were on screen are moved rather than drawn again.
+	int m_cyPendingScroll = 0;
+
+	// Whether the render target still holds the last frame that was drawn, which the
+	// rows can only be moved in if it does.
+	bool m_isLastFrameRetained = false;
 
 	// The index in m_Columns of the column label that is being hovered over.
 	// Used because we want to draw a shadow above the said label when it is hovered.
@@ -214,6 +284,9 @@ private:
 	// The brush used for all the rectangles in OnPaint. Its color and opacity are changed throughout the program.
 	ID2D1SolidColorBrush* m_pSolidColorBrush = nullptr;
 
+	// The rows that are still on screen after scrolling are copied here and back, see BlitScrolledRows
+	ID2D1Bitmap* m_pScrollBitmap = nullptr;
+
 	// Width (Height when it's horizontal) of the scrollbar in pixels
 	size_t cxScrollbarWidth = 0;
 
@@ -228,9 +301,30 @@ private:
 	size_t sumOfColumnWidths = 0;
 	
 	HFONT m_hFont = NULL;
+
+	// How the cells fit in their columns in m_hFont
+	CellLayoutCache m_CellLayouts;
+
+	// The DirectWrite counterparts of the above. m_pTextFormat is null if it couldn't be
+	// created, in which case only GDI is used.
+	IDWriteTextFormat* m_pTextFormat = nullptr;
+	TextLayoutCache m_TextLayouts;
+
+	TextRenderer m_TextRenderer = TextRenderer::DIRECTWRITE;
+
+	// How long painting has taken since it was last reported, by TextRenderer
+	FrameTimes m_FrameTimes[2];
+
 	HWND m_hVertSB = NULL;
 	HWND m_hHorzSB = NULL;
 
 	std::vector<ColumnFilter> columnFilters;
-	std::vector<std::wstring> rowFilters;
+
+	// The text the rows were last filtered by, see ApplyRowFilter, and the same text
+	// made once by search::MakeSearchText, rather than for every row that is checked
+	std::wstring rowFilter;
+	std::wstring m_RowFilterSearchText;
+
+	// The rows of each value of the columns that are filtered
+	ColumnIndex m_ColumnIndex;
 };
\ No newline at end of file
@@ -103,32 +103,57 @@ void MainTab::InitTicketListView(void)
     m_pTicketListView->SetColorRule(L"Στέλεχος", RGB(73, 150, 183), 3);
     m_pTicketListView->SetColorRule(L"Κατασκηνωτής/ρια", RGB(0, 0, 255), 3);
 
-    m_pTicketListView->AddColumn(L"#", 30);
+    m_pTicketListView->AddColumn(L"#", 30, SortKeyType::INTEGER);
     m_pTicketListView->AddColumn(L"Ενημ.", 50);
     m_pTicketListView->AddColumn(L"Κατάσταση", 100);
     m_pTicketListView->AddColumn(L"Ιδιότητα", 140);
     m_pTicketListView->AddColumn(L"Όνομα", 140);
     m_pTicketListView->AddColumn(L"Επώνυμο", 140);
     m_pTicketListView->AddColumn(L"Πατρώνυμο", 140);
-    m_pTicketListView->AddColumn(L"Ημ/νια Αποχώρησης", 140);
-    m_pTicketListView->AddColumn(L"Δηλ. Ώρα Αποχ.", 100);
-    m_pTicketListView->AddColumn(L"Ημ/νια Επιστροφής", 140);
-    m_pTicketListView->AddColumn(L"Δηλ. Ώρα Επ.", 100);
-    m_pTicketListView->AddColumn(L"Ώρα Επιστροφής", 100);
+    m_pTicketListView->AddColumn(L"Ημ/νια Αποχώρησης", 140, SortKeyType::DATE);
+    m_pTicketListView->AddColumn(L"Δηλ. Ώρα Αποχ.", 100, SortKeyType::TIME);
+    m_pTicketListView->AddColumn(L"Ημ/νια Επιστροφής", 140, SortKeyType::DATE);
+    m_pTicketListView->AddColumn(L"Δηλ. Ώρα Επ.", 100, SortKeyType::TIME);
+    m_pTicketListView->AddColumn(L"Ώρα Επιστροφής", 100, SortKeyType::TIME);
     m_pTicketListView->AddColumn(L"Σημείωση", 200);
 
     LoadTicketsFromDatabaseFile();
 }
 
 void MainTab::LoadTicketsFromDatabaseFile(void)
+/*++
+* 
+* Routine Description:
+* 
+*   Loads every ticket into the list view. The tickets are read on the database thread,
+*   so the window keeps responding while they are, and added once they have all been read.
+* 
+--*/
 {
-    std::vector<db::Ticket> tickets;
-    db::LoadTicketsFromDatabase(tickets);
+    db::Async([] {
+        std::vector<db::TicketRecord> tickets;
+        db::LoadTicketsFromDatabase(tickets);
+        return tickets;
+    }, [this](std::future<std::vector<db::TicketRecord>> result) {
+        try
+        {
+            for (const db::TicketRecord& ticket : result.get())
+            {
+                AddTicketToListView(ticket);
+            }
+        }
     
-    for (db::Ticket& ticket : tickets)
-    {
-        m_pTicketListView->AddRow(ticket);
-    }
+        catch (std::exception& e)
+        {
+            ShowDatabaseError(e);
+        }
+    });
+}
+
+void MainTab::AddTicketToListView(const db::TicketRecord& ticket)
+{
+    PooledRow row = db::TicketRecordToPooledRow(ticket, true);
+    m_TicketRowsOfPeople[ticket.person_id].push_back(m_pTicketListView->AddRow(row));
 }
 
 void MainTab::InitLVRelatedControls(void)
@@ -149,6 +174,26 @@ void MainTab::InitLVRelatedControls(void)
     SetWindowFont(m_hSearchEdit, m_hLargeFont);
     SetPlaceholderText(m_hSearchEdit, L"Αναζήτηση");
 
+    m_hStateFilterCombo = CreateWindow(
+        L"ComboBox",
+        L"",
+        WS_CHILD | WS_VISIBLE | WS_VSCROLL | CBS_DROPDOWNLIST,
+        0, 0, 0, 0,
+        m_hWndSelf,
+        NULL,
+        hInstance,
+        NULL
+    );
+
+    SetWindowFont(m_hStateFilterCombo, m_hSmallFont);
+
+    // The first item displays the tickets in every state, and the rest those in one state each
+    ComboBox_AddString(m_hStateFilterCombo, L"Όλες οι καταστάσεις");
+    ComboBox_AddString(m_hStateFilterCombo, util::EnumToString(util::TicketState::PENDING).c_str());
+    ComboBox_AddString(m_hStateFilterCombo, util::EnumToString(util::TicketState::ACTIVE).c_str());
+    ComboBox_AddString(m_hStateFilterCombo, util::EnumToString(util::TicketState::INACTIVE).c_str());
+    ComboBox_SetCurSel(m_hStateFilterCombo, m_iStateFilter);
+
     m_hCancelIcon     = LoadIcon(hInstance, MAKEINTRESOURCE(CANCEL_ICON));
     m_hDeactivateIcon = LoadIcon(hInstance, MAKEINTRESOURCE(DEACTIVATED_ICON));
     m_hEditIcon       = LoadIcon(hInstance, MAKEINTRESOURCE(EDIT_ICON));
@@ -295,6 +340,7 @@ void MainTab::OnResize(int width, int height)
     {
         UpdateTicketListPos(width, height, dpiScale);
         UpdateSearchbarPos(width, height, dpiScale);
+        UpdateStateFilterPos(width, height, dpiScale);
         UpdateAddButtonPos(width, height, dpiScale);
         UpdateDeactivateButtonPos(width, height, dpiScale);
         UpdateCancelButtonPos(width, height, dpiScale);
@@ -403,6 +449,43 @@ void MainTab::UpdateSearchbarPos(int width, int height, double dpiScale)
     );
 }
 
+void MainTab::UpdateStateFilterPos(int width, int height, double dpiScale)
+/*++
+*
+* Routine Description:
+*
+*   Positions the state filter above the list view, on its left, in line with the searchbar.
+*
+* Arguments:
+*
+*   width    - Width of the parent window.
+*   height   - Height of the parent window.
+*   dpiScale - The scaling factor for everything.
+*
+* Return Value:
+*
+*   None.
+*
+--*/
+{
+    const int iComboWidth = static_cast<int>(200 * dpiScale);
+    const int iSearchEditHeight = static_cast<int>(32 * dpiScale);
+    const int iGapBetweenComboAndList = static_cast<int>(16 * dpiScale);
+
+    // The height of a combo box includes its drop down list
+    const int iDroppedComboHeight = static_cast<int>(160 * dpiScale);
+
+    SetWindowPos(
+        m_hStateFilterCombo,
+        NULL,
+        m_pTicketListView->GetX(),
+        m_pTicketListView->GetY() - iSearchEditHeight - iGapBetweenComboAndList,
+        iComboWidth,
+        iDroppedComboHeight,
+        SWP_NOZORDER
+    );
+}
+
 void MainTab::UpdateAddButtonPos(int width, int height, double dpiScale)
 /*++
 *
@@ -807,6 +890,25 @@ void MainTab::OnCommand(HWND hWnd)
         m_pTicketListView->ApplyRowFilter(buffer);
     }
 
+    else if (hWnd == m_hStateFilterCombo)
+    {
+        const int iSelected = ComboBox_GetCurSel(m_hStateFilterCombo);
+
+        if (iSelected != CB_ERR && iSelected != m_iStateFilter)
+        {
+            m_iStateFilter = iSelected;
+
+            std::vector<std::wstring> states;
+
+            if (iSelected > 0)
+            {
+                states.push_back(util::EnumToString(static_cast<util::TicketState>(iSelected - 1)));
+            }
+
+            m_pTicketListView->KeepOnlyColumnContent(LV_STATE_INDEX, states);
+        }
+    }
+
     else if (hWnd == m_hAddButton)
     {
         PostMessage(m_hWndParent, WM_SWITCH_TO_EXPORT_TAB, NULL, NULL);
@@ -897,20 +999,17 @@ LRESULT MainTab::OnCustomMessage(UINT uMsg, WPARAM wParam, LPARAM lParam)
         break;
 
     case WM_EXPORT_TICKET:
-        SaveTicketToDatabase(*((std::vector<std::wstring>*)lParam));
+        SaveTicketToDatabase(*((db::TicketRecord*)lParam));
         break;
 
     case WM_DELETE_PERSON_TICKET: {
-        std::vector<db::Ticket> tickets;
-        db::GetTicketsOfPerson(wParam, tickets);
-        for (db::Ticket& ticket : tickets) {
-            db::DeleteTicket(std::stoi(ticket[0]));
-            for (size_t i = 0; i < m_pTicketListView->GetRowCount(); ++i) {
-                if (m_pTicketListView->GetCellContent(i, 0) == ticket[0]) {
-                    m_pTicketListView->RemoveRow(i);
-                    break;
-                }
-            }
+        // Sent once the person and their tickets have been deleted from the database,
+        // by which time the rows of any tickets that were still being inserted are in the list
+        auto it = m_TicketRowsOfPeople.find(static_cast<int>(wParam));
+
+        if (it != m_TicketRowsOfPeople.end()) {
+            m_pTicketListView->RemoveRows(it->second);
+            m_TicketRowsOfPeople.erase(it);
         }
         }
         break;
@@ -1097,31 +1196,42 @@ void MainTab::OnSubmitButtonClicked(void)
         return;
     }
 
-    std::vector<std::wstring> newRowData;
-
     const int iSelectedRowIndex = m_pTicketListView->GetSelectedRowIndex();
 
-    // The first cell of the row contains the state of the ticket, which cannot be edited
-    // by the user, so we want to maintain the value after editing. We're also certain that
-    // a row is selected because otherwise this function couldn't have been called, so
-    // there is no need to check anything
-    newRowData.emplace_back(m_pTicketListView->GetCellContent(iSelectedRowIndex, 0));
-    newRowData.emplace_back(m_pTicketListView->GetCellContent(iSelectedRowIndex, 1));
-    newRowData.emplace_back(m_pTicketListView->GetCellContent(iSelectedRowIndex, 2));
+    // Only the dates, the times and the notes belong to the ticket itself; the names
+    // belong to the person, so they're not stored and the displayed ones are kept.
+    // We're also certain that a row is selected because otherwise this function
+    // couldn't have been called, so there is no need to check anything
+    db::TicketRecord ticket;
+    ticket.id = std::stoi(m_pTicketListView->GetCellContent(iSelectedRowIndex, LV_ID_INDEX));
     
-    for (int i = 0; i < sizeof(hEditControlsInOrder) / sizeof(HWND); ++i)
-    {
-        GetWindowText(hEditControlsInOrder[i], buffer, MAX_NOTES_LENGTH);
-        SetWindowText(hEditControlsInOrder[i], L"");
+    GetWindowText(m_hDepartDateEdit, buffer, MAX_NOTES_LENGTH);
+    ticket.departure_date = util::PackDate(util::ConvertStringToDate(buffer));
 
-        newRowData.emplace_back(buffer);
-    }
+    GetWindowText(m_hDepartureEdit, buffer, MAX_NOTES_LENGTH);
+    ticket.departure_time = static_cast<short>(util::ConvertStringToTime(buffer));
+
+    GetWindowText(m_hArrivalDateEdit, buffer, MAX_NOTES_LENGTH);
+    ticket.arrival_date = util::PackDate(util::ConvertStringToDate(buffer));
+
+    GetWindowText(m_hArrivalEdit, buffer, MAX_NOTES_LENGTH);
+    ticket.arrival_time = static_cast<short>(util::ConvertStringToTime(buffer));
+
+    GetWindowText(m_hNotesEdit, buffer, MAX_NOTES_LENGTH);
+    ticket.notes = buffer;
 
-    newRowData.insert(newRowData.begin() + 10, m_pTicketListView->GetCellContent(iSelectedRowIndex, 10));
+    for (HWND hWnd : hEditControlsInOrder)
+    {
+        SetWindowText(hWnd, L"");
+    }
 
-    db::UpdateTicket(newRowData);
+    db::Async([ticket] { db::UpdateTicket(ticket); }, ReportDatabaseErrors());
 
-    m_pTicketListView->SetDisplayedRowContent(iSelectedRowIndex, newRowData);
+    m_pTicketListView->SetCellContent(iSelectedRowIndex, LV_DDATE_INDEX, util::FormatPackedDate(ticket.departure_date));
+    m_pTicketListView->SetCellContent(iSelectedRowIndex, LV_DTIME_INDEX, util::FormatTime(ticket.departure_time));
+    m_pTicketListView->SetCellContent(iSelectedRowIndex, LV_ADATE_INDEX, util::FormatPackedDate(ticket.arrival_date));
+    m_pTicketListView->SetCellContent(iSelectedRowIndex, LV_ATIME_INDEX, util::FormatTime(ticket.arrival_time));
+    m_pTicketListView->SetCellContent(iSelectedRowIndex, LV_NOTES_INDEX, ticket.notes);
 
     EnableWindow(m_hSubmitButton, FALSE);
     
@@ -1136,9 +1246,24 @@ void MainTab::OnDeleteButtonClicked(void)
             L"Είστε βέβαιοι ότι θέλετε να διαγράψετε την άδεια; Η πράξη αυτή δεν είναι αντιστρέψιμη.",
             L"Επιβεβαίωση", MB_ICONEXCLAMATION | MB_OKCANCEL) == IDOK)
         {
-            db::DeleteTicket(std::stoi(m_pTicketListView->GetCellContent(m_pTicketListView->GetSelectedRowIndex(), 0)));
+            const int ticket_id = std::stoi(m_pTicketListView->GetCellContent(m_pTicketListView->GetSelectedRowIndex(), 0));
+
+            // The row is only removed once the ticket is gone from the database, by which
+            // time it may be displayed at a different index, if at all
+            const RowHandle hRow = m_pTicketListView->GetDisplayedRowHandle(m_pTicketListView->GetSelectedRowIndex());
+
+            db::Async([ticket_id] { db::DeleteTicket(ticket_id); }, [this, hRow](std::future<void> result) {
+                try
+                {
+                    result.get();
+                    m_pTicketListView->RemoveRows({ hRow });
+                }
 
-            m_pTicketListView->RemoveDisplayedRow(m_pTicketListView->GetSelectedRowIndex());
+                catch (std::exception& e)
+                {
+                    ShowDatabaseError(e);
+                }
+            });
         }
 
         SetFocus(m_pTicketListView->GetHandle());
@@ -1161,7 +1286,11 @@ void MainTab::OnDeactivateButtonClicked(void)
             wchar_t buffer[6];
             swprintf_s(buffer, 6, L"%02d:%02d", sysTime.wHour, sysTime.wMinute);
 
-            db::DeactivateTicket(ticket_id, buffer);
+            const std::wstring timeOfDeactivation = buffer;
+
+            db::Async([ticket_id, timeOfDeactivation] {
+                db::DeactivateTicket(ticket_id, timeOfDeactivation);
+            }, ReportDatabaseErrors());
 
             m_pTicketListView->SetCellContent(m_pTicketListView->GetSelectedRowIndex(), LV_STATE_INDEX, L"Ανενεργή");
             m_pTicketListView->SetCellContent(m_pTicketListView->GetSelectedRowIndex(), LV_AATIME_INDEX, buffer);
@@ -1262,26 +1391,19 @@ void MainTab::HandleListViewKeyDownMessage(WPARAM wParam)
     }
 }
 
-void MainTab::SaveTicketToDatabase(db::Ticket& ticket)
+void MainTab::SaveTicketToDatabase(const db::TicketRecord& ticket)
 {
-    db::Ticket toBeInserted = ticket;
-
-    toBeInserted.erase(toBeInserted.begin() + 3); // Erase role
-    toBeInserted.erase(toBeInserted.begin() + 3); // Erase first name
-    toBeInserted.erase(toBeInserted.begin() + 3); // Erase last name
-    toBeInserted.erase(toBeInserted.begin() + 3); // Eraes father's name
-
-    ticket[1] = (ticket[1] == L"1") ? L"✓" : L"✕";
-
-    try {
-        db::InsertTicketToDatabase(toBeInserted);
-        ticket.erase(ticket.begin() + 2);
-        std::swap(ticket[0], ticket[1]);
-        ticket.insert(ticket.begin(), std::to_wstring(db::GetLastInsertedRowId()));
-        m_pTicketListView->AddRow(ticket);
-    } catch (std::exception& e) {
-        MessageBoxA(m_hWndSelf, e.what(), "SQLite Error", MB_OK | MB_ICONERROR);
-    }
+    // The row is added once the ticket has been given its id
+    db::Async([ticket] {
+        return db::InsertTicketToDatabase(ticket);
+    }, [this, saved = ticket](std::future<int> id) mutable {
+        try {
+            saved.id = id.get();
+            AddTicketToListView(saved);
+        } catch (std::exception& e) {
+            ShowDatabaseError(e);
+        }
+    });
 }
 
 void MainTab::OnActivateButtonClicked(void)
@@ -1295,7 +1417,7 @@ void MainTab::OnActivateButtonClicked(void)
 
         EnableWindow(m_hActivateButton, FALSE);
 
-        db::ActivateTicket(id);
+        db::Async([id] { db::ActivateTicket(id); }, ReportDatabaseErrors());
     }
 }
 
@@ -1310,6 +1432,6 @@ void MainTab::OnInformedButtonClicked(void)
 
         EnableWindow(m_hInformedButton, FALSE);
 
-        db::TickInformed(id);
+        db::Async([id] { db::TickInformed(id); }, ReportDatabaseErrors());
     }
 }
\ No newline at end of file
@@ -4,6 +4,8 @@
 #include "ListView.h"
 #include "Database.h"
 
+#include <unordered_map>
+
 class MainTab : public Tab
 {
 public:
@@ -25,6 +27,7 @@ private:
 	void InitRowEditControls(void);
 
 	void LoadTicketsFromDatabaseFile(void);
+	void AddTicketToListView(const db::TicketRecord& ticket);
 
 	void OnEditRowButtonClicked(void);
 	void OnSubmitButtonClicked(void);
@@ -41,6 +44,7 @@ private:
 
 	inline void UpdateTicketListPos(int width, int height, double dpiScale);
 	inline void UpdateSearchbarPos(int width, int height, double dpiScale);
+	inline void UpdateStateFilterPos(int width, int height, double dpiScale);
 	inline void UpdateDeactivateButtonPos(int width, int height, double dpiScale);
 	inline void UpdateCancelButtonPos(int width, int height, double dpiScale);
 	inline void UpdateEditButtonPos(int width, int height, double dpiScale);
@@ -60,12 +64,17 @@ private:
 
 	bool WindowTextIsMilitaryTime(HWND hWnd);
 
-	void SaveTicketToDatabase(db::Ticket& ticket);
+	void SaveTicketToDatabase(const db::TicketRecord& ticket);
 
 private:
 	ListView* m_pTicketListView = nullptr;
 
+	// The rows of the tickets of each person in the list, by the id of the person. Handles
+	// of tickets that were deleted on their own are left in, since they don't refer to any row.
+	std::unordered_map<int, std::vector<RowHandle>> m_TicketRowsOfPeople;
+
 	HWND m_hSearchEdit       = NULL;
+	HWND m_hStateFilterCombo = NULL;
 	HWND m_hDeactivateButton = NULL;
 	HWND m_hDeleteButton     = NULL;
 	HWND m_hEditButton       = NULL;
@@ -83,6 +92,9 @@ private:
 	HWND m_hArrivalEdit      = NULL;
 	HWND m_hNotesEdit        = NULL;
 
+	// The item selected in m_hStateFilterCombo, so the list is filtered only when it changes
+	int m_iStateFilter       = 0;
+
 	HFONT m_hHugeFont        = NULL;
 	HFONT m_hLargeFont       = NULL;
 	HFONT m_hSmallFont       = NULL;
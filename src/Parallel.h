@@ -0,0 +1,87 @@
+#pragma once
+
+#include <vector>
+#include <thread>
+#include <algorithm>
+
+namespace parallel
+{
+	inline size_t GetThreadCount(void)
+	{
+		// hardware_concurrency may return 0 when it can't tell
+		return std::max<size_t>(std::thread::hardware_concurrency(), 1);
+	}
+
+	template<typename T, typename Predicate>
+	void RemoveIf(std::vector<T>& items, Predicate predicate, size_t cMinItems)
+	/*++
+	*
+	* Routine Description:
+	*
+	*	Removes the items for which the predicate is true, keeping the rest in the
+	*	order they were in, like the erase-remove idiom does.
+	*
+	*	If there are enough items, they're split into one chunk per processor and each
+	*	chunk is filtered on a thread of its own. The chunks are then joined in order.
+	*	The predicate is called from several threads at once, so it mustn't change anything.
+	*
+	* Arguments:
+	*
+	*	items      - The items.
+	*	predicate  - Returns true for the items that should be removed.
+	*	cMinItems  - Fewer items than this are filtered on the calling thread, because
+	*	             starting the threads would take longer than filtering them.
+	*
+	* Return Value:
+	*
+	*	None.
+	*
+	--*/
+	{
+		const size_t cChunks = std::min(GetThreadCount(), items.size() / std::max<size_t>(cMinItems, 1));
+
+		if (cChunks < 2)
+		{
+			items.erase(std::remove_if(items.begin(), items.end(), predicate), items.end());
+			return;
+		}
+
+		const size_t cItemsPerChunk = (items.size() + cChunks - 1) / cChunks;
+
+		std::vector<size_t> chunkEnds(cChunks);
+		std::vector<std::thread> threads;
+		threads.reserve(cChunks - 1);
+
+		const auto FilterChunk = [&](size_t chunk) {
+			const auto first = items.begin() + std::min(chunk * cItemsPerChunk, items.size());
+			const auto last  = items.begin() + std::min((chunk + 1) * cItemsPerChunk, items.size());
+
+			chunkEnds[chunk] = std::remove_if(first, last, predicate) - items.begin();
+		};
+
+		for (size_t i = 1; i < cChunks; ++i)
+		{
+			threads.emplace_back(FilterChunk, i);
+		}
+
+		// The calling thread takes the first chunk instead of just waiting
+		FilterChunk(0);
+
+		for (std::thread& thread : threads)
+		{
+			thread.join();
+		}
+
+		// Move what's left of each chunk right after what's left of the previous one
+		auto end = items.begin() + chunkEnds[0];
+
+		for (size_t i = 1; i < cChunks; ++i)
+		{
+			const auto first = items.begin() + std::min(i * cItemsPerChunk, items.size());
+
+			end = std::move(first, items.begin() + chunkEnds[i], end);
+		}
+
+		items.erase(end, items.end());
+	}
+}
@@ -68,7 +68,7 @@ void render::UninitializeDirect2D(void)
     SAFE_RELEASE(g_pWriteFactory);
 }
 
-ID2D1HwndRenderTarget* render::CreateWindowRenderTarget(HWND hWnd)
+ID2D1HwndRenderTarget* render::CreateWindowRenderTarget(HWND hWnd, D2D1_PRESENT_OPTIONS presentOptions)
 /*++
 * 
 * Routine Description:
@@ -78,6 +78,7 @@ ID2D1HwndRenderTarget* render::CreateWindowRenderTarget(HWND hWnd)
 * Arguments:
 * 
 *   hWnd - Handle to the window.
+*   presentOptions - Whether what is drawn is kept after it is presented, among others.
 * 
 * Return Value:
 * 
@@ -118,7 +119,7 @@ ID2D1HwndRenderTarget* render::CreateWindowRenderTarget(HWND hWnd)
 
         HRESULT hr = g_pD2DFactory->CreateHwndRenderTarget(
             rtProps,
-            D2D1::HwndRenderTargetProperties(hWnd, uWindowSize),
+            D2D1::HwndRenderTargetProperties(hWnd, uWindowSize, presentOptions),
             &pRenderTarget
         );
     }
@@ -174,6 +175,57 @@ IDWriteTextFormat* render::CreateTextFormat(LPCWSTR lpszFontName, float size, LP
     return pTextFormat;
 }
 
+IDWriteTextLayout* render::CreateTextLayout(LPCWSTR lpszText, UINT32 cchText, IDWriteTextFormat* pTextFormat, float cxMax, float cyMax)
+/*++
+* 
+* Routine Description:
+* 
+*   Lays out some text in a box, so that it can be drawn any number of times
+*   without being shaped or measured again.
+* 
+* Arguments:
+* 
+*   lpszText - The text.
+*   cchText - The length of the text in characters.
+*   pTextFormat - The font, alignment and trimming of the text.
+*   cxMax - The width of the box.
+*   cyMax - The height of the box.
+* 
+* Return Value:
+* 
+*   The created text layout.
+* 
+--*/
+{
+    IDWriteTextLayout* pTextLayout = nullptr;
+
+    if (g_pWriteFactory)
+    {
+        g_pWriteFactory->CreateTextLayout(
+            lpszText,
+            cchText,
+            pTextFormat,
+            cxMax,
+            cyMax,
+            &pTextLayout
+        );
+    }
+
+    return pTextLayout;
+}
+
+IDWriteInlineObject* render::CreateEllipsisTrimmingSign(IDWriteTextFormat* pTextFormat)
+{
+    IDWriteInlineObject* pTrimmingSign = nullptr;
+
+    if (g_pWriteFactory)
+    {
+        g_pWriteFactory->CreateEllipsisTrimmingSign(pTextFormat, &pTrimmingSign);
+    }
+
+    return pTrimmingSign;
+}
+
 void render::FitRenderTargetToClient(ID2D1HwndRenderTarget* pRenderTarget)
 /*++
 * 
@@ -12,9 +12,11 @@ namespace render
 	void InitializeDirect2D(void);
 	void UninitializeDirect2D(void);
 
-	ID2D1HwndRenderTarget* CreateWindowRenderTarget(HWND hWnd);
+	ID2D1HwndRenderTarget* CreateWindowRenderTarget(HWND hWnd, D2D1_PRESENT_OPTIONS presentOptions = D2D1_PRESENT_OPTIONS_NONE);
 	ID2D1GdiInteropRenderTarget* GetInteropGDIRenderTarget(ID2D1RenderTarget* pRenderTarget);
 	IDWriteTextFormat* CreateTextFormat(LPCWSTR lpszFontName, float size, LPCWSTR lpszLocale);
+	IDWriteTextLayout* CreateTextLayout(LPCWSTR lpszText, UINT32 cchText, IDWriteTextFormat* pTextFormat, float cxMax, float cyMax);
+	IDWriteInlineObject* CreateEllipsisTrimmingSign(IDWriteTextFormat* pTextFormat);
 	ID2D1PathGeometry* CreatePathGeometry(void);
 
 	void FitRenderTargetToClient(ID2D1HwndRenderTarget* pRenderTarget);
@@ -0,0 +1,132 @@
+#pragma once
+
+#include <vector>
+#include <cstdint>
+#include <cassert>
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+class RowBitmap
+/*++
+*
+* Class Description:
+*
+*	A set of rows, with one bit for each row. Sets of the same rows are combined a
+*	word at a time, which is 64 rows per operation.
+*
+--*/
+{
+public:
+	RowBitmap(void) = default;
+	explicit RowBitmap(size_t cRows, bool isEveryRowSet = false)
+		: m_Words((cRows + 63) / 64, isEveryRowSet ? ~0ull : 0ull), m_cRows(cRows)
+	{
+		ClearUnusedBits();
+	}
+
+	inline size_t GetRowCount(void) const { return m_cRows; }
+
+	// Rows that are added aren't in the set
+	void Resize(size_t cRows)
+	{
+		m_Words.resize((cRows + 63) / 64, 0ull);
+		m_cRows = cRows;
+
+		if (!m_Words.empty())
+		{
+			ClearUnusedBits();
+		}
+	}
+
+	inline void Set(size_t row)
+	{
+		assert(row < m_cRows);
+		m_Words[row / 64] |= (1ull << (row % 64));
+	}
+
+	inline void Reset(size_t row)
+	{
+		assert(row < m_cRows);
+		m_Words[row / 64] &= ~(1ull << (row % 64));
+	}
+
+	inline bool Test(size_t row) const
+	{
+		assert(row < m_cRows);
+		return (m_Words[row / 64] >> (row % 64)) & 1;
+	}
+
+	// The others must be sets of the same rows
+	void And(const RowBitmap& other)
+	{
+		assert(other.m_cRows == m_cRows);
+
+		for (size_t i = 0; i < m_Words.size(); ++i)
+		{
+			m_Words[i] &= other.m_Words[i];
+		}
+	}
+
+	void AndNot(const RowBitmap& other)
+	{
+		assert(other.m_cRows == m_cRows);
+
+		for (size_t i = 0; i < m_Words.size(); ++i)
+		{
+			m_Words[i] &= ~other.m_Words[i];
+		}
+	}
+
+	void Or(const RowBitmap& other)
+	{
+		assert(other.m_cRows == m_cRows);
+
+		for (size_t i = 0; i < m_Words.size(); ++i)
+		{
+			m_Words[i] |= other.m_Words[i];
+		}
+	}
+
+	// Appends the rows in the set to out, in increasing order
+	void AppendRows(std::vector<int>& out) const
+	{
+		for (size_t i = 0; i < m_Words.size(); ++i)
+		{
+			uint64_t word = m_Words[i];
+
+			while (word != 0)
+			{
+				out.push_back(static_cast<int>(i * 64 + CountTrailingZeros(word)));
+
+				// Clears the lowest bit that is set
+				word &= word - 1;
+			}
+		}
+	}
+
+private:
+	void ClearUnusedBits(void)
+	{
+		if (m_cRows % 64 != 0 && !m_Words.empty())
+		{
+			m_Words.back() &= (1ull << (m_cRows % 64)) - 1;
+		}
+	}
+
+	static inline unsigned CountTrailingZeros(uint64_t word)
+	{
+#ifdef _MSC_VER
+		unsigned long index;
+		_BitScanForward64(&index, word);
+		return static_cast<unsigned>(index);
+#else
+		return static_cast<unsigned>(__builtin_ctzll(word));
+#endif
+	}
+
+private:
+	std::vector<uint64_t> m_Words;
+	size_t m_cRows = 0;
+};
@@ -0,0 +1,457 @@
+#include "RowProvider.h"
+#include "TextSearch.h"
+
+#include <cassert>
+#include <algorithm>
+
+// Returned for cells that a row doesn't have, e.g. when a column was added after the row
+static const std::wstring g_emptyCell;
+
+// Set in the stored cells that refer to strings of the provider's own. The global pool
+// can't hold more than 2^28 strings, so no handle of it has this bit set.
+#define OWN_STRING_FLAG 0x80000000u
+
+Row RowProvider::CopyRow(size_t row)
+{
+	const size_t cCells = GetCellCount(row);
+
+	Row copy;
+	copy.reserve(cCells);
+
+	for (size_t i = 0; i < cCells; ++i)
+	{
+		copy.emplace_back(GetCell(row, i));
+	}
+
+	return copy;
+}
+
+size_t MemoryRowProvider::GetRowCount(void)
+{
+	return m_Rows.size();
+}
+
+size_t MemoryRowProvider::GetCellCount(size_t row)
+{
+	assert(row < m_Rows.size());
+
+	return m_Rows[row].size();
+}
+
+const std::wstring& MemoryRowProvider::GetCell(size_t row, size_t column)
+{
+	assert(row < m_Rows.size());
+
+	return column < m_Rows[row].size() ? GetString(m_Rows[row][column]) : g_emptyCell;
+}
+
+const std::wstring& MemoryRowProvider::GetSearchKey(size_t row)
+{
+	assert(row < m_Rows.size());
+
+	return m_Index.GetSearchKey(row);
+}
+
+const std::wstring& MemoryRowProvider::GetString(StoredCell cell) const
+{
+	return (cell & OWN_STRING_FLAG) ? m_OwnStrings[cell & ~OWN_STRING_FLAG] : StringPool::GetGlobal().Get(cell);
+}
+
+MemoryRowProvider::StoredCell MemoryRowProvider::StoreOwnString(std::wstring&& text)
+{
+	if (m_FreeOwnStrings.empty())
+	{
+		m_OwnStrings.emplace_back(std::move(text));
+		return static_cast<StoredCell>(m_OwnStrings.size() - 1) | OWN_STRING_FLAG;
+	}
+
+	const uint32_t index = m_FreeOwnStrings.back();
+	m_FreeOwnStrings.pop_back();
+
+	m_OwnStrings[index] = std::move(text);
+	return index | OWN_STRING_FLAG;
+}
+
+void MemoryRowProvider::ReleaseOwnStrings(const StoredRow& row)
+{
+	for (StoredCell cell : row)
+	{
+		if (cell & OWN_STRING_FLAG)
+		{
+			// Swapped rather than cleared, which would keep the memory of the string
+			std::wstring().swap(m_OwnStrings[cell & ~OWN_STRING_FLAG]);
+			m_FreeOwnStrings.push_back(cell & ~OWN_STRING_FLAG);
+		}
+	}
+}
+
+std::wstring MemoryRowProvider::MakeSearchKey(const StoredRow& row) const
+{
+	std::wstring searchKey;
+	search::MakeSearchKeyOf(row, [this](StoredCell cell) -> const std::wstring& { return GetString(cell); }, searchKey);
+
+	return searchKey;
+}
+
+RowHandle MemoryRowProvider::AddRow(Row&& row)
+/*++
+*
+* Routine Description:
+*
+*	Adds a row whose cells are all its own, none of them interned.
+*
+* Arguments:
+*
+*	row - The cells of the row, which are moved into the provider.
+*
+* Return Value:
+*
+*	A handle that refers to the row for as long as it exists.
+*
+--*/
+{
+	StoredRow stored;
+	stored.reserve(row.size());
+
+	for (std::wstring& cell : row)
+	{
+		stored.push_back(StoreOwnString(std::move(cell)));
+	}
+
+	return AddStoredRow(std::move(stored));
+}
+
+RowHandle MemoryRowProvider::AddRow(PooledRow&& row)
+{
+	StoredRow stored;
+	stored.reserve(row.size());
+
+	for (PooledCell& cell : row)
+	{
+		stored.push_back(cell.handle != NOT_POOLED ? cell.handle : StoreOwnString(std::move(cell.text)));
+	}
+
+	return AddStoredRow(std::move(stored));
+}
+
+RowHandle MemoryRowProvider::AddStoredRow(StoredRow&& row)
+{
+	RowHandle handle;
+
+	if (m_FreeSlots.empty())
+	{
+		handle.slot = static_cast<uint32_t>(m_Slots.size());
+		m_Slots.emplace_back();
+	}
+
+	else
+	{
+		handle.slot = m_FreeSlots.back();
+		m_FreeSlots.pop_back();
+	}
+
+	Slot& slot = m_Slots[handle.slot];
+	slot.row = static_cast<uint32_t>(m_Rows.size());
+	handle.generation = slot.generation;
+
+	m_SlotsOfRows.push_back(handle.slot);
+
+	m_Index.AppendRow(MakeSearchKey(row));
+	m_Rows.emplace_back(std::move(row));
+
+	OnRowsChanged();
+
+	return handle;
+}
+
+void MemoryRowProvider::RemoveRow(size_t row)
+{
+	RemoveRows(std::vector<size_t>{ row });
+}
+
+void MemoryRowProvider::RemoveRows(std::vector<size_t> rows)
+/*++
+*
+* Routine Description:
+*
+*	Removes some rows at once. Every row after the first one removed is moved once,
+*	however many rows are removed, so this should be preferred to removing them one by one.
+*
+* Arguments:
+*
+*	rows - The rows, in any order. Duplicates are ignored.
+*
+* Return Value:
+*
+*	None.
+*
+--*/
+{
+	if (rows.empty())
+	{
+		return;
+	}
+
+	std::sort(rows.begin(), rows.end());
+	rows.erase(std::unique(rows.begin(), rows.end()), rows.end());
+
+	assert(rows.back() < m_Rows.size());
+
+	size_t iNextRemoved = 0;
+	size_t cRowsLeft = rows.front();
+
+	for (size_t row = rows.front(); row < m_Rows.size(); ++row)
+	{
+		const uint32_t iSlot = m_SlotsOfRows[row];
+
+		if (iNextRemoved < rows.size() && rows[iNextRemoved] == row)
+		{
+			ReleaseOwnStrings(m_Rows[row]);
+
+			++m_Slots[iSlot].generation;
+			m_FreeSlots.push_back(iSlot);
+			++iNextRemoved;
+			continue;
+		}
+
+		m_Rows[cRowsLeft] = std::move(m_Rows[row]);
+		m_SlotsOfRows[cRowsLeft] = iSlot;
+		m_Slots[iSlot].row = static_cast<uint32_t>(cRowsLeft);
+		++cRowsLeft;
+	}
+
+	m_Rows.resize(cRowsLeft);
+	m_SlotsOfRows.resize(cRowsLeft);
+
+	m_Index.EraseRows(rows);
+
+	OnRowsChanged();
+}
+
+RowHandle MemoryRowProvider::GetRowHandle(size_t row) const
+{
+	assert(row < m_Rows.size());
+
+	RowHandle handle;
+	handle.slot = m_SlotsOfRows[row];
+	handle.generation = m_Slots[handle.slot].generation;
+
+	return handle;
+}
+
+bool MemoryRowProvider::FindRow(const RowHandle& handle, size_t& row) const
+/*++
+*
+* Routine Description:
+*
+*	Finds the row a handle refers to.
+*
+* Arguments:
+*
+*	handle - The handle.
+*	row    - Receives the index of the row.
+*
+* Return Value:
+*
+*	False if the row has been removed.
+*
+--*/
+{
+	if (handle.slot >= m_Slots.size() || m_Slots[handle.slot].generation != handle.generation)
+	{
+		return false;
+	}
+
+	row = m_Slots[handle.slot].row;
+
+	return true;
+}
+
+void MemoryRowProvider::SetCell(size_t row, size_t column, const std::wstring& content)
+{
+	assert(row < m_Rows.size());
+
+	if (column < m_Rows[row].size())
+	{
+		StoredCell& cell = m_Rows[row][column];
+
+		// A cell stays in the pool, or out of it, as it was added
+		if (cell & OWN_STRING_FLAG)
+		{
+			m_OwnStrings[cell & ~OWN_STRING_FLAG] = content;
+		}
+
+		else
+		{
+			cell = StringPool::GetGlobal().Intern(content);
+		}
+
+		m_Index.UpdateRow(row, MakeSearchKey(m_Rows[row]));
+
+		OnRowsChanged();
+	}
+}
+
+void MemoryRowProvider::Clear(void)
+{
+	m_Rows.clear();
+	m_Index.Clear();
+
+	std::vector<std::wstring>().swap(m_OwnStrings);
+	std::vector<uint32_t>().swap(m_FreeOwnStrings);
+
+	// Handles of the rows are still around, so the slots are kept and their generations changed
+	for (uint32_t iSlot : m_SlotsOfRows)
+	{
+		++m_Slots[iSlot].generation;
+		m_FreeSlots.push_back(iSlot);
+	}
+
+	m_SlotsOfRows.clear();
+
+	OnRowsChanged();
+}
+
+void MemoryRowProvider::FindRowsContaining(const std::wstring& text, std::vector<int>& out)
+/*++
+*
+* Routine Description:
+*
+*	Finds every row that has a cell containing the given text, regardless of case and accents.
+*
+* Arguments:
+*
+*	text - The text to look for. If it is empty, every row is found.
+*	out  - Receives the indexes of the rows that were found, in increasing order.
+*
+* Return Value:
+*
+*	None.
+*
+--*/
+{
+	m_Index.Find(text, out);
+}
+
+WindowedRowProvider::WindowedRowProvider(size_t cRowsPerPage, size_t cMaxPages)
+	: m_cRowsPerPage(std::max<size_t>(cRowsPerPage, 1)),
+	  // At least two pages must fit, otherwise comparing the cells of two rows
+	  // that are on different pages would invalidate the first reference
+	  m_cMaxPages(std::max<size_t>(cMaxPages, 2))
+{
+}
+
+size_t WindowedRowProvider::GetRowCount(void)
+{
+	if (!m_isRowCountKnown)
+	{
+		m_cRows = CountRows();
+		m_isRowCountKnown = true;
+	}
+
+	return m_cRows;
+}
+
+size_t WindowedRowProvider::GetCellCount(size_t row)
+{
+	const Row* pRow = FindRow(row);
+
+	return pRow ? pRow->size() : 0;
+}
+
+const std::wstring& WindowedRowProvider::GetCell(size_t row, size_t column)
+{
+	const Row* pRow = FindRow(row);
+
+	if (pRow && column < pRow->size())
+	{
+		return (*pRow)[column];
+	}
+
+	return g_emptyCell;
+}
+
+const std::wstring& WindowedRowProvider::GetSearchKey(size_t row)
+{
+	Page* pPage = FindPage(row);
+
+	if (!pPage || row - pPage->first >= pPage->rows.size())
+	{
+		return g_emptyCell;
+	}
+
+	// Most pages are only ever drawn, so their keys are made the first time they're searched
+	if (pPage->searchKeys.size() != pPage->rows.size())
+	{
+		pPage->searchKeys.resize(pPage->rows.size());
+
+		for (size_t i = 0; i < pPage->rows.size(); ++i)
+		{
+			search::MakeSearchKey(pPage->rows[i], pPage->searchKeys[i]);
+		}
+	}
+
+	return pPage->searchKeys[row - pPage->first];
+}
+
+void WindowedRowProvider::Invalidate(void)
+{
+	m_Pages.clear();
+	m_isRowCountKnown = false;
+}
+
+const Row* WindowedRowProvider::FindRow(size_t row)
+{
+	const Page* pPage = FindPage(row);
+
+	return (pPage && row - pPage->first < pPage->rows.size()) ? &pPage->rows[row - pPage->first] : nullptr;
+}
+
+WindowedRowProvider::Page* WindowedRowProvider::FindPage(size_t row)
+/*++
+*
+* Routine Description:
+*
+*	Returns the page that the row at the given index belongs to, fetching it if it isn't cached.
+*
+* Arguments:
+*
+*	row - Index of the row, starting from 0.
+*
+* Return Value:
+*
+*	Pointer to the page, or nullptr if there is no such row.
+*
+--*/
+{
+	if (row >= GetRowCount())
+	{
+		return nullptr;
+	}
+
+	const size_t first = row - row % m_cRowsPerPage;
+
+	auto it = std::find_if(m_Pages.begin(), m_Pages.end(), [first](const Page& page) {
+		return page.first == first;
+	});
+
+	if (it != m_Pages.end())
+	{
+		// Move the page to the front because it is now the most recently used one
+		m_Pages.splice(m_Pages.begin(), m_Pages, it);
+	}
+
+	else
+	{
+		if (m_Pages.size() >= m_cMaxPages)
+		{
+			m_Pages.pop_back();
+		}
+
+		m_Pages.emplace_front();
+		m_Pages.front().first = first;
+		FetchRows(first, std::min(m_cRowsPerPage, GetRowCount() - first), m_Pages.front().rows);
+	}
+
+	return &m_Pages.front();
+}
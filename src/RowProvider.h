@@ -0,0 +1,222 @@
+#pragma once
+
+#include "SearchIndex.h"
+#include "StringPool.h"
+
+#include <vector>
+#include <string>
+#include <list>
+#include <cstdint>
+
+using Row = std::vector<std::wstring>;
+
+// The handle of a PooledCell whose text isn't in the pool
+#define NOT_POOLED UINT32_MAX
+
+struct PooledCell
+/*++
+*
+* Class Description:
+*
+*	A cell of a row that is added to a MemoryRowProvider, which is either a string of
+*	the global StringPool or text of the row's own. Values that many rows share, such
+*	as states and names, should be interned, so they are stored once. Values that are
+*	unique to the row, such as ids and notes, should be given as text, so that they're
+*	let go of along with the row rather than staying in the pool.
+*
+--*/
+{
+	StringHandle handle = NOT_POOLED;
+	std::wstring text;
+
+	PooledCell(StringHandle handle) : handle(handle) {}
+	PooledCell(std::wstring text) : text(std::move(text)) {}
+};
+
+using PooledRow = std::vector<PooledCell>;
+
+struct RowHandle
+/*++
+*
+* Class Description:
+*
+*	Refers to a row of a MemoryRowProvider for as long as the row exists, however many
+*	rows are added or removed in the meantime. A handle of a removed row never refers
+*	to any other row, even one that has been given the same slot since then.
+*
+--*/
+{
+	uint32_t slot = UINT32_MAX;
+	uint32_t generation = 0;
+
+	bool operator==(const RowHandle& other) const { return slot == other.slot && generation == other.generation; }
+	bool operator!=(const RowHandle& other) const { return !(*this == other); }
+};
+
+class RowProvider
+/*++
+*
+* Class Description:
+*
+*	The source a ListView reads its rows from. The ListView only ever asks for the
+*	cells of the rows it is about to draw, so a provider is free to keep just a part
+*	of its rows in memory and produce the rest on demand.
+*
+*	References returned by GetCell must stay valid at least until GetCell is called
+*	for a row that is not among the two most recently requested ones.
+*
+--*/
+{
+public:
+	virtual ~RowProvider(void) = default;
+
+	virtual size_t GetRowCount(void) = 0;
+	virtual size_t GetCellCount(size_t row) = 0;
+	virtual const std::wstring& GetCell(size_t row, size_t column) = 0;
+
+	// The row's cells as search text is compared to them, see search::MakeSearchKey
+	virtual const std::wstring& GetSearchKey(size_t row) = 0;
+
+	Row CopyRow(size_t row);
+
+	// Changes whenever a row is added, removed or changed, so that whatever has been
+	// worked out from the rows can tell whether it is still up to date
+	uint64_t GetVersion(void) const { return m_Version; }
+
+protected:
+	void OnRowsChanged(void) { ++m_Version; }
+
+private:
+	uint64_t m_Version = 0;
+};
+
+class MemoryRowProvider : public RowProvider
+/*++
+*
+* Class Description:
+*
+*	Keeps every row in memory. This is the only kind of provider whose rows can be
+*	changed, and it's what every ListView uses unless it is given a different one.
+*
+*	Each cell takes 4 bytes. Cells that were added as strings of the global StringPool
+*	are kept as their handles, so a value that is in many rows is stored only once. Any
+*	other cell refers to a string of the provider's own, which is let go of as soon as
+*	its row is removed or the cell is given a different value.
+*
+*	The rows are indexed as they change, so that the ones containing some text can
+*	be found without going through all of them.
+*
+--*/
+{
+public:
+	size_t GetRowCount(void) override;
+	size_t GetCellCount(size_t row) override;
+	const std::wstring& GetCell(size_t row, size_t column) override;
+	const std::wstring& GetSearchKey(size_t row) override;
+
+	RowHandle AddRow(Row&& row);
+	RowHandle AddRow(PooledRow&& row);
+	void RemoveRow(size_t row);
+	void RemoveRows(std::vector<size_t> rows);
+	void SetCell(size_t row, size_t column, const std::wstring& content);
+	void Clear(void);
+
+	RowHandle GetRowHandle(size_t row) const;
+	bool FindRow(const RowHandle& handle, size_t& row) const;
+
+	bool IsEmpty(void) const { return m_Rows.empty(); }
+
+	void FindRowsContaining(const std::wstring& text, std::vector<int>& out);
+
+	void SetMinSearchRowsPerThread(size_t cRows) { m_Index.SetMinRowsPerThread(cRows); }
+
+private:
+	// A handle of a string of the global pool, or, if OWN_STRING_FLAG is set, the index
+	// of a string in m_OwnStrings
+	using StoredCell = uint32_t;
+	using StoredRow = std::vector<StoredCell>;
+
+	RowHandle AddStoredRow(StoredRow&& row);
+	StoredCell StoreOwnString(std::wstring&& text);
+	void ReleaseOwnStrings(const StoredRow& row);
+	const std::wstring& GetString(StoredCell cell) const;
+	std::wstring MakeSearchKey(const StoredRow& row) const;
+
+private:
+	std::vector<StoredRow> m_Rows;
+	SearchIndex m_Index;
+
+	// The strings of the cells that aren't in the pool. The ones that no cell refers to
+	// any more are emptied and given to the next cells that need one.
+	std::vector<std::wstring> m_OwnStrings;
+	std::vector<uint32_t> m_FreeOwnStrings;
+
+	// Every handle refers to a slot, which holds the row the handle refers to. A slot's
+	// generation changes whenever its row is removed, so the handles that refer to it
+	// until then don't match it any more, and it is then given to the next row added.
+	struct Slot
+	{
+		uint32_t generation = 0;
+		uint32_t row = 0;
+	};
+
+	std::vector<Slot> m_Slots;
+	std::vector<uint32_t> m_FreeSlots;
+
+	// m_SlotsOfRows[row] is the slot of the row
+	std::vector<uint32_t> m_SlotsOfRows;
+};
+
+class WindowedRowProvider : public RowProvider
+/*++
+*
+* Class Description:
+*
+*	Keeps a small number of fixed-size pages of rows in memory and fetches any other
+*	page the moment one of its rows is requested, evicting the least recently used one.
+*
+*	Derived classes only have to count their rows and fetch a range of them; the
+*	paging itself doesn't depend on where the rows come from.
+*
+--*/
+{
+public:
+	WindowedRowProvider(size_t cRowsPerPage = 64, size_t cMaxPages = 8);
+
+	size_t GetRowCount(void) override;
+	size_t GetCellCount(size_t row) override;
+	const std::wstring& GetCell(size_t row, size_t column) override;
+	const std::wstring& GetSearchKey(size_t row) override;
+
+	// Drops every cached page and the row count, so that they're fetched again
+	void Invalidate(void);
+
+	size_t GetCachedPageCount(void) const { return m_Pages.size(); }
+
+protected:
+	virtual size_t CountRows(void) = 0;
+	virtual void FetchRows(size_t first, size_t count, std::vector<Row>& out) = 0;
+
+private:
+	struct Page
+	{
+		size_t first = 0;
+		std::vector<Row> rows;
+
+		// Either empty, or the search key of each row
+		std::vector<std::wstring> searchKeys;
+	};
+
+	const Row* FindRow(size_t row);
+	Page* FindPage(size_t row);
+
+private:
+	// Most recently used page first
+	std::list<Page> m_Pages;
+
+	size_t m_cRowsPerPage;
+	size_t m_cMaxPages;
+
+	size_t m_cRows = 0;
+	bool m_isRowCountKnown = false;
+};
@@ -0,0 +1,129 @@
+#include "RowStore.h"
+
+#include <algorithm>
+#include <cassert>
+
+RowHandle RowStore::AddRow(Row&& row)
+{
+	return AddRowOf(std::move(row));
+}
+
+RowHandle RowStore::AddRow(PooledRow&& row)
+{
+	return AddRowOf(std::move(row));
+}
+
+template<typename Cells>
+RowHandle RowStore::AddRowOf(Cells&& row)
+{
+	const uint64_t version = GetVersion();
+
+	const RowHandle handle = m_Rows.AddRow(std::move(row));
+	OnRowsChanged();
+
+	for (RowStoreListener* pListener : m_Listeners)
+	{
+		pListener->OnRowAdded(m_Rows.GetRowCount() - 1, version);
+	}
+
+	return handle;
+}
+
+void RowStore::RemoveRows(std::vector<size_t> rows)
+/*++
+*
+* Routine Description:
+*
+*	Removes some rows at once and tells the listeners where each row that is left was
+*	moved to, so that each of them goes through the rows it displays only once.
+*
+* Arguments:
+*
+*	rows - The rows, in any order. Duplicates are ignored.
+*
+* Return Value:
+*
+*	None.
+*
+--*/
+{
+	if (rows.empty())
+	{
+		return;
+	}
+
+	// newIndexes[row] is the index the row will have once the rows have been removed
+	std::vector<int> newIndexes(m_Rows.GetRowCount(), 0);
+
+	for (size_t row : rows)
+	{
+		assert(row < newIndexes.size());
+
+		newIndexes[row] = ROW_INDEX_NONE;
+	}
+
+	int iNextIndex = 0;
+
+	for (int& newIndex : newIndexes)
+	{
+		if (newIndex != ROW_INDEX_NONE)
+		{
+			newIndex = iNextIndex++;
+		}
+	}
+
+	const uint64_t version = GetVersion();
+
+	m_Rows.RemoveRows(std::move(rows));
+	OnRowsChanged();
+
+	for (RowStoreListener* pListener : m_Listeners)
+	{
+		pListener->OnRowsRemoved(newIndexes, version);
+	}
+}
+
+void RowStore::SetCell(size_t row, size_t column, const std::wstring& content)
+{
+	// Cells are never added to a row, so there's nothing to change
+	if (column >= m_Rows.GetCellCount(row))
+	{
+		return;
+	}
+
+	const uint64_t version = GetVersion();
+
+	m_Rows.SetCell(row, column, content);
+	OnRowsChanged();
+
+	for (RowStoreListener* pListener : m_Listeners)
+	{
+		pListener->OnRowChanged(row, version);
+	}
+}
+
+void RowStore::Clear(void)
+{
+	m_Rows.Clear();
+	OnRowsChanged();
+
+	for (RowStoreListener* pListener : m_Listeners)
+	{
+		pListener->OnRowsCleared();
+	}
+}
+
+void RowStore::AddListener(RowStoreListener* pListener)
+{
+	assert(pListener);
+
+	if (std::find(m_Listeners.begin(), m_Listeners.end(), pListener) == m_Listeners.end())
+	{
+		m_Listeners.push_back(pListener);
+	}
+}
+
+void RowStore::RemoveListener(RowStoreListener* pListener)
+{
+	m_Listeners.erase(std::remove(m_Listeners.begin(), m_Listeners.end(), pListener), m_Listeners.end());
+}
@@ -0,0 +1,83 @@
+#pragma once
+
+#include "RowProvider.h"
+
+#include <vector>
+#include <string>
+#include <cstdint>
+
+#ifndef ROW_INDEX_NONE
+#define ROW_INDEX_NONE (-1)
+#endif
+
+class RowStoreListener
+/*++
+*
+* Class Description:
+*
+*	Is told about every change made to the rows of a RowStore. Each function is called
+*	once the rows have been changed, with the version the store had before the change.
+*
+--*/
+{
+public:
+	virtual ~RowStoreListener(void) = default;
+
+	// The row is the last one of the store
+	virtual void OnRowAdded(size_t row, uint64_t version) = 0;
+	virtual void OnRowChanged(size_t row, uint64_t version) = 0;
+
+	// newIndexes[row] is the index the row was moved to, or ROW_INDEX_NONE if it was removed
+	virtual void OnRowsRemoved(const std::vector<int>& newIndexes, uint64_t version) = 0;
+
+	virtual void OnRowsCleared(void) = 0;
+};
+
+class RowStore : public RowProvider
+/*++
+*
+* Class Description:
+*
+*	The rows of one or more lists. Every list that displays the rows holds a reference
+*	to the store and listens to it, so that a row added, changed or removed through any
+*	of them is seen by all of them, while each one decides on its own which rows it
+*	displays and in what order.
+*
+--*/
+{
+public:
+	RowStore(void) = default;
+	RowStore(const RowStore&) = delete;
+	RowStore& operator=(const RowStore&) = delete;
+
+	size_t GetRowCount(void) override { return m_Rows.GetRowCount(); }
+	size_t GetCellCount(size_t row) override { return m_Rows.GetCellCount(row); }
+	const std::wstring& GetCell(size_t row, size_t column) override { return m_Rows.GetCell(row, column); }
+	const std::wstring& GetSearchKey(size_t row) override { return m_Rows.GetSearchKey(row); }
+
+	RowHandle AddRow(Row&& row);
+	RowHandle AddRow(PooledRow&& row);
+	void RemoveRows(std::vector<size_t> rows);
+	void SetCell(size_t row, size_t column, const std::wstring& content);
+	void Clear(void);
+
+	RowHandle GetRowHandle(size_t row) const { return m_Rows.GetRowHandle(row); }
+	bool FindRow(const RowHandle& handle, size_t& row) const { return m_Rows.FindRow(handle, row); }
+
+	bool IsEmpty(void) const { return m_Rows.IsEmpty(); }
+
+	void FindRowsContaining(const std::wstring& text, std::vector<int>& out) { m_Rows.FindRowsContaining(text, out); }
+
+	void AddListener(RowStoreListener* pListener);
+	void RemoveListener(RowStoreListener* pListener);
+
+private:
+	// Cells is either a Row or a PooledRow
+	template<typename Cells>
+	RowHandle AddRowOf(Cells&& row);
+
+private:
+	MemoryRowProvider m_Rows;
+
+	std::vector<RowStoreListener*> m_Listeners;
+};
@@ -0,0 +1,146 @@
+#include "ScrollModel.h"
+
+#include <algorithm>
+
+// The greatest scrollbar position used, leaving plenty of room below INT_MAX for
+// the additions Win32 does with the range and page of a scrollbar
+#define MAX_SCROLL_BAR_RANGE 0x3FFFFFFF
+
+void ScrollModel::SetRowCount(size_t cRows)
+{
+	m_cRows = cRows;
+	ScrollTo(m_Position);
+}
+
+void ScrollModel::SetRowHeight(int cyRow)
+{
+	m_cyRow = (std::max)(cyRow, 1);
+	ScrollTo(m_Position);
+}
+
+void ScrollModel::SetViewportHeight(int cyViewport)
+{
+	m_cyViewport = (std::max)(cyViewport, 0);
+	ScrollTo(m_Position);
+}
+
+int64_t ScrollModel::GetMaxPosition(void) const
+{
+	// Even a viewport with no height shows where the list is scrolled to, so the
+	// position never goes past the last pixel of the rows
+	return (std::max)(GetContentHeight() - (std::max)(m_cyViewport, 1), static_cast<int64_t>(0));
+}
+
+int64_t ScrollModel::ScrollTo(int64_t position)
+{
+	const int64_t oldPosition = m_Position;
+
+	m_Position = (std::min)((std::max)(position, static_cast<int64_t>(0)), GetMaxPosition());
+
+	return m_Position - oldPosition;
+}
+
+int64_t ScrollModel::ScrollBy(int64_t cyDelta)
+{
+	return ScrollTo(m_Position + cyDelta);
+}
+
+void ScrollModel::GetRowsBetween(int64_t yTop, int64_t yBottom, size_t& first, size_t& end) const
+{
+	yTop = m_Position + (std::max)(yTop, static_cast<int64_t>(0));
+	yBottom = m_Position + (std::min)(yBottom, static_cast<int64_t>(m_cyViewport));
+
+	first = (std::min)(static_cast<size_t>(yTop / m_cyRow), m_cRows);
+
+	// Rows that are only partly between them count as well
+	end = (yBottom > yTop) ? (std::min)(static_cast<size_t>((yBottom + m_cyRow - 1) / m_cyRow), m_cRows) : first;
+}
+
+int64_t ScrollModel::GetRowTop(size_t row) const
+{
+	return static_cast<int64_t>(row) * m_cyRow - m_Position;
+}
+
+bool ScrollModel::GetRowAt(int64_t yViewport, size_t& row) const
+{
+	const int64_t y = m_Position + yViewport;
+
+	if (y < 0 || y >= GetContentHeight())
+	{
+		return false;
+	}
+
+	row = static_cast<size_t>(y / m_cyRow);
+	return true;
+}
+
+int64_t ScrollModel::GetPixelsPerScrollBarUnit(void) const
+{
+	return GetContentHeight() / MAX_SCROLL_BAR_RANGE + 1;
+}
+
+int ScrollModel::GetScrollBarMax(void) const
+/*++
+*
+* Routine Description:
+*
+*	Returns the maximum of the range of the scrollbar. Together with the page, this makes
+*	the thumb as long as the part of the list that is visible, and lets it move as far as
+*	the list can be scrolled.
+*
+* Arguments:
+*
+*	None.
+*
+* Return Value:
+*
+*	The maximum, or zero if the list is empty.
+*
+--*/
+{
+	if (GetContentHeight() == 0)
+	{
+		return 0;
+	}
+
+	return static_cast<int>((GetContentHeight() - 1) / GetPixelsPerScrollBarUnit());
+}
+
+int ScrollModel::GetScrollBarPage(void) const
+{
+	return static_cast<int>((std::min)(static_cast<int64_t>(m_cyViewport), GetContentHeight()) / GetPixelsPerScrollBarUnit());
+}
+
+int ScrollModel::GetScrollBarPosition(void) const
+{
+	return static_cast<int>(m_Position / GetPixelsPerScrollBarUnit());
+}
+
+int64_t ScrollModel::GetPositionOfScrollBar(int scrollBarPosition) const
+/*++
+*
+* Routine Description:
+*
+*	Finds the position the list is scrolled to when the thumb of its scrollbar is at
+*	a given position.
+*
+* Arguments:
+*
+*	scrollBarPosition - The position of the thumb, as given by the scrollbar.
+*
+* Return Value:
+*
+*	The position, in range. When the thumb is at the end of the scrollbar, so is the
+*	list, even if the units of the scrollbar are too coarse to get there exactly.
+*
+--*/
+{
+	const int maxScrollBarPosition = GetScrollBarMax() - (std::max)(GetScrollBarPage(), 1) + 1;
+
+	if (scrollBarPosition >= maxScrollBarPosition)
+	{
+		return GetMaxPosition();
+	}
+
+	return (std::min)((std::max)(static_cast<int64_t>(scrollBarPosition), static_cast<int64_t>(0)) * GetPixelsPerScrollBarUnit(), GetMaxPosition());
+}
@@ -0,0 +1,62 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+class ScrollModel
+/*++
+*
+* Class Description:
+*
+*	Keeps track of how far a list of rows of the same height has been scrolled, in
+*	pixels from the top of its first row. Positions are 64 bit, so even lists whose
+*	height doesn't fit in an int can be scrolled all the way through, and the rows
+*	that are visible are worked out without ever looking at the ones that aren't.
+*
+*	Scrollbars only take int positions, so the model also maps its positions to
+*	scrollbar units and back. Units are pixels unless the list is so tall that they
+*	don't fit, in which case each unit is a fixed number of pixels.
+*
+--*/
+{
+public:
+	// These keep the position in range, so they may scroll the list
+	void SetRowCount(size_t cRows);
+	void SetRowHeight(int cyRow);
+	void SetViewportHeight(int cyViewport);
+
+	inline int64_t GetPosition(void) const { return m_Position; }
+	int64_t GetMaxPosition(void) const;
+
+	// These return how many pixels the list moved up by, which is negative if it moved down
+	int64_t ScrollTo(int64_t position);
+	int64_t ScrollBy(int64_t cyDelta);
+
+	inline int GetViewportHeight(void) const { return m_cyViewport; }
+
+	// Finds the rows that are at least partly between two heights of the viewport,
+	// which are rows [first, end). Parts above or below the viewport are left out.
+	void GetRowsBetween(int64_t yTop, int64_t yBottom, size_t& first, size_t& end) const;
+
+	// The top of a row relative to the top of the viewport
+	int64_t GetRowTop(size_t row) const;
+
+	// Returns false if the point is below the last row
+	bool GetRowAt(int64_t yViewport, size_t& row) const;
+
+	int GetScrollBarMax(void) const;
+	int GetScrollBarPage(void) const;
+	int GetScrollBarPosition(void) const;
+	int64_t GetPositionOfScrollBar(int scrollBarPosition) const;
+
+private:
+	inline int64_t GetContentHeight(void) const { return static_cast<int64_t>(m_cRows) * m_cyRow; }
+	int64_t GetPixelsPerScrollBarUnit(void) const;
+
+private:
+	size_t m_cRows = 0;
+	int m_cyRow = 1;
+	int m_cyViewport = 0;
+
+	int64_t m_Position = 0;
+};
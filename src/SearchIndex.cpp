@@ -0,0 +1,360 @@
+﻿#include "SearchIndex.h"
+#include "TextSearch.h"
+#include "Parallel.h"
+
+#include <algorithm>
+#include <cassert>
+
+// Enough for any code point, so that trigrams of different characters never share a value
+#define TRIGRAM_CHAR_BITS 21
+#define TRIGRAM_CHAR_MASK ((1u << TRIGRAM_CHAR_BITS) - 1)
+
+// Marks an id whose row has been erased
+#define ROW_OF_ERASED_ID UINT32_MAX
+
+// How many searches are remembered, which is how many letters can be deleted
+// in a row before the results have to be looked up in the index again
+#define MAX_RECENT_SEARCHES 8
+
+void SearchIndex::CollectTrigrams(const std::wstring& foldedText, std::vector<Trigram>& out)
+{
+	if (foldedText.length() < 3)
+	{
+		return;
+	}
+
+	Trigram trigram = 0;
+
+	for (size_t i = 0; i < foldedText.length(); ++i)
+	{
+		const Trigram c = static_cast<Trigram>(foldedText[i]) & TRIGRAM_CHAR_MASK;
+
+		// Shift the oldest character out and the newest one in
+		trigram = ((trigram << TRIGRAM_CHAR_BITS) | c) & ((1ull << (3 * TRIGRAM_CHAR_BITS)) - 1);
+
+		if (i >= 2)
+		{
+			out.push_back(trigram);
+		}
+	}
+}
+
+void SearchIndex::CollectDistinctTrigrams(const std::wstring& foldedText, std::vector<Trigram>& out)
+{
+	CollectTrigrams(foldedText, out);
+
+	std::sort(out.begin(), out.end());
+	out.erase(std::unique(out.begin(), out.end()), out.end());
+}
+
+void SearchIndex::AddPostings(RowId id, const std::wstring& searchKey)
+{
+	std::vector<Trigram> trigrams;
+	CollectDistinctTrigrams(searchKey, trigrams);
+
+	for (Trigram trigram : trigrams)
+	{
+		std::vector<RowId>& ids = m_Postings[trigram];
+
+		// Appended rows always have the greatest id so far, only changed rows don't
+		if (ids.empty() || ids.back() < id)
+		{
+			ids.push_back(id);
+		}
+
+		else
+		{
+			auto it = std::lower_bound(ids.begin(), ids.end(), id);
+
+			if (it == ids.end() || *it != id)
+			{
+				ids.insert(it, id);
+			}
+		}
+	}
+}
+
+void SearchIndex::RemovePostings(RowId id, const std::wstring& searchKey)
+{
+	std::vector<Trigram> trigrams;
+	CollectDistinctTrigrams(searchKey, trigrams);
+
+	for (Trigram trigram : trigrams)
+	{
+		auto posting = m_Postings.find(trigram);
+
+		if (posting == m_Postings.end())
+		{
+			continue;
+		}
+
+		std::vector<RowId>& ids = posting->second;
+		auto it = std::lower_bound(ids.begin(), ids.end(), id);
+
+		if (it != ids.end() && *it == id)
+		{
+			ids.erase(it);
+		}
+
+		if (ids.empty())
+		{
+			m_Postings.erase(posting);
+		}
+	}
+}
+
+void SearchIndex::UpdateRowsOfIds(void)
+{
+	if (!m_areRowsOfIdsStale && m_RowsOfIds.size() == m_NextId)
+	{
+		return;
+	}
+
+	m_RowsOfIds.assign(m_NextId, ROW_OF_ERASED_ID);
+
+	for (size_t i = 0; i < m_IdsOfRows.size(); ++i)
+	{
+		m_RowsOfIds[m_IdsOfRows[i]] = static_cast<uint32_t>(i);
+	}
+
+	m_areRowsOfIdsStale = false;
+}
+
+void SearchIndex::AppendRow(std::wstring&& searchKey)
+{
+	m_RecentSearches.clear();
+
+	const RowId id = m_NextId++;
+
+	m_SearchKeys.emplace_back(std::move(searchKey));
+
+	AddPostings(id, m_SearchKeys.back());
+	m_IdsOfRows.push_back(id);
+
+	if (!m_areRowsOfIdsStale)
+	{
+		m_RowsOfIds.push_back(static_cast<uint32_t>(m_IdsOfRows.size() - 1));
+	}
+}
+
+void SearchIndex::EraseRows(const std::vector<size_t>& rows)
+/*++
+*
+* Routine Description:
+*
+*	Erases some rows at once, moving every row that is left only once.
+*
+* Arguments:
+*
+*	rows - The rows, in increasing order and without duplicates.
+*
+* Return Value:
+*
+*	None.
+*
+--*/
+{
+	if (rows.empty())
+	{
+		return;
+	}
+
+	m_RecentSearches.clear();
+
+	size_t iNextErased = 0;
+	size_t cRowsLeft = rows.front();
+
+	for (size_t row = rows.front(); row < m_IdsOfRows.size(); ++row)
+	{
+		if (iNextErased < rows.size() && rows[iNextErased] == row)
+		{
+			RemovePostings(m_IdsOfRows[row], m_SearchKeys[row]);
+			++iNextErased;
+			continue;
+		}
+
+		m_IdsOfRows[cRowsLeft] = m_IdsOfRows[row];
+		m_SearchKeys[cRowsLeft] = std::move(m_SearchKeys[row]);
+		++cRowsLeft;
+	}
+
+	assert(iNextErased == rows.size());
+
+	m_IdsOfRows.resize(cRowsLeft);
+	m_SearchKeys.resize(cRowsLeft);
+
+	m_areRowsOfIdsStale = true;
+}
+
+void SearchIndex::UpdateRow(size_t row, std::wstring&& searchKey)
+{
+	m_RecentSearches.clear();
+
+	assert(row < m_IdsOfRows.size());
+
+	// Every trigram of the row is removed and added back, since even a trigram that
+	// was only in the changed cell may still be in one of the others
+	RemovePostings(m_IdsOfRows[row], m_SearchKeys[row]);
+	m_SearchKeys[row] = std::move(searchKey);
+	AddPostings(m_IdsOfRows[row], m_SearchKeys[row]);
+}
+
+void SearchIndex::Clear(void)
+{
+	m_RecentSearches.clear();
+
+	m_Postings.clear();
+	m_IdsOfRows.clear();
+	m_SearchKeys.clear();
+	m_RowsOfIds.clear();
+	m_areRowsOfIdsStale = false;
+	m_NextId = 0;
+}
+
+void SearchIndex::Find(const std::wstring& text, std::vector<int>& out)
+/*++
+*
+* Routine Description:
+*
+*	Finds every row that has at least one cell containing the given text.
+*
+*	The results of the last few searches are kept until the rows change. Any row that
+*	contains the text also contains every part of it, so when a previous search was for
+*	a part of the text, only the rows it found need to be looked at. This is the case
+*	whenever the user types one more letter, and when they delete one, the previous
+*	search was for the exact same text, so its results are reused as they are.
+*
+* Arguments:
+*
+*	text - The text to look for. If it is empty, every row is found.
+*	out  - Receives the indexes of the rows that were found, in increasing order.
+*
+* Return Value:
+*
+*	None.
+*
+--*/
+{
+	const std::wstring foldedText = search::MakeSearchText(text);
+
+	// Only searches for a part of this text can narrow it down, and since the text
+	// usually changes a letter at a time, the ones that can't won't be useful later either
+	while (!m_RecentSearches.empty() && foldedText.find(m_RecentSearches.back().foldedText) == std::wstring::npos)
+	{
+		m_RecentSearches.pop_back();
+	}
+
+	out.clear();
+
+	if (foldedText.empty())
+	{
+		out.resize(m_IdsOfRows.size());
+
+		for (size_t i = 0; i < out.size(); ++i)
+		{
+			out[i] = static_cast<int>(i);
+		}
+
+		return;
+	}
+
+	UpdateRowsOfIds();
+
+	if (m_RecentSearches.empty() || m_RecentSearches.back().foldedText != foldedText)
+	{
+		RecentSearch recent;
+		recent.foldedText = foldedText;
+
+		FindIds(foldedText, recent.ids);
+
+		if (m_RecentSearches.size() == MAX_RECENT_SEARCHES)
+		{
+			m_RecentSearches.erase(m_RecentSearches.begin());
+		}
+
+		m_RecentSearches.emplace_back(std::move(recent));
+	}
+
+	const std::vector<RowId>& ids = m_RecentSearches.back().ids;
+	out.reserve(ids.size());
+
+	for (RowId id : ids)
+	{
+		out.push_back(static_cast<int>(m_RowsOfIds[id]));
+	}
+}
+
+void SearchIndex::FindIds(const std::wstring& foldedText, std::vector<RowId>& out)
+/*++
+*
+* Routine Description:
+*
+*	Finds the ids of the rows that contain some text, narrowing down the rows that have
+*	to be checked with the trigrams of the text, and with the results of the most recent
+*	search, which must have been for a part of the text.
+*
+* Arguments:
+*
+*	foldedText - The text, as made by search::MakeSearchText. Must not be empty.
+*	out        - Receives the ids of the rows that were found, in increasing order.
+*
+* Return Value:
+*
+*	None.
+*
+--*/
+{
+	const auto RowContainsText = [&](size_t row) {
+		return search::Contains(m_SearchKeys[row], foldedText);
+	};
+
+	// Every row that is found appears in each of these lists
+	std::vector<const std::vector<RowId>*> lists;
+
+	if (!m_RecentSearches.empty())
+	{
+		lists.push_back(&m_RecentSearches.back().ids);
+	}
+
+	std::vector<Trigram> trigrams;
+	CollectDistinctTrigrams(foldedText, trigrams);
+
+	for (Trigram trigram : trigrams)
+	{
+		auto posting = m_Postings.find(trigram);
+
+		// No row has this trigram, so no row can contain the text
+		if (posting == m_Postings.end())
+		{
+			return;
+		}
+
+		lists.push_back(&posting->second);
+	}
+
+	// Starting from the shortest list keeps the candidates as few as possible throughout
+	std::sort(lists.begin(), lists.end(), [](const std::vector<RowId>* a, const std::vector<RowId>* b) {
+		return a->size() < b->size();
+	});
+
+	// With nothing to narrow them down, every row is a candidate. Ids are in the same
+	// order as rows, so the ones of the rows that are found still come out in order.
+	out = lists.empty() ? m_IdsOfRows : *lists[0];
+
+	for (size_t i = 1; i < lists.size() && !out.empty(); ++i)
+	{
+		const std::vector<RowId>& ids = *lists[i];
+		auto it = ids.begin();
+
+		out.erase(std::remove_if(out.begin(), out.end(), [&](RowId id) {
+			it = std::lower_bound(it, ids.end(), id);
+			return it == ids.end() || *it != id;
+		}), out.end());
+	}
+
+	// Having every trigram doesn't mean having them in the right order. This is by far
+	// the slowest part, so it is the part that is spread across threads.
+	parallel::RemoveIf(out, [this, &RowContainsText](RowId id) {
+		return !RowContainsText(m_RowsOfIds[id]);
+	}, m_cMinRowsPerThread);
+}
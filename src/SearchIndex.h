@@ -0,0 +1,91 @@
+#pragma once
+
+#include <vector>
+#include <string>
+#include <unordered_map>
+#include <cstdint>
+
+#define DEFAULT_MIN_SEARCH_ROWS_PER_THREAD 16384
+
+class SearchIndex
+/*++
+*
+* Class Description:
+*
+*	Finds the rows that have a cell containing some text, without looking at every row.
+*
+*	Every sequence of three consecutive characters (trigram) in the cells of a row is mapped
+*	to the rows it appears in, so only the rows that contain every trigram of the text need
+*	to be checked. Text shorter than three characters has no trigrams, so it is looked for
+*	in every row.
+*
+*	Rows are compared through their search keys, see search::MakeSearchKey. The index is told
+*	about every change to the rows and only updates what the change affects, so it never
+*	has to be rebuilt.
+*
+*	While the user is typing, each search is narrowed down from the results of the one
+*	before it, so it costs about as much as the number of rows that are still found.
+*
+--*/
+{
+public:
+	// Rows are given as their search keys
+	void AppendRow(std::wstring&& searchKey);
+	void EraseRows(const std::vector<size_t>& rows);
+	void UpdateRow(size_t row, std::wstring&& searchKey);
+	void Clear(void);
+
+	void Find(const std::wstring& text, std::vector<int>& out);
+
+	const std::wstring& GetSearchKey(size_t row) const { return m_SearchKeys[row]; }
+
+	// Searches only use more than one thread when each one can be given at least this
+	// many rows to check, since starting a thread takes about as long as checking a few
+	// thousand rows
+	void SetMinRowsPerThread(size_t cRows) { m_cMinRowsPerThread = cRows; }
+
+private:
+	using Trigram = uint64_t;
+
+	// Unlike row indexes, the id of a row never changes while the row exists. Ids are
+	// handed out in increasing order and rows are only ever appended, so sorting rows
+	// by id sorts them in the order they are stored as well.
+	using RowId = uint32_t;
+
+	static void CollectTrigrams(const std::wstring& foldedText, std::vector<Trigram>& out);
+	static void CollectDistinctTrigrams(const std::wstring& foldedText, std::vector<Trigram>& out);
+
+	void FindIds(const std::wstring& foldedText, std::vector<RowId>& out);
+
+	void AddPostings(RowId id, const std::wstring& searchKey);
+	void RemovePostings(RowId id, const std::wstring& searchKey);
+	void UpdateRowsOfIds(void);
+
+private:
+	// The ids of the rows that contain each trigram, in increasing order
+	std::unordered_map<Trigram, std::vector<RowId>> m_Postings;
+
+	// m_IdsOfRows[row] is the id of the row, and m_RowsOfIds[id] is the row of the id.
+	// Erasing a row moves every row after it, so the latter is only brought up to date
+	// the next time it is needed, however many rows have been erased until then.
+	std::vector<RowId> m_IdsOfRows;
+	std::vector<uint32_t> m_RowsOfIds;
+	bool m_areRowsOfIdsStale = false;
+
+	RowId m_NextId = 0;
+
+	size_t m_cMinRowsPerThread = DEFAULT_MIN_SEARCH_ROWS_PER_THREAD;
+
+	// The search key of every row, made once when the row is added or changed
+	std::vector<std::wstring> m_SearchKeys;
+
+	struct RecentSearch
+	{
+		std::wstring foldedText;
+		std::vector<RowId> ids;
+	};
+
+	// Each search is for a text that contains the text of the one before it, and they're
+	// all forgotten as soon as the rows change, because their results would be outdated
+	std::vector<RecentSearch> m_RecentSearches;
+};
@@ -0,0 +1,578 @@
+﻿#include "SortKeys.h"
+#include "Utility.h"
+
+#include <algorithm>
+#include <stdexcept>
+#include <cstring>
+#include <iterator>
+
+// How many bytes of a collation key fit in the integer key
+#define COLLATION_PREFIX_BYTES sizeof(uint64_t)
+
+#define RADIX_BITS 8
+#define RADIX_BUCKETS (1 << RADIX_BITS)
+#define RADIX_PASSES (sizeof(uint64_t) * 8 / RADIX_BITS)
+
+// The key of a cell that isn't a valid number, date or time, which comes before every valid one
+#define MISSING_VALUE_KEY 0
+
+// Sign bit of the integer keys, see MakeNumericKey
+#define INTEGER_SIGN_BIT (1ull << 63)
+
+// Longer numbers could overflow, and no column holds numbers anywhere near as long
+#define MAX_INTEGER_DIGITS 18
+
+// How many orders RowSorter remembers. Each one takes 4 bytes for every row.
+#define MAX_REMEMBERED_ORDERS 4
+
+static bool ParseNumber(const wchar_t*& p, const wchar_t* end, int64_t& value, size_t cMaxDigits)
+/*++
+*
+* Routine Description:
+*
+*	Reads the digits at the start of a string as a non-negative number.
+*
+* Arguments:
+*
+*	p          - Start of the string, moved past the digits that were read.
+*	end        - End of the string.
+*	value      - Receives the number.
+*	cMaxDigits - How many digits the number may have at most.
+*
+* Return Value:
+*
+*	False if the string doesn't start with a digit or has too many of them.
+*
+--*/
+{
+	const wchar_t* const start = p;
+	value = 0;
+
+	while (p != end && *p >= L'0' && *p <= L'9')
+	{
+		if (static_cast<size_t>(p - start) == cMaxDigits)
+		{
+			return false;
+		}
+
+		value = value * 10 + (*p - L'0');
+		++p;
+	}
+
+	return p != start;
+}
+
+uint64_t SortKeys::MakeNumericKey(const std::wstring& cell, SortKeyType type)
+/*++
+*
+* Routine Description:
+*
+*	Converts a cell to an integer that compares the same way as the number, date or time
+*	in it. This is done for every cell of the column being sorted, so unlike the functions
+*	in util that read dates and times, it doesn't allocate anything.
+*
+* Arguments:
+*
+*	cell - The cell.
+*	type - What the cell holds. Must not be SortKeyType::TEXT.
+*
+* Return Value:
+*
+*	The key, or MISSING_VALUE_KEY if the cell doesn't hold a valid value of the type.
+*
+--*/
+{
+	const wchar_t* p = cell.c_str();
+	const wchar_t* const end = p + cell.length();
+
+	switch (type)
+	{
+	case SortKeyType::INTEGER:
+	{
+		const bool isNegative = (p != end && *p == L'-');
+		int64_t value;
+
+		if (isNegative)
+		{
+			++p;
+		}
+
+		if (!ParseNumber(p, end, value, MAX_INTEGER_DIGITS) || p != end)
+		{
+			return MISSING_VALUE_KEY;
+		}
+
+		// Flipping the sign bit puts negative numbers before positive ones when the keys are
+		// compared unsigned. The number can't be INT64_MIN, so no key is MISSING_VALUE_KEY.
+		return static_cast<uint64_t>(isNegative ? -value : value) ^ INTEGER_SIGN_BIT;
+	}
+
+	case SortKeyType::DATE:
+	{
+		int64_t day, month, year;
+
+		if (!ParseNumber(p, end, day, 2) || p == end || *p++ != L'/' ||
+			!ParseNumber(p, end, month, 2) || p == end || *p++ != L'/' ||
+			!ParseNumber(p, end, year, 4) || p != end)
+		{
+			return MISSING_VALUE_KEY;
+		}
+
+		util::Date date;
+		date.day = static_cast<int>(day);
+		date.month = static_cast<int>(month);
+		date.year = static_cast<int>(year);
+
+		// NO_DATE is 0, so invalid dates are missing values as well
+		return static_cast<uint64_t>(util::PackDate(date));
+	}
+
+	case SortKeyType::TIME:
+	{
+		int64_t hours, minutes;
+
+		if (!ParseNumber(p, end, hours, 2) || p == end || *p++ != L':' ||
+			!ParseNumber(p, end, minutes, 2) || p != end || hours > 23 || minutes > 59)
+		{
+			return MISSING_VALUE_KEY;
+		}
+
+		// Midnight is 0 minutes, so every valid time is moved up by one
+		return static_cast<uint64_t>(hours * 60 + minutes) + 1;
+	}
+	}
+
+	return MISSING_VALUE_KEY;
+}
+
+void SortKeys::AppendCollationKey(const std::wstring& cell)
+/*++
+*
+* Routine Description:
+*
+*	Appends the collation key of a cell to m_CollationKeys. Collation keys are bytes which,
+*	compared with memcmp, put text in the order of the user's language, so that e.g. 'ά'
+*	comes right after 'α' instead of after 'ω'.
+*
+* Arguments:
+*
+*	cell - The cell.
+*
+* Return Value:
+*
+*	None.
+*
+--*/
+{
+	const DWORD dwFlags = LCMAP_SORTKEY | LINGUISTIC_IGNORECASE;
+	const int cchCell = static_cast<int>(cell.length());
+
+	if (cchCell == 0)
+	{
+		return;
+	}
+
+	const int cbKey = LCMapStringEx(LOCALE_NAME_USER_DEFAULT, dwFlags, cell.c_str(), cchCell, NULL, 0, NULL, NULL, 0);
+
+	if (cbKey <= 0)
+	{
+		throw std::runtime_error("Failed to make the collation key of a cell");
+	}
+
+	const size_t offset = m_CollationKeys.size();
+	m_CollationKeys.resize(offset + cbKey);
+
+	// LCMAP_SORTKEY writes bytes, even though the output is declared as a wide string
+	LCMapStringEx(LOCALE_NAME_USER_DEFAULT, dwFlags, cell.c_str(), cchCell,
+		reinterpret_cast<LPWSTR>(m_CollationKeys.data() + offset), cbKey, NULL, NULL, 0);
+}
+
+void SortKeys::MakeKeys(RowProvider& provider, size_t column, SortKeyType type, const std::vector<int>& rows)
+{
+	m_Keys.resize(rows.size());
+	m_CollationKeys.clear();
+	m_CollationKeyOffsets.clear();
+
+	if (type == SortKeyType::TEXT)
+	{
+		m_CollationKeyOffsets.reserve(rows.size() + 1);
+	}
+
+	for (size_t i = 0; i < rows.size(); ++i)
+	{
+		const std::wstring& cell = provider.GetCell(rows[i], column);
+
+		m_Keys[i].position = static_cast<uint32_t>(i);
+
+		if (type != SortKeyType::TEXT)
+		{
+			m_Keys[i].value = MakeNumericKey(cell, type);
+			continue;
+		}
+
+		const size_t offset = m_CollationKeys.size();
+		m_CollationKeyOffsets.push_back(offset);
+		AppendCollationKey(cell);
+
+		// The first bytes of the collation key, the first one being the most significant.
+		// Shorter keys are padded with zeros, which is what they'd be compared to anyway.
+		uint64_t prefix = 0;
+
+		for (size_t j = 0; j < COLLATION_PREFIX_BYTES; ++j)
+		{
+			const size_t iByte = offset + j;
+			prefix = (prefix << 8) | (iByte < m_CollationKeys.size() ? m_CollationKeys[iByte] : 0);
+		}
+
+		m_Keys[i].value = prefix;
+	}
+
+	m_CollationKeyOffsets.push_back(m_CollationKeys.size());
+}
+
+void SortKeys::RadixSort(void)
+/*++
+*
+* Routine Description:
+*
+*	Sorts m_Keys by value, keeping keys with the same value in the order they were in.
+*
+*	Keys are sorted by each byte of their values in turn, from the least significant one
+*	to the most significant one. Bytes that are the same in every key, such as the upper
+*	ones of small numbers, dates and times, don't change the order, so they are skipped.
+*
+* Arguments:
+*
+*	None.
+*
+* Return Value:
+*
+*	None.
+*
+--*/
+{
+	size_t counts[RADIX_PASSES][RADIX_BUCKETS] = {};
+
+	// The counts of every pass are taken at once, since the values don't change between passes
+	for (const Key& key : m_Keys)
+	{
+		for (size_t pass = 0; pass < RADIX_PASSES; ++pass)
+		{
+			++counts[pass][(key.value >> (pass * RADIX_BITS)) & (RADIX_BUCKETS - 1)];
+		}
+	}
+
+	m_Buffer.resize(m_Keys.size());
+
+	for (size_t pass = 0; pass < RADIX_PASSES; ++pass)
+	{
+		const unsigned int shift = static_cast<unsigned int>(pass * RADIX_BITS);
+		size_t* const bucketCounts = counts[pass];
+
+		if (std::any_of(bucketCounts, bucketCounts + RADIX_BUCKETS, [&](size_t count) { return count == m_Keys.size(); }))
+		{
+			continue;
+		}
+
+		// Turn the counts into the position of the first key of each bucket
+		size_t position = 0;
+
+		for (size_t bucket = 0; bucket < RADIX_BUCKETS; ++bucket)
+		{
+			const size_t count = bucketCounts[bucket];
+			bucketCounts[bucket] = position;
+			position += count;
+		}
+
+		for (const Key& key : m_Keys)
+		{
+			m_Buffer[bucketCounts[(key.value >> shift) & (RADIX_BUCKETS - 1)]++] = key;
+		}
+
+		m_Keys.swap(m_Buffer);
+	}
+}
+
+void SortKeys::SortTiesByCollationKey(bool isDescending)
+/*++
+*
+* Routine Description:
+*
+*	Sorts the text keys whose values are the same by the rest of their collation keys.
+*	Only the first bytes of the collation keys are in the values, so texts that start
+*	the same way are still in the order they were in before sorting.
+*
+* Arguments:
+*
+*	isDescending - Whether the keys are sorted in descending order.
+*
+* Return Value:
+*
+*	None.
+*
+--*/
+{
+	const auto IsBefore = [&](const Key& a, const Key& b) {
+		const size_t aStart = m_CollationKeyOffsets[a.position] + COLLATION_PREFIX_BYTES;
+		const size_t bStart = m_CollationKeyOffsets[b.position] + COLLATION_PREFIX_BYTES;
+		const size_t aEnd = m_CollationKeyOffsets[a.position + 1];
+		const size_t bEnd = m_CollationKeyOffsets[b.position + 1];
+
+		// A key that fits in its value entirely has nothing left to compare
+		const size_t cbA = (aEnd > aStart) ? aEnd - aStart : 0;
+		const size_t cbB = (bEnd > bStart) ? bEnd - bStart : 0;
+
+		int result = memcmp(m_CollationKeys.data() + aStart, m_CollationKeys.data() + bStart, (std::min)(cbA, cbB));
+
+		if (result == 0)
+		{
+			result = (cbA < cbB) ? -1 : (cbA > cbB);
+		}
+
+		return isDescending ? result > 0 : result < 0;
+	};
+
+	for (size_t first = 0; first < m_Keys.size();)
+	{
+		size_t last = first + 1;
+
+		while (last < m_Keys.size() && m_Keys[last].value == m_Keys[first].value)
+		{
+			++last;
+		}
+
+		if (last - first > 1)
+		{
+			std::stable_sort(m_Keys.begin() + first, m_Keys.begin() + last, IsBefore);
+		}
+
+		first = last;
+	}
+}
+
+void SortKeys::Sort(RowProvider& provider, size_t column, SortKeyType type, bool isDescending, std::vector<int>& rows)
+/*++
+*
+* Routine Description:
+*
+*	Sorts rows by the cells of one of their columns. Rows whose cells are equal stay
+*	in the order they were in. Cells that aren't a valid value of the column's type,
+*	such as "-", come before every other cell, or after them when sorting in descending order.
+*
+* Arguments:
+*
+*	provider     - Where the rows are read from.
+*	column       - The column to sort by.
+*	type         - What the cells of the column are compared as.
+*	isDescending - Whether the rows are sorted in descending order.
+*	rows         - The indexes of the rows in the provider, which are sorted.
+*
+* Return Value:
+*
+*	None.
+*
+--*/
+{
+	MakeKeys(provider, column, type, rows);
+
+	if (isDescending)
+	{
+		// Sorting the complements in ascending order sorts the values in descending order
+		for (Key& key : m_Keys)
+		{
+			key.value = ~key.value;
+		}
+	}
+
+	RadixSort();
+
+	if (type == SortKeyType::TEXT)
+	{
+		SortTiesByCollationKey(isDescending);
+	}
+
+	std::vector<int> sortedRows(rows.size());
+
+	for (size_t i = 0; i < m_Keys.size(); ++i)
+	{
+		sortedRows[i] = rows[m_Keys[i].position];
+	}
+
+	rows.swap(sortedRows);
+}
+
+static bool IsOppositeOrder(const std::vector<SortColumn>& a, const std::vector<SortColumn>& b)
+{
+	if (a.size() != b.size())
+	{
+		return false;
+	}
+
+	for (size_t i = 0; i < a.size(); ++i)
+	{
+		if (a[i].column != b[i].column || a[i].type != b[i].type || a[i].isDescending == b[i].isDescending)
+		{
+			return false;
+		}
+	}
+
+	return true;
+}
+
+void RowSorter::Clear(void)
+{
+	m_SortedRows.clear();
+	m_pProvider = nullptr;
+	m_ProviderVersion = 0;
+}
+
+const RowSorter::SortedRows* RowSorter::FindSortedRows(const std::vector<SortColumn>& order, const std::vector<int>& rows, size_t cAllRows, bool& isReversed)
+/*++
+*
+* Routine Description:
+*
+*	Looks for rows that were sorted in the given order, or in the opposite one, and that
+*	are either all the rows there are or the exact same rows as the ones being sorted.
+*	m_isRowIncluded must have been filled in for the rows being sorted.
+*
+* Arguments:
+*
+*	order      - The order the rows are being sorted in.
+*	rows       - The rows being sorted.
+*	cAllRows   - How many rows there are.
+*	isReversed - Receives whether the rows that were found are in the opposite order.
+*
+* Return Value:
+*
+*	The rows that were found, or nullptr if none were.
+*
+--*/
+{
+	for (auto it = m_SortedRows.begin(); it != m_SortedRows.end(); ++it)
+	{
+		isReversed = IsOppositeOrder(it->order, order);
+
+		if (!isReversed && it->order != order)
+		{
+			continue;
+		}
+
+		bool isUsable = (it->rows.size() == cAllRows);
+
+		if (!isUsable && it->rows.size() == rows.size())
+		{
+			isUsable = std::all_of(it->rows.begin(), it->rows.end(), [&](int row) { return m_isRowIncluded[row]; });
+		}
+
+		if (isUsable)
+		{
+			m_SortedRows.splice(m_SortedRows.begin(), m_SortedRows, it);
+			return &m_SortedRows.front();
+		}
+	}
+
+	return nullptr;
+}
+
+void RowSorter::RememberSortedRows(const std::vector<SortColumn>& order, const std::vector<int>& rows)
+{
+	if (m_SortedRows.size() == MAX_REMEMBERED_ORDERS)
+	{
+		m_SortedRows.pop_back();
+	}
+
+	SortedRows sorted;
+	sorted.order = order;
+	sorted.rows = rows;
+
+	m_SortedRows.emplace_front(std::move(sorted));
+}
+
+void RowSorter::SortByKeys(RowProvider& provider, const std::vector<SortColumn>& order, std::vector<int>& rows)
+{
+	// Ties are broken by the order the rows are stored in, in the direction of the first column
+	std::sort(rows.begin(), rows.end());
+
+	if (order.front().isDescending)
+	{
+		std::reverse(rows.begin(), rows.end());
+	}
+
+	// Sorting by each column, starting from the last one, leaves rows that are equal in a
+	// column in the order the columns after it put them in, since every sort is stable
+	for (auto it = order.rbegin(); it != order.rend(); ++it)
+	{
+		m_Keys.Sort(provider, it->column, it->type, it->isDescending, rows);
+	}
+}
+
+void RowSorter::Sort(RowProvider& provider, const std::vector<SortColumn>& order, std::vector<int>& rows)
+/*++
+*
+* Routine Description:
+*
+*	Sorts rows by several columns, see the class description.
+*
+* Arguments:
+*
+*	provider - Where the rows are read from.
+*	order    - The columns to sort by, the most important one first.
+*	rows     - The indexes of the rows in the provider, which are sorted.
+*
+* Return Value:
+*
+*	None.
+*
+--*/
+{
+	if (order.empty())
+	{
+		return;
+	}
+
+	if (&provider != m_pProvider || provider.GetVersion() != m_ProviderVersion)
+	{
+		Clear();
+
+		m_pProvider = &provider;
+		m_ProviderVersion = provider.GetVersion();
+	}
+
+	const size_t cAllRows = provider.GetRowCount();
+
+	m_isRowIncluded.assign(cAllRows, false);
+
+	for (int row : rows)
+	{
+		m_isRowIncluded[row] = true;
+	}
+
+	bool isReversed = false;
+	const SortedRows* pSorted = FindSortedRows(order, rows, cAllRows, isReversed);
+
+	if (pSorted == nullptr)
+	{
+		SortByKeys(provider, order, rows);
+		RememberSortedRows(order, rows);
+		return;
+	}
+
+	std::vector<int> sortedRows;
+	sortedRows.reserve(rows.size());
+
+	const auto CopyIncludedRows = [&](auto first, auto last) {
+		std::copy_if(first, last, std::back_inserter(sortedRows), [&](int row) { return m_isRowIncluded[row]; });
+	};
+
+	if (isReversed)
+	{
+		CopyIncludedRows(pSorted->rows.rbegin(), pSorted->rows.rend());
+	}
+
+	else
+	{
+		CopyIncludedRows(pSorted->rows.begin(), pSorted->rows.end());
+	}
+
+	rows.swap(sortedRows);
+}
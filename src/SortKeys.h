@@ -0,0 +1,126 @@
+#pragma once
+
+#include "RowProvider.h"
+
+#include <vector>
+#include <list>
+#include <cstdint>
+
+// What the cells of a column are compared as when the column is sorted
+enum class SortKeyType
+{
+	TEXT,     // Text, in the order of the user's language, ignoring case
+	INTEGER,  // Whole numbers, e.g. ids
+	DATE,     // Dates of the form dd/mm/yyyy, see util::ConvertStringToDate
+	TIME      // Times of the form hh:mm, see util::ConvertStringToTime
+};
+
+class SortKeys
+/*++
+*
+* Class Description:
+*
+*	Sorts rows by the cells of one of their columns. Each cell is converted once into a
+*	key that compares the same way as the value it holds, so that sorting never has to
+*	look at the cells themselves.
+*
+*	Every key is a single integer. Numbers, dates and times fit in it as they are, and
+*	text keeps the first few bytes of its collation key in it, so ties between texts
+*	that start the same way are the only ones that need the rest of their collation keys.
+*	The integers are sorted with a radix sort, which takes the same few passes over the
+*	keys however many rows there are.
+*
+--*/
+{
+public:
+	void Sort(RowProvider& provider, size_t column, SortKeyType type, bool isDescending, std::vector<int>& rows);
+
+private:
+	struct Key
+	{
+		uint64_t value;
+
+		// Index of the row in the rows being sorted
+		uint32_t position;
+	};
+
+	void MakeKeys(RowProvider& provider, size_t column, SortKeyType type, const std::vector<int>& rows);
+	void AppendCollationKey(const std::wstring& cell);
+
+	void RadixSort(void);
+	void SortTiesByCollationKey(bool isDescending);
+
+	static uint64_t MakeNumericKey(const std::wstring& cell, SortKeyType type);
+
+private:
+	std::vector<Key> m_Keys;
+	std::vector<Key> m_Buffer;
+
+	// The collation keys of text cells, one after the other. The key of the cell at position
+	// i starts at m_CollationKeyOffsets[i] and ends where the one at position i + 1 starts.
+	std::vector<uint8_t> m_CollationKeys;
+	std::vector<size_t> m_CollationKeyOffsets;
+};
+
+struct SortColumn
+{
+	size_t column = 0;
+	SortKeyType type = SortKeyType::TEXT;
+	bool isDescending = false;
+
+	SortColumn(void) = default;
+	SortColumn(size_t column, SortKeyType type, bool isDescending)
+		: column(column), type(type), isDescending(isDescending) {}
+
+	bool operator==(const SortColumn& other) const
+	{
+		return column == other.column && type == other.type && isDescending == other.isDescending;
+	}
+};
+
+class RowSorter
+/*++
+*
+* Class Description:
+*
+*	Sorts rows by several columns at once: by the first one, then rows that are equal
+*	in it by the second one, and so on. Rows that are equal in every column are in the
+*	order they are stored in, or the opposite one if the first column is in descending
+*	order, so that sorting in the opposite direction always gives the exact reverse.
+*
+*	The last few orders that rows were sorted in are remembered until the rows change.
+*	Sorting the same rows in one of those orders again, or in the opposite one, only
+*	copies or reverses it, and so does sorting fewer rows, such as the ones a filter
+*	left, in an order that all the rows were sorted in.
+*
+--*/
+{
+public:
+	void Sort(RowProvider& provider, const std::vector<SortColumn>& order, std::vector<int>& rows);
+	void Clear(void);
+
+private:
+	struct SortedRows
+	{
+		std::vector<SortColumn> order;
+		std::vector<int> rows;
+	};
+
+	const SortedRows* FindSortedRows(const std::vector<SortColumn>& order, const std::vector<int>& rows, size_t cAllRows, bool& isReversed);
+	void RememberSortedRows(const std::vector<SortColumn>& order, const std::vector<int>& rows);
+
+	void SortByKeys(RowProvider& provider, const std::vector<SortColumn>& order, std::vector<int>& rows);
+
+private:
+	SortKeys m_Keys;
+
+	// The most recent ones first
+	std::list<SortedRows> m_SortedRows;
+
+	// The provider whose rows are remembered, and its version at the time
+	const RowProvider* m_pProvider = nullptr;
+	uint64_t m_ProviderVersion = 0;
+
+	// m_isRowIncluded[row] is whether the row is among the ones being sorted
+	std::vector<bool> m_isRowIncluded;
+};
@@ -0,0 +1,148 @@
+#include "StringPool.h"
+
+#include <cstring>
+#include <stdexcept>
+
+// The slots are grown once they're more than this full, in 1/8ths
+#define MAX_SLOT_LOAD 6
+
+#define INITIAL_SLOT_COUNT 1024
+
+StringPool::StringPool(void)
+	: m_Slots(INITIAL_SLOT_COUNT, 0)
+{
+}
+
+StringPool& StringPool::GetGlobal(void)
+{
+	static StringPool pool;
+	return pool;
+}
+
+uint64_t StringPool::Hash(const wchar_t* lpszText, size_t cchText)
+{
+	// FNV-1a
+	uint64_t hash = 14695981039346656037ull;
+
+	for (size_t i = 0; i < cchText; ++i)
+	{
+		hash ^= static_cast<uint64_t>(lpszText[i]);
+		hash *= 1099511628211ull;
+	}
+
+	return hash;
+}
+
+StringHandle StringPool::Intern(const wchar_t* lpszText, size_t cchText)
+/*++
+*
+* Routine Description:
+*
+*	Finds the handle of a string, adding the string to the pool if it isn't in it yet.
+*
+* Arguments:
+*
+*	lpszText - The string, which doesn't have to be null terminated.
+*	cchText  - The length of the string.
+*
+* Return Value:
+*
+*	The handle, which is the same for every string equal to this one. Throws if the
+*	pool is full.
+*
+--*/
+{
+	const uint64_t hash = Hash(lpszText, cchText);
+
+	std::lock_guard<std::mutex> lock(m_Mutex);
+
+	const size_t mask = m_Slots.size() - 1;
+	size_t iSlot = static_cast<size_t>(hash) & mask;
+
+	while (m_Slots[iSlot] != 0)
+	{
+		const StringHandle handle = m_Slots[iSlot] - 1;
+
+		if (m_Hashes[handle] == hash)
+		{
+			const std::wstring& str = Get(handle);
+
+			if (str.length() == cchText && std::wmemcmp(str.data(), lpszText, cchText) == 0)
+			{
+				return handle;
+			}
+		}
+
+		iSlot = (iSlot + 1) & mask;
+	}
+
+	if (m_cStrings == static_cast<size_t>(STRINGS_PER_CHUNK) * MAX_STRING_CHUNKS)
+	{
+		throw std::runtime_error("The string pool is full");
+	}
+
+	const StringHandle handle = static_cast<StringHandle>(m_cStrings);
+	std::unique_ptr<std::wstring[]>& pChunk = m_Chunks[handle / STRINGS_PER_CHUNK];
+
+	if (!pChunk)
+	{
+		pChunk.reset(new std::wstring[STRINGS_PER_CHUNK]);
+	}
+
+	std::wstring& str = pChunk[handle % STRINGS_PER_CHUNK];
+	str.assign(lpszText, cchText);
+
+	// Short strings are stored in the string object itself
+	if (str.capacity() > std::wstring().capacity())
+	{
+		m_cbHeap += (str.capacity() + 1) * sizeof(wchar_t);
+	}
+
+	m_Hashes.push_back(hash);
+	m_Slots[iSlot] = handle + 1;
+	++m_cStrings;
+
+	if (m_cStrings * 8 > m_Slots.size() * MAX_SLOT_LOAD)
+	{
+		Grow();
+	}
+
+	return handle;
+}
+
+void StringPool::Grow(void)
+{
+	std::vector<uint32_t> slots(m_Slots.size() * 2, 0);
+	const size_t mask = slots.size() - 1;
+
+	for (size_t handle = 0; handle < m_cStrings; ++handle)
+	{
+		size_t iSlot = static_cast<size_t>(m_Hashes[handle]) & mask;
+
+		while (slots[iSlot] != 0)
+		{
+			iSlot = (iSlot + 1) & mask;
+		}
+
+		slots[iSlot] = static_cast<uint32_t>(handle + 1);
+	}
+
+	m_Slots = std::move(slots);
+}
+
+size_t StringPool::GetStringCount(void) const
+{
+	std::lock_guard<std::mutex> lock(m_Mutex);
+
+	return m_cStrings;
+}
+
+size_t StringPool::GetByteCount(void) const
+{
+	std::lock_guard<std::mutex> lock(m_Mutex);
+
+	const size_t cChunks = (m_cStrings + STRINGS_PER_CHUNK - 1) / STRINGS_PER_CHUNK;
+
+	return cChunks * STRINGS_PER_CHUNK * sizeof(std::wstring) + m_cbHeap +
+		m_Slots.size() * sizeof(uint32_t) + m_Hashes.capacity() * sizeof(uint64_t);
+}
@@ -0,0 +1,73 @@
+#pragma once
+
+#include <vector>
+#include <string>
+#include <memory>
+#include <mutex>
+#include <cstdint>
+
+// Refers to a string of a StringPool
+using StringHandle = uint32_t;
+
+// The pool is made of chunks of strings that are never moved, so that strings can be
+// read while others are being added. It can hold up to 2^28 strings.
+#define STRINGS_PER_CHUNK 16384
+#define MAX_STRING_CHUNKS 16384
+
+class StringPool
+/*++
+*
+* Class Description:
+*
+*	Keeps a single copy of each distinct string it's given and refers to it with a
+*	4 byte handle, so that values many rows have in common, such as the states of
+*	tickets, are stored once rather than once per row.
+*
+*	The strings are found through a hash set of their handles, and are never changed
+*	or removed, so a reference to one stays valid for as long as the pool exists. That
+*	also means a string stays in the pool for good, so only values that keep coming up,
+*	rather than ones that are unique to a row such as ids and notes, should be interned.
+*
+*	Strings can be added from any thread. Reading one doesn't take a lock, since the
+*	handle it's read through can only have been passed on after the string was added.
+*
+--*/
+{
+public:
+	StringPool(void);
+
+	StringPool(const StringPool&) = delete;
+	StringPool& operator=(const StringPool&) = delete;
+
+	// The pool that every row shares
+	static StringPool& GetGlobal(void);
+
+	StringHandle Intern(const wchar_t* lpszText, size_t cchText);
+	inline StringHandle Intern(const std::wstring& text) { return Intern(text.data(), text.length()); }
+
+	inline const std::wstring& Get(StringHandle handle) const
+	{
+		return m_Chunks[handle / STRINGS_PER_CHUNK][handle % STRINGS_PER_CHUNK];
+	}
+
+	// How many strings there are, and how many bytes they take, for memory reports
+	size_t GetStringCount(void) const;
+	size_t GetByteCount(void) const;
+
+private:
+	static uint64_t Hash(const wchar_t* lpszText, size_t cchText);
+	void Grow(void);
+
+private:
+	std::unique_ptr<std::wstring[]> m_Chunks[MAX_STRING_CHUNKS];
+	size_t m_cStrings = 0;
+
+	// Each slot holds a handle plus one, or zero if it's empty. The hash of every string
+	// is kept, so that the slots can be grown without hashing the strings again.
+	std::vector<uint32_t> m_Slots;
+	std::vector<uint64_t> m_Hashes;
+
+	size_t m_cbHeap = 0;
+
+	mutable std::mutex m_Mutex;
+};
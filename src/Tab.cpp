@@ -244,4 +244,40 @@ LRESULT Tab::OnPaint(HWND hWnd)
 ID2D1SolidColorBrush* Tab::GetSolidColorBrush(void) const noexcept
 {
 	return m_pSolidColorBrush;
+}
+
+void Tab::ShowDatabaseError(const std::exception& e) const
+{
+	MessageBoxA(m_hWndSelf, e.what(), "SQLite Error", MB_OK | MB_ICONERROR);
+}
+
+std::function<void(std::future<void>)> Tab::ReportDatabaseErrors(void) const
+/*++
+*
+* Routine Description:
+*
+*	Makes a completion for db::Async that shows an error message if the work has failed,
+*	for work whose changes are already on screen and that has nothing else to report.
+*
+* Arguments:
+*
+*	None.
+*
+* Return Value:
+*
+*	The completion.
+*
+--*/
+{
+	return [this](std::future<void> result) {
+		try
+		{
+			result.get();
+		}
+
+		catch (std::exception& e)
+		{
+			ShowDatabaseError(e);
+		}
+	};
 }
\ No newline at end of file
@@ -5,6 +5,9 @@
 
 #include <string>
 #include <vector>
+#include <functional>
+#include <future>
+#include <stdexcept>
 #include <d2d1.h>
 
 #define BACKGROUND_COLOR RGB_D2D(248, 248, 252)
@@ -50,6 +53,10 @@ protected:
 
 	ID2D1SolidColorBrush* GetSolidColorBrush(void) const noexcept;
 
+	// For the completions of db::Async, which run after the user has moved on
+	void ShowDatabaseError(const std::exception& e) const;
+	std::function<void(std::future<void>)> ReportDatabaseErrors(void) const;
+
 protected:
 	ID2D1HwndRenderTarget* m_pRenderTarget = nullptr;
 	ID2D1GdiInteropRenderTarget* m_pGDIRT = nullptr;
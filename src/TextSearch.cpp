@@ -0,0 +1,313 @@
+﻿#include "TextSearch.h"
+
+#include <cstring>
+#include <cstdint>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define TEXT_SEARCH_SSE2
+#include <emmintrin.h>
+#endif
+
+#if defined(__AVX2__)
+#define TEXT_SEARCH_AVX2
+#include <immintrin.h>
+#endif
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+// Latin-1 letters from À (0xC0) to ÿ (0xFF), uppercase and without accents
+static const wchar_t g_latin1Folds[64] = {
+	L'A', L'A', L'A', L'A', L'A', L'A', 0xC6, L'C', L'E', L'E', L'E', L'E', L'I', L'I', L'I', L'I',
+	0xD0, L'N', L'O', L'O', L'O', L'O', L'O', 0xD7, 0xD8, L'U', L'U', L'U', L'U', L'Y', 0xDE, 0xDF,
+	L'A', L'A', L'A', L'A', L'A', L'A', 0xC6, L'C', L'E', L'E', L'E', L'E', L'I', L'I', L'I', L'I',
+	0xD0, L'N', L'O', L'O', L'O', L'O', L'O', 0xF7, 0xD8, L'U', L'U', L'U', L'U', L'Y', 0xDE, L'Y'
+};
+
+wchar_t search::FoldChar(wchar_t c)
+{
+	if (c < 0x80)
+	{
+		return (c >= L'a' && c <= L'z') ? c - 0x20 : c;
+	}
+
+	if (c < 0x100)
+	{
+		return (c >= 0xC0) ? g_latin1Folds[c - 0xC0] : c;
+	}
+
+	if (c >= 0x0386 && c <= 0x03CE)
+	{
+		switch (c)
+		{
+		// Letters with a tonos, uppercase and lowercase
+		case 0x0386: case 0x03AC: return 0x0391; // Ά ά
+		case 0x0388: case 0x03AD: return 0x0395; // Έ έ
+		case 0x0389: case 0x03AE: return 0x0397; // Ή ή
+		case 0x038A: case 0x03AF: return 0x0399; // Ί ί
+		case 0x038C: case 0x03CC: return 0x039F; // Ό ό
+		case 0x038E: case 0x03CD: return 0x03A5; // Ύ ύ
+		case 0x038F: case 0x03CE: return 0x03A9; // Ώ ώ
+
+		// Letters with a dialytika, with and without a tonos
+		case 0x03AA: case 0x03CA: case 0x0390: return 0x0399; // Ϊ ϊ ΐ
+		case 0x03AB: case 0x03CB: case 0x03B0: return 0x03A5; // Ϋ ϋ ΰ
+
+		// Final sigma has no uppercase letter of its own
+		case 0x03C2: return 0x03A3;
+		}
+
+		// α-ω
+		return (c >= 0x03B1 && c <= 0x03C9) ? c - 0x20 : c;
+	}
+
+	// а-я
+	if (c >= 0x0430 && c <= 0x044F)
+	{
+		return c - 0x20;
+	}
+
+	// ѐ-џ
+	if (c >= 0x0450 && c <= 0x045F)
+	{
+		return c - 0x50;
+	}
+
+	return c;
+}
+
+void search::MakeSearchKey(const std::vector<std::wstring>& cells, std::wstring& out)
+/*++
+*
+* Routine Description:
+*
+*	Makes the search key of a row, which is what search text is compared to instead
+*	of the cells themselves. It is every cell passed through FoldChar, one after the
+*	other, with a separator between them so that no text is found across two cells.
+*
+*	The key only has to be made again when the cells change, so that comparing
+*	text to the row never folds a single character of it.
+*
+* Arguments:
+*
+*	cells - The cells of the row.
+*	out   - Receives the search key.
+*
+* Return Value:
+*
+*	None.
+*
+--*/
+{
+	MakeSearchKeyOf(cells, [](const std::wstring& cell) -> const std::wstring& { return cell; }, out);
+}
+
+std::wstring search::MakeSearchText(const std::wstring& text)
+{
+	std::wstring folded;
+	folded.reserve(text.length());
+
+	for (wchar_t c : text)
+	{
+		// Pasted text could contain anything, but it mustn't match across cells
+		if (c != SEARCH_KEY_CELL_SEPARATOR)
+		{
+			folded.push_back(FoldChar(c));
+		}
+	}
+
+	return folded;
+}
+
+static inline unsigned int CountTrailingZeros(uint32_t mask)
+{
+#ifdef _MSC_VER
+	unsigned long index;
+	_BitScanForward(&index, mask);
+	return index;
+#else
+	return __builtin_ctz(mask);
+#endif
+}
+
+#ifdef TEXT_SEARCH_SSE2
+
+template<size_t CharSize>
+struct Sse2Lanes;
+
+template<>
+struct Sse2Lanes<2>
+{
+	using Vector = __m128i;
+
+	static Vector Broadcast(uint32_t c) { return _mm_set1_epi16(static_cast<short>(c)); }
+	static Vector Equal(Vector a, Vector b) { return _mm_cmpeq_epi16(a, b); }
+	static Vector Load(const void* p) { return _mm_loadu_si128(static_cast<const __m128i*>(p)); }
+	static Vector And(Vector a, Vector b) { return _mm_and_si128(a, b); }
+	static uint32_t ByteMask(Vector v) { return static_cast<uint32_t>(_mm_movemask_epi8(v)); }
+};
+
+template<>
+struct Sse2Lanes<4>
+{
+	using Vector = __m128i;
+
+	static Vector Broadcast(uint32_t c) { return _mm_set1_epi32(static_cast<int>(c)); }
+	static Vector Equal(Vector a, Vector b) { return _mm_cmpeq_epi32(a, b); }
+	static Vector Load(const void* p) { return _mm_loadu_si128(static_cast<const __m128i*>(p)); }
+	static Vector And(Vector a, Vector b) { return _mm_and_si128(a, b); }
+	static uint32_t ByteMask(Vector v) { return static_cast<uint32_t>(_mm_movemask_epi8(v)); }
+};
+
+#endif
+
+#ifdef TEXT_SEARCH_AVX2
+
+template<size_t CharSize>
+struct Avx2Lanes;
+
+template<>
+struct Avx2Lanes<2>
+{
+	using Vector = __m256i;
+
+	static Vector Broadcast(uint32_t c) { return _mm256_set1_epi16(static_cast<short>(c)); }
+	static Vector Equal(Vector a, Vector b) { return _mm256_cmpeq_epi16(a, b); }
+	static Vector Load(const void* p) { return _mm256_loadu_si256(static_cast<const __m256i*>(p)); }
+	static Vector And(Vector a, Vector b) { return _mm256_and_si256(a, b); }
+	static uint32_t ByteMask(Vector v) { return static_cast<uint32_t>(_mm256_movemask_epi8(v)); }
+};
+
+template<>
+struct Avx2Lanes<4>
+{
+	using Vector = __m256i;
+
+	static Vector Broadcast(uint32_t c) { return _mm256_set1_epi32(static_cast<int>(c)); }
+	static Vector Equal(Vector a, Vector b) { return _mm256_cmpeq_epi32(a, b); }
+	static Vector Load(const void* p) { return _mm256_loadu_si256(static_cast<const __m256i*>(p)); }
+	static Vector And(Vector a, Vector b) { return _mm256_and_si256(a, b); }
+	static uint32_t ByteMask(Vector v) { return static_cast<uint32_t>(_mm256_movemask_epi8(v)); }
+};
+
+#endif
+
+template<typename Char>
+static bool ContainsScalar(const Char* lpszText, size_t cchText, const Char* lpszPattern, size_t cchPattern, size_t first)
+{
+	for (size_t i = first; i + cchPattern <= cchText; ++i)
+	{
+		if (lpszText[i] == lpszPattern[0] && memcmp(lpszText + i + 1, lpszPattern + 1, (cchPattern - 1) * sizeof(Char)) == 0)
+		{
+			return true;
+		}
+	}
+
+	return false;
+}
+
+template<typename Lanes, typename Char>
+static bool ContainsVectorized(const Char* lpszText, size_t cchText, const Char* lpszPattern, size_t cchPattern)
+/*++
+*
+* Routine Description:
+*
+*	Compares the first and the last character of the pattern against as many positions
+*	of the text as fit in a vector at once. Only the positions where both of them match
+*	are compared in full, which in practice is hardly ever more than the actual matches.
+*
+* Arguments:
+*
+*	lpszText    - The text, which doesn't have to be null terminated.
+*	cchText     - Length of the text.
+*	lpszPattern - The pattern, which must not be longer than the text.
+*	cchPattern  - Length of the pattern, at least 1.
+*
+* Return Value:
+*
+*	Whether the pattern was found in the text.
+*
+--*/
+{
+	using Vector = typename Lanes::Vector;
+
+	const size_t cCharsPerVector = sizeof(Vector) / sizeof(Char);
+	const uint32_t charMask = (1u << sizeof(Char)) - 1;
+
+	const Vector first = Lanes::Broadcast(static_cast<uint32_t>(lpszPattern[0]));
+	const Vector last  = Lanes::Broadcast(static_cast<uint32_t>(lpszPattern[cchPattern - 1]));
+
+	size_t i = 0;
+
+	// The positions i to i + cCharsPerVector - 1 are checked at once, for which the
+	// characters up to i + cCharsPerVector - 1 + cchPattern - 1 are needed
+	for (; i + cCharsPerVector + cchPattern - 1 <= cchText; i += cCharsPerVector)
+	{
+		const Vector blockFirst = Lanes::Load(lpszText + i);
+		const Vector blockLast  = Lanes::Load(lpszText + i + cchPattern - 1);
+
+		// Each character takes sizeof(Char) consecutive bits of the mask
+		uint32_t mask = Lanes::ByteMask(Lanes::And(Lanes::Equal(blockFirst, first), Lanes::Equal(blockLast, last)));
+
+		while (mask)
+		{
+			const unsigned int bit = CountTrailingZeros(mask);
+			const size_t position = i + bit / sizeof(Char);
+
+			if (cchPattern <= 2 || memcmp(lpszText + position + 1, lpszPattern + 1, (cchPattern - 2) * sizeof(Char)) == 0)
+			{
+				return true;
+			}
+
+			mask &= ~(charMask << bit);
+		}
+	}
+
+	return ContainsScalar(lpszText, cchText, lpszPattern, cchPattern, i);
+}
+
+bool search::Contains(const wchar_t* lpszText, size_t cchText, const wchar_t* lpszPattern, size_t cchPattern)
+/*++
+*
+* Routine Description:
+*
+*	Checks whether a text contains a pattern. Both must have been passed through FoldChar,
+*	so that they can be compared one code unit at a time, without caring about case.
+*
+* Arguments:
+*
+*	lpszText    - The text, which doesn't have to be null terminated.
+*	cchText     - Length of the text.
+*	lpszPattern - The pattern, which doesn't have to be null terminated.
+*	cchPattern  - Length of the pattern.
+*
+* Return Value:
+*
+*	Whether the pattern was found in the text. An empty pattern is found in any text.
+*
+--*/
+{
+	if (cchPattern == 0)
+	{
+		return true;
+	}
+
+	if (cchPattern > cchText)
+	{
+		return false;
+	}
+
+#if defined(TEXT_SEARCH_AVX2)
+	return ContainsVectorized<Avx2Lanes<sizeof(wchar_t)>>(lpszText, cchText, lpszPattern, cchPattern);
+#elif defined(TEXT_SEARCH_SSE2)
+	return ContainsVectorized<Sse2Lanes<sizeof(wchar_t)>>(lpszText, cchText, lpszPattern, cchPattern);
+#else
+	return ContainsScalar(lpszText, cchText, lpszPattern, cchPattern, 0);
+#endif
+}
+
+bool search::Contains(const std::wstring& searchKey, const std::wstring& searchText)
+{
+	return Contains(searchKey.c_str(), searchKey.length(), searchText.c_str(), searchText.length());
+}
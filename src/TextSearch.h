@@ -0,0 +1,48 @@
+﻿#pragma once
+
+#include <string>
+#include <vector>
+
+// Separates the cells in a search key. It can't be typed, so no search text can contain it.
+#define SEARCH_KEY_CELL_SEPARATOR L'\x1F'
+
+namespace search
+{
+	// Converts a character to the form it is compared in: letters are made uppercase,
+	// the tonos and the dialytika are dropped and final sigma becomes 'Σ', so that
+	// e.g. 'ϊ', 'ί', 'ι', 'Ϊ' and 'Ι' are all 'Ι'
+	wchar_t FoldChar(wchar_t c);
+
+	void MakeSearchKey(const std::vector<std::wstring>& cells, std::wstring& out);
+	std::wstring MakeSearchText(const std::wstring& text);
+
+	// Makes the search key of cells that are kept as something other than strings,
+	// with getText giving the text of each cell
+	template<typename Cells, typename GetText>
+	void MakeSearchKeyOf(const Cells& cells, GetText getText, std::wstring& out)
+	{
+		size_t cchKey = cells.size();
+
+		for (const auto& cell : cells)
+		{
+			cchKey += getText(cell).length();
+		}
+
+		out.clear();
+		out.reserve(cchKey);
+
+		for (const auto& cell : cells)
+		{
+			for (wchar_t c : getText(cell))
+			{
+				out.push_back(FoldChar(c));
+			}
+
+			out.push_back(SEARCH_KEY_CELL_SEPARATOR);
+		}
+	}
+
+	// Finds search text, as made by MakeSearchText, in a search key
+	bool Contains(const wchar_t* lpszText, size_t cchText, const wchar_t* lpszPattern, size_t cchPattern);
+	bool Contains(const std::wstring& searchKey, const std::wstring& searchText);
+}
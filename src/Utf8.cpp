@@ -0,0 +1,359 @@
+#include "Utf8.h"
+
+#include <cstdint>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define UTF8_SSE2
+#include <emmintrin.h>
+#endif
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+#define REPLACEMENT_CHARACTER 0xFFFD
+
+static inline bool IsContinuationByte(uint8_t b)
+{
+	return (b & 0xC0) == 0x80;
+}
+
+static size_t DecodeCharacter(const uint8_t* p, const uint8_t* pEnd, uint32_t& codePoint)
+/*++
+*
+* Routine Description:
+*
+*	Decodes the character a UTF-8 sequence starts with.
+*
+* Arguments:
+*
+*	p         - The first byte of the sequence.
+*	pEnd      - The end of the text.
+*	codePoint - Receives the character, or U+FFFD if the sequence is invalid.
+*
+* Return Value:
+*
+*	The length of the sequence, which is 1 if it is invalid, so that the bytes after
+*	the first one are decoded on their own.
+*
+--*/
+{
+	const uint8_t lead = p[0];
+	const size_t cbLeft = static_cast<size_t>(pEnd - p);
+
+	codePoint = REPLACEMENT_CHARACTER;
+
+	if (lead < 0x80)
+	{
+		codePoint = lead;
+		return 1;
+	}
+
+	// Overlong forms of ASCII start with 0xC0 or 0xC1
+	if (lead >= 0xC2 && lead <= 0xDF)
+	{
+		if (cbLeft >= 2 && IsContinuationByte(p[1]))
+		{
+			codePoint = ((lead & 0x1Fu) << 6) | (p[1] & 0x3Fu);
+			return 2;
+		}
+
+		return 1;
+	}
+
+	if (lead >= 0xE0 && lead <= 0xEF)
+	{
+		if (cbLeft >= 3 && IsContinuationByte(p[1]) && IsContinuationByte(p[2]))
+		{
+			const uint32_t c = ((lead & 0x0Fu) << 12) | ((p[1] & 0x3Fu) << 6) | (p[2] & 0x3Fu);
+
+			// Neither overlong forms nor surrogates are characters
+			if (c >= 0x800 && (c < 0xD800 || c > 0xDFFF))
+			{
+				codePoint = c;
+				return 3;
+			}
+		}
+
+		return 1;
+	}
+
+	if (lead >= 0xF0 && lead <= 0xF4)
+	{
+		if (cbLeft >= 4 && IsContinuationByte(p[1]) && IsContinuationByte(p[2]) && IsContinuationByte(p[3]))
+		{
+			const uint32_t c = ((lead & 0x07u) << 18) | ((p[1] & 0x3Fu) << 12) | ((p[2] & 0x3Fu) << 6) | (p[3] & 0x3Fu);
+
+			if (c >= 0x10000 && c <= 0x10FFFF)
+			{
+				codePoint = c;
+				return 4;
+			}
+		}
+	}
+
+	return 1;
+}
+
+#ifdef UTF8_SSE2
+
+static inline unsigned int CountTrailingZeros(uint32_t mask)
+{
+#ifdef _MSC_VER
+	unsigned long index;
+	_BitScanForward(&index, mask);
+	return index;
+#else
+	return __builtin_ctz(mask);
+#endif
+}
+
+// How many of the lanes a 16 bit movemask is set for are set before the first one that
+// isn't, in bytes
+static inline unsigned int CountLeadingSetBytes(int mask)
+{
+	return CountTrailingZeros(~static_cast<uint32_t>(mask) | 0x10000u);
+}
+
+#endif
+
+size_t utf8::ToUtf16(const char* lpszText, size_t cbText, char16_t* out, size_t cchOut)
+/*++
+*
+* Routine Description:
+*
+*	Converts UTF-8 to UTF-16.
+*
+*	16 bytes are looked at at once. If they start with ASCII, it is widened all at once,
+*	and if they start with 2 byte sequences such as those of Greek letters, every lead and
+*	continuation byte that make a 16 bit lane are turned into a code unit at once as well.
+*	Only text that starts with neither is decoded a character at a time, until it does.
+*
+* Arguments:
+*
+*	lpszText - The UTF-8 text.
+*	cbText   - Its length in bytes.
+*	out      - Receives the UTF-16 text.
+*	cchOut   - The length of out, in code units.
+*
+* Return Value:
+*
+*	The number of code units written.
+*
+--*/
+{
+	const uint8_t* p = reinterpret_cast<const uint8_t*>(lpszText);
+	const uint8_t* const pEnd = p + cbText;
+
+	char16_t* pOut = out;
+	char16_t* const pOutEnd = out + cchOut;
+
+	while (p < pEnd)
+	{
+#ifdef UTF8_SSE2
+		// The whole block is stored, however little of it is used, so it must fit
+		if (pEnd - p >= 16 && pOutEnd - pOut >= 16)
+		{
+			const __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+			const int nonAscii = _mm_movemask_epi8(bytes);
+			const unsigned int cAscii = (nonAscii == 0) ? 16 : CountTrailingZeros(static_cast<uint32_t>(nonAscii));
+
+			if (cAscii != 0)
+			{
+				const __m128i zero = _mm_setzero_si128();
+				_mm_storeu_si128(reinterpret_cast<__m128i*>(pOut), _mm_unpacklo_epi8(bytes, zero));
+				_mm_storeu_si128(reinterpret_cast<__m128i*>(pOut + 8), _mm_unpackhi_epi8(bytes, zero));
+				p += cAscii;
+				pOut += cAscii;
+				continue;
+			}
+
+			// A lane is a 2 byte sequence if its low byte is 110xxxxx and its high one is 10xxxxxx,
+			// and it isn't an overlong form of ASCII
+			const __m128i units = _mm_or_si128(
+				_mm_slli_epi16(_mm_and_si128(bytes, _mm_set1_epi16(0x1F)), 6),
+				_mm_and_si128(_mm_srli_epi16(bytes, 8), _mm_set1_epi16(0x3F)));
+
+			const __m128i isSequence = _mm_andnot_si128(
+				_mm_cmplt_epi16(units, _mm_set1_epi16(0x80)),
+				_mm_cmpeq_epi16(
+					_mm_and_si128(bytes, _mm_set1_epi16(static_cast<short>(0xC0E0))),
+					_mm_set1_epi16(static_cast<short>(0x80C0))));
+
+			const unsigned int cbSequences = CountLeadingSetBytes(_mm_movemask_epi8(isSequence));
+
+			if (cbSequences != 0)
+			{
+				_mm_storeu_si128(reinterpret_cast<__m128i*>(pOut), units);
+				p += cbSequences;
+				pOut += cbSequences / 2;
+				continue;
+			}
+		}
+#endif
+
+		uint32_t codePoint;
+		const size_t cbSequence = DecodeCharacter(p, pEnd, codePoint);
+
+		if (codePoint >= 0x10000)
+		{
+			if (pOutEnd - pOut < 2)
+			{
+				break;
+			}
+
+			codePoint -= 0x10000;
+			*pOut++ = static_cast<char16_t>(0xD800 + (codePoint >> 10));
+			*pOut++ = static_cast<char16_t>(0xDC00 + (codePoint & 0x3FF));
+		}
+
+		else
+		{
+			if (pOut == pOutEnd)
+			{
+				break;
+			}
+
+			*pOut++ = static_cast<char16_t>(codePoint);
+		}
+
+		p += cbSequence;
+	}
+
+	return static_cast<size_t>(pOut - out);
+}
+
+size_t utf8::FromUtf16(const char16_t* lpszText, size_t cchText, char* out, size_t cbOut)
+/*++
+*
+* Routine Description:
+*
+*	Converts UTF-16 to UTF-8, 8 code units at a time for as long as they start with
+*	ASCII or with characters that take 2 bytes, the same way ToUtf16 does.
+*
+* Arguments:
+*
+*	lpszText - The UTF-16 text.
+*	cchText  - Its length in code units.
+*	out      - Receives the UTF-8 text.
+*	cbOut    - The length of out, in bytes.
+*
+* Return Value:
+*
+*	The number of bytes written.
+*
+--*/
+{
+	const char16_t* p = lpszText;
+	const char16_t* const pEnd = p + cchText;
+
+	uint8_t* pOut = reinterpret_cast<uint8_t*>(out);
+	uint8_t* const pOutEnd = pOut + cbOut;
+
+	while (p < pEnd)
+	{
+#ifdef UTF8_SSE2
+		if (pEnd - p >= 8 && pOutEnd - pOut >= 16)
+		{
+			const __m128i units = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+			const __m128i zero = _mm_setzero_si128();
+			const __m128i nonAsciiBits = _mm_set1_epi16(static_cast<short>(0xFF80));
+
+			// Long runs of ASCII are narrowed 16 code units at a time
+			if (pEnd - p >= 16)
+			{
+				const __m128i nextUnits = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + 8));
+
+				if (_mm_movemask_epi8(_mm_cmpeq_epi16(_mm_and_si128(_mm_or_si128(units, nextUnits), nonAsciiBits), zero)) == 0xFFFF)
+				{
+					_mm_storeu_si128(reinterpret_cast<__m128i*>(pOut), _mm_packus_epi16(units, nextUnits));
+					p += 16;
+					pOut += 16;
+					continue;
+				}
+			}
+
+			const __m128i isAscii = _mm_cmpeq_epi16(_mm_and_si128(units, nonAsciiBits), zero);
+			const unsigned int cAscii = CountLeadingSetBytes(_mm_movemask_epi8(isAscii)) / 2;
+
+			if (cAscii != 0)
+			{
+				_mm_storel_epi64(reinterpret_cast<__m128i*>(pOut), _mm_packus_epi16(units, units));
+				p += cAscii;
+				pOut += cAscii;
+				continue;
+			}
+
+			const __m128i isTwoBytes = _mm_andnot_si128(isAscii,
+				_mm_cmpeq_epi16(_mm_and_si128(units, _mm_set1_epi16(static_cast<short>(0xF800))), zero));
+			const unsigned int cbTwoBytes = CountLeadingSetBytes(_mm_movemask_epi8(isTwoBytes));
+
+			if (cbTwoBytes != 0)
+			{
+				// The lead byte goes in the low half of each lane, so that it's written first
+				const __m128i lead = _mm_or_si128(_mm_srli_epi16(units, 6), _mm_set1_epi16(0xC0));
+				const __m128i continuation = _mm_or_si128(_mm_and_si128(units, _mm_set1_epi16(0x3F)), _mm_set1_epi16(0x80));
+
+				_mm_storeu_si128(reinterpret_cast<__m128i*>(pOut), _mm_or_si128(lead, _mm_slli_epi16(continuation, 8)));
+				p += cbTwoBytes / 2;
+				pOut += cbTwoBytes;
+				continue;
+			}
+		}
+#endif
+
+		uint32_t codePoint = *p;
+		size_t cchCharacter = 1;
+
+		if (codePoint >= 0xD800 && codePoint <= 0xDFFF)
+		{
+			if (codePoint <= 0xDBFF && pEnd - p >= 2 && p[1] >= 0xDC00 && p[1] <= 0xDFFF)
+			{
+				codePoint = 0x10000 + ((codePoint - 0xD800) << 10) + (p[1] - 0xDC00);
+				cchCharacter = 2;
+			}
+
+			else
+			{
+				codePoint = REPLACEMENT_CHARACTER;
+			}
+		}
+
+		const size_t cbCharacter = (codePoint < 0x80) ? 1 : (codePoint < 0x800) ? 2 : (codePoint < 0x10000) ? 3 : 4;
+
+		if (static_cast<size_t>(pOutEnd - pOut) < cbCharacter)
+		{
+			break;
+		}
+
+		switch (cbCharacter)
+		{
+		case 1:
+			pOut[0] = static_cast<uint8_t>(codePoint);
+			break;
+
+		case 2:
+			pOut[0] = static_cast<uint8_t>(0xC0 | (codePoint >> 6));
+			pOut[1] = static_cast<uint8_t>(0x80 | (codePoint & 0x3F));
+			break;
+
+		case 3:
+			pOut[0] = static_cast<uint8_t>(0xE0 | (codePoint >> 12));
+			pOut[1] = static_cast<uint8_t>(0x80 | ((codePoint >> 6) & 0x3F));
+			pOut[2] = static_cast<uint8_t>(0x80 | (codePoint & 0x3F));
+			break;
+
+		default:
+			pOut[0] = static_cast<uint8_t>(0xF0 | (codePoint >> 18));
+			pOut[1] = static_cast<uint8_t>(0x80 | ((codePoint >> 12) & 0x3F));
+			pOut[2] = static_cast<uint8_t>(0x80 | ((codePoint >> 6) & 0x3F));
+			pOut[3] = static_cast<uint8_t>(0x80 | (codePoint & 0x3F));
+			break;
+		}
+
+		p += cchCharacter;
+		pOut += cbCharacter;
+	}
+
+	return static_cast<size_t>(pOut - reinterpret_cast<uint8_t*>(out));
+}
@@ -0,0 +1,22 @@
+#pragma once
+
+#include <cstddef>
+
+namespace utf8
+{
+	// The most UTF-16 code units cbText bytes of UTF-8 can decode to, which is also
+	// how many a destination needs for every character of the text to fit
+	inline size_t GetMaxUtf16Length(size_t cbText) { return cbText; }
+
+	// The most bytes of UTF-8 cchText code units of UTF-16 can encode to
+	inline size_t GetMaxUtf8Length(size_t cchText) { return cchText * 3; }
+
+	// Converts UTF-8 to UTF-16, writing as many whole characters as fit in the destination,
+	// and returns how many code units were written. Each byte of an invalid sequence
+	// becomes U+FFFD. Neither text is null terminated.
+	size_t ToUtf16(const char* lpszText, size_t cbText, char16_t* out, size_t cchOut);
+
+	// Converts UTF-16 to UTF-8, writing as many whole characters as fit in the destination,
+	// and returns how many bytes were written. Unpaired surrogates become U+FFFD.
+	size_t FromUtf16(const char16_t* lpszText, size_t cchText, char* out, size_t cbOut);
+}
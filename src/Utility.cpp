@@ -1,4 +1,5 @@
 ﻿#include "Utility.h"
+#include "Utf8.h"
 
 #include <cctype>
 #include <CommCtrl.h>
@@ -14,6 +15,12 @@ static const std::wstring g_personRoles[] = {
 	L"Κατασκηνωτής/ρια"
 };
 
+static const std::wstring g_ticketStates[] = {
+	L"Αναμονή",
+	L"Ενεργή",
+	L"Ανενεργή"
+};
+
 void util::RegisterObject(HWND hWnd, void* object)
 /*++
 * 
@@ -265,6 +272,119 @@ util::Date util::ConvertStringToDate(const std::wstring& str)
 	return date;
 }
 
+int util::PackDate(const util::Date& date)
+/*++
+* 
+* Routine Description:
+* 
+*	Packs a date into a single integer of the form yyyymmdd. Packed dates
+*	compare in the same order as the dates they represent.
+* 
+*	If the date isn't valid, NO_DATE is returned.
+* 
+* Arguments:
+* 
+*	date - Structure containing the date information.
+* 
+--*/
+{
+	if (!util::IsValidDate(date))
+	{
+		return NO_DATE;
+	}
+
+	return date.year * 10000 + date.month * 100 + date.day;
+}
+
+util::Date util::UnpackDate(int packed)
+{
+	util::Date date;
+
+	if (packed != NO_DATE)
+	{
+		date.year = packed / 10000;
+		date.month = (packed / 100) % 100;
+		date.day = packed % 100;
+	}
+
+	return date;
+}
+
+int util::ConvertStringToTime(const std::wstring& str)
+/*++
+* 
+* Routine Description:
+* 
+*	Converts a time of the form xx:yy or x:yy to the number of minutes since midnight.
+* 
+*	If the string isn't a valid time, NO_TIME is returned.
+* 
+* Arguments:
+* 
+*	str - String in question.
+* 
+--*/
+{
+	if (!util::IsMilitaryTime(str))
+	{
+		return NO_TIME;
+	}
+
+	const size_t split = str.find_first_of(':');
+
+	return std::stoi(str.substr(0, split)) * 60 + std::stoi(str.substr(split + 1));
+}
+
+std::wstring util::FormatPackedDate(int packed)
+/*++
+* 
+* Routine Description:
+* 
+*	Returns the string form (dd/mm/yyyy) of a date packed with PackDate, or "-" if there is no date.
+* 
+* Arguments:
+* 
+*	packed - The packed date.
+* 
+--*/
+{
+	if (packed == NO_DATE)
+	{
+		return L"-";
+	}
+
+	const util::Date date = util::UnpackDate(packed);
+
+	wchar_t buffer[32];
+	swprintf_s(buffer, 32, L"%02d/%02d/%04d", date.day, date.month, date.year);
+
+	return std::wstring(buffer);
+}
+
+std::wstring util::FormatTime(int minutes)
+/*++
+* 
+* Routine Description:
+* 
+*	Returns the string form (hh:mm) of a time returned by ConvertStringToTime, or "-" if there is no time.
+* 
+* Arguments:
+* 
+*	minutes - Minutes since midnight.
+* 
+--*/
+{
+	if (minutes == NO_TIME)
+	{
+		return L"-";
+	}
+
+	wchar_t buffer[32];
+	swprintf_s(buffer, 32, L"%02d:%02d", minutes / 60, minutes % 60);
+
+	return std::wstring(buffer);
+}
+
 std::wstring util::GetLocalDate(void)
 /*++
 * 
@@ -357,7 +477,7 @@ std::wstring util::EnumToString(PersonRole role)
 * 
 * Routine Description:
 * 
-*	Returns the string representation of an enum value.
+*	Returns the string representation of an enum value, or "-" if it isn't a role.
 * 
 * Arguments:
 * 
@@ -365,7 +485,14 @@ std::wstring util::EnumToString(PersonRole role)
 * 
 --*/
 {
-	return g_personRoles[static_cast<int>(role)];
+	const int index = static_cast<int>(role);
+
+	if (index < 0 || static_cast<size_t>(index) >= ARRAY_SIZE(g_personRoles))
+	{
+		return L"-";
+	}
+
+	return g_personRoles[index];
 }
 
 util::PersonRole util::StringToEnum(std::wstring role)
@@ -395,30 +522,80 @@ util::PersonRole util::StringToEnum(std::wstring role)
 	return util::PersonRole::INVALID;
 }
 
-void util::EncodeWideTextToMultibyte(const wchar_t* lpszText, char* out, size_t out_len)
+std::wstring util::EnumToString(TicketState state)
+/*++
+* 
+* Routine Description:
+* 
+*	Returns the string representation of a ticket state, as it is stored in the database.
+*	TicketState::INVALID, or any other value that isn't a state, is returned as "-".
+* 
+* Arguments:
+* 
+*	state - Enum value of the state.
+* 
+--*/
 {
-	WideCharToMultiByte(
-		CP_UTF8,
-		0,
-		lpszText,
-		-1,
-		out,
-		out_len,
-		NULL,
-		FALSE
-	);
+	const int index = static_cast<int>(state);
+
+	if (index < 0 || static_cast<size_t>(index) >= ARRAY_SIZE(g_ticketStates))
+	{
+		return L"-";
+	}
+
+	return g_ticketStates[index];
 }
 
-void util::DecodeMultibyteToWideText(const char* lpszText, wchar_t* out, size_t out_len)
+util::TicketState util::StringToTicketState(const std::wstring& state)
+/*++
+* 
+* Routine Description:
+* 
+*	Matches a given string to a ticket state.
+*	If the state doesn't exist, TicketState::INVALID is returned.
+* 
+* Arguments:
+* 
+*	state - The state of the ticket, in text.
+* 
+--*/
 {
-	MultiByteToWideChar(
-		CP_UTF8,
-		MB_PRECOMPOSED,
-		lpszText,
-		-1,
-		out,
-		out_len
-	);
+	for (int i = 0; i < ARRAY_SIZE(g_ticketStates); ++i)
+	{
+		if (state == g_ticketStates[i])
+		{
+			return static_cast<util::TicketState>(i);
+		}
+	}
+
+	return util::TicketState::INVALID;
+}
+
+// wchar_t is UTF-16 on Windows, so wide strings are converted in place
+static_assert(sizeof(wchar_t) == sizeof(char16_t), "wchar_t must be a UTF-16 code unit");
+
+std::string util::EncodeUtf8(const wchar_t* lpszText, size_t cchText)
+{
+	std::string text(utf8::GetMaxUtf8Length(cchText), '\0');
+	text.resize(utf8::FromUtf16(reinterpret_cast<const char16_t*>(lpszText), cchText, &text[0], text.size()));
+
+	return text;
+}
+
+std::wstring util::DecodeUtf8(const char* lpszText, size_t cbText)
+{
+	std::wstring text(utf8::GetMaxUtf16Length(cbText), L'\0');
+	text.resize(utf8::ToUtf16(lpszText, cbText, reinterpret_cast<char16_t*>(&text[0]), text.size()));
+
+	return text;
+}
+
+void util::DecodeUtf8(const char* lpszText, size_t cbText, wchar_t* out, size_t out_len)
+{
+	assert(out_len > 0);
+
+	const size_t cchText = utf8::ToUtf16(lpszText, cbText, reinterpret_cast<char16_t*>(out), out_len - 1);
+	out[cchText] = L'\0';
 }
 
 void util::TrimEditControlContent(HWND hEditCtrl)
@@ -14,7 +14,7 @@
 #define WM_EXPORT_TICKET        (WM_APP + 5)
 #define WM_DELETE_PERSON_TICKET (WM_APP + 6)
 #define WM_PREPARE_FOR_EXPORT   (WM_APP + 7)
-#define WM_GET_SEARCH_HANDLE    (WM_APP + 8)
+#define WM_DATABASE_TASK_DONE   (WM_APP + 9)
 
 // In order to use the RGB macro to initialize a Direct2D color, we have to enter
 // the r, g, b values in reverse order, so we'll use this macro to make the program more readable
@@ -56,6 +56,11 @@
 
 #define INVALID_DATE (-1)
 
+// Value of a packed date (see util::PackDate) or time (see util::ConvertStringToTime)
+// that hasn't been set, e.g. the arrival date of a ticket with no return. Displayed as "-"
+#define NO_DATE (0)
+#define NO_TIME (-1)
+
 namespace util
 {
     ////////////////////////////////////////////////////////
@@ -77,6 +82,13 @@ namespace util
 
     Date ConvertStringToDate(const std::wstring& str);
 
+    int PackDate(const util::Date& date);
+    util::Date UnpackDate(int packed);
+    int ConvertStringToTime(const std::wstring& str);
+
+    std::wstring FormatPackedDate(int packed);
+    std::wstring FormatTime(int minutes);
+
     //////////////////////////////////////////////////////////////
     //////////// Person role conversion functions ////////////////
     //////////////////////////////////////////////////////////////
@@ -91,6 +103,22 @@ namespace util
     std::wstring EnumToString(PersonRole role);
 
     PersonRole StringToEnum(std::wstring role);
+
+    //////////////////////////////////////////////////////////////
+    //////////// Ticket state conversion functions ///////////////
+    //////////////////////////////////////////////////////////////
+
+    enum class TicketState
+    {
+        INVALID = -1,
+        PENDING = 0,
+        ACTIVE,
+        INACTIVE,
+    };
+
+    std::wstring EnumToString(TicketState state);
+
+    TicketState StringToTicketState(const std::wstring& state);
     
     //////////////////////////////////////////////////////////////
     /////////////////// Win32 API Functions //////////////////////
@@ -112,6 +140,11 @@ namespace util
     ///////////////////////////////////
     /////// Encoding/Decoding//////////
     ///////////////////////////////////
-    void EncodeWideTextToMultibyte(const wchar_t* lpszText, char* out, size_t out_len);
-    void DecodeMultibyteToWideText(const char* lpszText, wchar_t* out, size_t out_len);
+    // Between UTF-16 and the UTF-8 SQLite stores text in, see Utf8.h. Neither text has
+    // to be null terminated, and the result is exactly as long as it needs to be.
+    std::string EncodeUtf8(const wchar_t* lpszText, size_t cchText);
+    std::wstring DecodeUtf8(const char* lpszText, size_t cbText);
+
+    // Decodes as much of the text as fits in out, which is always null terminated
+    void DecodeUtf8(const char* lpszText, size_t cbText, wchar_t* out, size_t out_len);
 }
\ No newline at end of file
@@ -40,7 +40,7 @@ void Initialize(void)
     // than 1, the program will look blurry
     SetProcessDpiAwarenessContext(DPI_AWARENESS_CONTEXT_PER_MONITOR_AWARE_V2);
 
-    db::Init();
+    db::Init(db::LoadOpenProfile("sva.ini"));
     render::InitializeDirect2D();
 }
 
@@ -62,6 +62,9 @@ INT APIENTRY wWinMain(_In_ HINSTANCE hInstance,
         MessageBoxA(NULL, e.what(), ("Error [" + std::to_string(GetLastError()) + "]").c_str(), MB_ICONERROR | MB_OK);
     }
     
+    // The message loop is over, so the completions of the remaining work would never run
+    db::GetExecutor().SetCompletionDispatcher([](DatabaseExecutor::Task) {});
+
     db::Uninit();
     render::UninitializeDirect2D();
     ReleaseMutex(g_hSingleInstanceMutex);